@@ -0,0 +1,2411 @@
+#include "Application.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <set>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+#include "CpuProfiler.h"
+#include "MeshLoader.h"
+#include "MeshFile.h"
+#include "TextureCodec.h"
+#include "DeviceSelector.h"
+
+using namespace std;
+
+// Host visible memory shared by all uploads in flight.
+const VkDeviceSize STAGING_BUFFER_SIZE = 32 * 1024 * 1024;
+
+// Uniform data written per frame in flight.
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 64 * 1024;
+
+// Compiled shaders are read from there unless they are embedded.
+const char* SHADER_DIRECTORY = "shaders";
+
+// Compiled pipelines persisted between runs.
+const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// Device index or part of its name, overrides the device ranking unless --device is given.
+const char* DEVICE_ENVIRONMENT_VARIABLE = "VULKAN_DEVICE";
+
+// Below this many draws recording on one thread is cheaper than handing out secondary command buffers.
+const uint32_t PARALLEL_RECORD_THRESHOLD = 256;
+
+// Frames between record time and frame pacing reports.
+const uint32_t RECORD_STATS_INTERVAL = 500;
+
+// Decoding is I/O and memory bound, a couple of threads keep up with the per frame upload cap.
+const uint32_t TEXTURE_LOAD_THREADS = 2;
+
+// Width and height of --procedural-textures.
+const uint32_t PROCEDURAL_TEXTURE_SIZE = 1024;
+
+// Clip space depth per unit of z, maps z in [-3, 3] to [0.05, 0.95]. Depth layers sit in [-1, 1], meshes
+// add at most their radius in front and behind.
+const float DEPTH_SCALE = 0.15f;
+
+const vector<const char*> validationLayers = {
+	"VK_LAYER_LUNARG_standard_validation"
+};
+
+const vector<const char*> deviceExtensions = {
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+};
+
+// Drawn when no mesh file is given.
+const std::vector<Vertex> quadVertices = {
+	{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+	{{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+	{{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+	{{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}}
+};
+
+const std::vector<uint32_t> quadIndices = {
+	0, 1, 2, 2, 3, 0
+};
+
+#ifdef NDEBUG
+	const bool enableValidationLayers = false;
+#else
+	const bool enableValidationLayers = true;
+#endif
+
+// Create DebugReportCallback loaded proxy function.
+VkResult CreateDebugReportCallbackEXT(
+	VkInstance instance,
+	const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
+	const VkAllocationCallbacks* pAllocator,
+	VkDebugReportCallbackEXT* pCallback) {
+	PFN_vkCreateDebugReportCallbackEXT func = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
+
+	if (func != nullptr) {
+		return func(instance, pCreateInfo, pAllocator, pCallback);
+	}
+	else {
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	}
+}
+
+// Destroy DebugReportCallback loaded proxy function.
+void DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT callback, const VkAllocationCallbacks* pAllocator) {
+	PFN_vkDestroyDebugReportCallbackEXT func = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
+
+	if (func != nullptr) {
+		func(instance, callback, pAllocator);
+	}
+}
+
+Application::Application(const AppSettings &settings) : settings(settings), recordPool(settings.recordThreads) {
+}
+
+void Application::run() {
+	if (!settings.tracePath.empty()) {
+		CpuProfiler::setEnabled(true);
+		CpuProfiler::setThreadName("Main");
+	}
+
+	if (!settings.headless) {
+		initWindow();
+	}
+	initVulkan();
+	if (settings.headless) {
+		renderHeadless();
+	}
+	else {
+		mainLoop();
+	}
+	cleanup();
+}
+
+void Application::setFrameCallback(FrameCallback callback) {
+	frameCallback = callback;
+}
+
+double Application::getHeadlessMilliseconds() const {
+	return headlessMilliseconds;
+}
+
+double Application::getRecordMilliseconds() const {
+	return totalRecordMilliseconds;
+}
+
+const vector<double>& Application::getFrameMilliseconds() const {
+	return frameMilliseconds;
+}
+
+double Application::getUploadMilliseconds() const {
+	return uploadMilliseconds;
+}
+
+UploadQueue::Stats Application::getUploadStats() const {
+	return uploadStats;
+}
+
+MemoryAllocator::Stats Application::getMemoryStats() const {
+	return memoryStats;
+}
+
+PipelineManager::Stats Application::getPipelineStats() const {
+	return pipelineStats;
+}
+
+vector<GpuProfiler::ScopeStats> Application::getGpuStats() const {
+	return gpuStats;
+}
+
+const string& Application::getDeviceName() const {
+	return deviceName;
+}
+
+void Application::initWindow() {
+	//Init GLFW lib.
+	glfwInit();
+
+	//Override OpenGL to vulkan.
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+	//Creates a window.
+	window = glfwCreateWindow(settings.width, settings.height, "Vulkan window", nullptr, nullptr);
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+}
+
+void Application::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+	auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+	app->framebufferResized = true;
+}
+
+void Application::initVulkan() {
+	createInstance();
+	setupDebugCallback();
+	createSurface();
+	pickPhysicalDevice();
+	createLogicalDevice();
+	memoryAllocator.init(physicalDevice, logicDevice);
+	renderGraph.init(logicDevice, memoryAllocator);
+	descriptorAllocator.init(logicDevice, settings.framesInFlight);
+	gpuProfiler.init(physicalDevice, logicDevice, findQueueFamily(physicalDevice).graphicsFamily, settings.framesInFlight);
+	framePacer.init(settings.framesInFlight, settings.fpsLimit, RECORD_STATS_INTERVAL);
+	pipelineCache.init(physicalDevice, logicDevice, PIPELINE_CACHE_PATH);
+	shaderLibrary.init(SHADER_DIRECTORY);
+	pipelineManager.init(logicDevice, pipelineCache.getHandle(), shaderLibrary);
+	if (settings.headless) {
+		createOffscreenTargets();
+	}
+	else {
+		createSwapChain();
+	}
+	createImageViews();
+	depthFormat = findDepthFormat();
+	createRenderGraph();
+	createRenderPass();
+	createDescriptorSetLayout();
+	createPipelineLayouts();
+	prewarmPipelines();
+	createFrameBuffers();
+	createCommandPool();
+	stagingRing.init(logicDevice, memoryAllocator, STAGING_BUFFER_SIZE, settings.framesInFlight);
+	uniformRing.init(physicalDevice, logicDevice, memoryAllocator, UNIFORM_RING_FRAME_SIZE, settings.framesInFlight);
+	createDescriptorSets();
+	loadTextures();
+
+	chrono::high_resolution_clock::time_point uploadStart = chrono::high_resolution_clock::now();
+	loadMesh();
+	createScene();
+	createObjectBuffer();
+	createInstanceBuffers();
+	uint64_t uploadTicket = uploadQueue.flush();
+	//Headless runs wait for the scene uploads so their throughput can be reported.
+	if (settings.headless) {
+		uploadQueue.wait(uploadTicket);
+		uploadMilliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - uploadStart).count();
+		//Textures decoded while the scene loaded. Waiting makes every headless run stream in the same levels on the same frames.
+		textureStreamer.waitForLoads();
+	}
+
+	createGpuCulling();
+	createCommandBuffers();
+	createSemaphores();
+	resolvePipelines();
+	//Headless runs have no frame loop to swap reloaded pipelines into.
+	if (!settings.headless) {
+		startShaderReload();
+	}
+
+	memoryAllocator.printStats();
+
+	DescriptorAllocator::Stats descriptorStats = descriptorAllocator.getStats();
+	cout << "Descriptors: " << descriptorStats.layoutCount << " set layouts, " << descriptorStats.staticSetCount << " static sets in "
+		<< descriptorStats.poolCount << " pools" << endl;
+
+	RenderGraph::Stats graphStats = renderGraph.getStats();
+	cout << "Render graph: " << graphStats.passCount - graphStats.culledPassCount << "/" << graphStats.passCount << " passes, "
+		<< graphStats.barrierCount << " barriers in " << graphStats.barrierBatchCount << " batches, " << graphStats.transientCount << " transients of "
+		<< graphStats.transientBytes / (1024.0 * 1024.0) << " MB in " << graphStats.allocatedBytes / (1024.0 * 1024.0) << " MB, aliasing saved "
+		<< (graphStats.transientBytes - graphStats.allocatedBytes) / (1024.0 * 1024.0) << " MB" << endl;
+}
+
+//Only the extent dependent objects, the render pass and pipeline outlive resizes.
+void Application::cleanupSwapChain() {
+	for (VkFramebuffer framebuffers : swapChainFrameBuffers) {
+		vkDestroyFramebuffer(logicDevice, framebuffers, nullptr);
+	}
+
+	for (VkImageView imageView : swapChainImageViews) {
+		vkDestroyImageView(logicDevice, imageView, nullptr);
+	}
+
+	renderGraph.cleanup();
+
+	if (settings.headless) {
+		cleanupOffscreenTargets();
+	}
+	else {
+		vkDestroySwapchainKHR(logicDevice, swapChain, nullptr);
+	}
+}
+
+void Application::cleanupPipeline() {
+	pipelineManager.release(graphicsPipelineId);
+	graphicsPipeline = VK_NULL_HANDLE;
+	vkDestroyRenderPass(logicDevice, renderPass, nullptr);
+}
+
+void Application::destroyRetiredSwapChains(bool deviceIdle) {
+	CPU_PROFILE_SCOPE("Destroy retired swapchains");
+	while (!retiredSwapChains.empty()) {
+		RetiredSwapChain &retired = retiredSwapChains.front();
+
+		//Frames up to frameNumber - framesInFlight have passed their fence wait.
+		if (!deviceIdle && frameNumber < retired.retiredFrame + settings.framesInFlight) {
+			break;
+		}
+
+		for (VkFramebuffer framebuffer : retired.frameBuffers) {
+			vkDestroyFramebuffer(logicDevice, framebuffer, nullptr);
+		}
+		for (VkImageView imageView : retired.imageViews) {
+			vkDestroyImageView(logicDevice, imageView, nullptr);
+		}
+		RenderGraph::destroyTransients(logicDevice, memoryAllocator, retired.transients);
+		vkDestroySwapchainKHR(logicDevice, retired.swapChain, nullptr);
+
+		retiredSwapChains.pop_front();
+	}
+}
+
+void Application::recreateSwapChain() {
+	CPU_PROFILE_SCOPE("Recreate swapchain");
+
+	//Temporary, disables swapchain while in background
+	int width = 0, height = 0;
+	{
+		CPU_PROFILE_SCOPE("Wait for window");
+		while (width == 0 || height == 0) {
+			glfwGetFramebufferSize(window, &width, &height);
+			glfwWaitEvents();
+		}
+	}
+
+	chrono::high_resolution_clock::time_point recreateStart = chrono::high_resolution_clock::now();
+
+	RetiredSwapChain retired;
+	retired.swapChain = swapChain;
+	retired.imageViews = move(swapChainImageViews);
+	retired.frameBuffers = move(swapChainFrameBuffers);
+	retired.transients = renderGraph.takeTransients();
+	retired.retiredFrame = frameNumber;
+	retiredSwapChains.push_back(move(retired));
+
+	VkFormat oldFormat = swapChainImageFormat;
+
+	{
+		CPU_PROFILE_SCOPE("Create swapchain");
+		createSwapChain(retiredSwapChains.back().swapChain);
+		createImageViews();
+		createRenderGraph();
+	}
+
+	if (swapChainImageFormat != oldFormat) {
+		//The render pass depends on the format, which practically never changes on resize.
+		CPU_PROFILE_SCOPE("Rebuild pipeline");
+		vkDeviceWaitIdle(logicDevice);
+		cleanupPipeline();
+		createRenderPass();
+
+		//Nothing to prewarm, the format is only known now.
+		chrono::high_resolution_clock::time_point compileStart = chrono::high_resolution_clock::now();
+		graphicsPipelineId = pipelineManager.request(getGraphicsPipelineKey());
+		graphicsPipeline = pipelineManager.get(graphicsPipelineId);
+		cout << "Graphics pipeline compiled for the new format in "
+			<< chrono::duration<double, milli>(chrono::high_resolution_clock::now() - compileStart).count() << " ms" << endl;
+	}
+
+	{
+		CPU_PROFILE_SCOPE("Create framebuffers");
+		createFrameBuffers();
+	}
+
+	double milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - recreateStart).count();
+	recreateCount++;
+	recreateTotalMilliseconds += milliseconds;
+	recreateMaxMilliseconds = max(recreateMaxMilliseconds, milliseconds);
+
+	cout << "Swapchain recreated at " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << milliseconds << " ms ("
+		<< recreateCount << " recreations, avg " << recreateTotalMilliseconds / recreateCount << " ms, max " << recreateMaxMilliseconds << " ms)" << endl;
+}
+
+void Application::createInstance() {
+	if (enableValidationLayers && !checkValidationLayerSupport()) {
+		throw runtime_error("Validation layers requested, but not available!");
+	}
+
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Application";
+	appInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
+	appInfo.pEngineName = "No engine";
+	appInfo.engineVersion = VK_MAKE_VERSION(0, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	vector<const char*> requiredExtensions = getRequiredExtensions();
+
+	VkInstanceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+	createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+	if (enableValidationLayers) {
+		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+	}
+	else {
+		createInfo.enabledLayerCount = 0;
+	}
+
+	if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+		throw runtime_error("Failed to create vulkan instance");
+	}
+
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+	cout << "Available extensions:" << endl;
+	for (const VkExtensionProperties &extension : extensions) {
+		cout << "\t" << extension.extensionName << endl;
+	}
+}
+
+void Application::setupDebugCallback() {
+	if (!enableValidationLayers) {
+		return;
+	}
+
+	VkDebugReportCallbackCreateInfoEXT createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
+	createInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+	createInfo.pfnCallback = debugCallback;
+
+	if (CreateDebugReportCallbackEXT(instance, &createInfo, nullptr, &callback) != VK_SUCCESS) {
+		runtime_error("Failed to set up debug callback!");
+	}
+}
+
+void Application::createSurface() {
+	if (settings.headless) {
+		return;
+	}
+
+	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+		throw runtime_error("Failed to create window surface!");	
+	}
+}
+
+void Application::pickPhysicalDevice() {
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+
+	if (deviceCount == 0) {
+		throw runtime_error("Faliled to find GPUs with Vulkan support!");
+	}
+
+	vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+	vector<DeviceSelector::Candidate> candidates;
+	for (const VkPhysicalDevice& device : devices) {
+		DeviceSelector::Candidate candidate = DeviceSelector::describe(device);
+		candidate.unsuitableReason = getUnsuitableReason(device);
+		candidates.push_back(candidate);
+	}
+
+	string preference = settings.device;
+	string reason = "by --device " + preference;
+	if (preference.empty()) {
+		const char* environmentPreference = getenv(DEVICE_ENVIRONMENT_VARIABLE);
+		if (environmentPreference != nullptr && environmentPreference[0] != '\0') {
+			preference = environmentPreference;
+			reason = string("by ") + DEVICE_ENVIRONMENT_VARIABLE + "=" + preference;
+		}
+		else {
+			reason = "by score";
+		}
+	}
+
+	uint32_t selected = DeviceSelector::select(candidates, preference);
+	DeviceSelector::print(cout, candidates, selected, reason);
+	physicalDevice = devices[selected];
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	deviceName = properties.deviceName;
+
+	//Compressed textures the device can't sample are decoded to RGBA8 on the loader threads instead.
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	vector<VkFormat> sampleableFormats = TextureStreamer::getSampleableFormats(physicalDevice, supportedFeatures);
+	string nativeFormats;
+	string transcodedFormats;
+	for (uint32_t i = 0; i < TextureCodec::FORMAT_COUNT; i++) {
+		VkFormat format = TextureCodec::FORMATS[i];
+		if (!TextureCodec::isCompressed(format)) {
+			continue;
+		}
+		bool native = find(sampleableFormats.begin(), sampleableFormats.end(), format) != sampleableFormats.end();
+		string &names = native ? nativeFormats : transcodedFormats;
+		names += (names.empty() ? "" : " ") + string(TextureCodec::getName(format));
+	}
+	cout << deviceName << " samples compressed textures: " << (nativeFormats.empty() ? "none" : nativeFormats)
+		<< ", transcodes on the CPU: " << (transcodedFormats.empty() ? "none" : transcodedFormats) << endl;
+}
+
+void Application::createLogicalDevice() {
+	QueueFamilyIndices indices = findQueueFamily(physicalDevice);
+	float queuePriority = 1.f;
+
+	vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
+
+	for (int queueFamily : uniqueQueueFamilies) {
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = queueFamily;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
+
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	//Indirect draws carry the object index in firstInstance, and draw the whole scene in one call with multiDrawIndirect.
+	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	//Each draw picks its texture from an array with an index that is only uniform within the draw.
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+	//Block compressed textures are sampled as they are stored where the device allows it.
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+	enabledFeatures = deviceFeatures;
+
+	//Settled before the render graph and pipelines are built for the mode.
+	RenderMode renderMode = resolveRenderMode(settings.renderMode, enabledFeatures);
+	if (renderMode != settings.renderMode) {
+		cout << "drawIndirectFirstInstance is not supported, falling back to CPU recorded draws" << endl;
+		settings.renderMode = renderMode;
+	}
+
+	VkDeviceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	createInfo.pQueueCreateInfos = queueCreateInfos.data();
+
+	createInfo.pEnabledFeatures = &deviceFeatures;
+
+	vector<const char*> requiredDeviceExtensions = getDeviceExtensions();
+
+	bool drawIndirectCountSupported = isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (drawIndirectCountSupported) {
+		requiredDeviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+
+	if (enableValidationLayers) {
+		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+	}
+	else {
+		createInfo.enabledLayerCount = 0;
+	}
+
+	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicDevice) != VK_SUCCESS) {
+		throw runtime_error("Error creating logical device!");
+	}
+
+	vkGetDeviceQueue(logicDevice, indices.graphicsFamily, 0, &graphicsQueue);
+	vkGetDeviceQueue(logicDevice, indices.presentFamily, 0, &presentQueue);
+	vkGetDeviceQueue(logicDevice, indices.transferFamily, 0, &transferQueue);
+
+	if (drawIndirectCountSupported) {
+		drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(logicDevice, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+
+	uploadQueue.init(logicDevice, transferQueue, indices.transferFamily, graphicsQueue, indices.graphicsFamily);
+}
+
+void Application::createSwapChain(VkSwapchainKHR oldSwapChain) {
+	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+
+	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+		imageCount = swapChainSupport.capabilities.maxImageCount;
+	}
+
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.presentMode = presentMode;
+	createInfo.imageExtent = extent;
+	//1 for non stereoscopic renders.
+	createInfo.imageArrayLayers = 1;
+	// Swapchain operation, VK_IMAGE_USAGE_TRANSFER_DST_BIT for pp-effects.
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	QueueFamilyIndices indices = findQueueFamily(physicalDevice);
+	uint32_t queueFamilyIndices[] = { (uint32_t)indices.graphicsFamily, (uint32_t)indices.presentFamily };
+
+	if (indices.graphicsFamily != indices.presentFamily) {
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else {
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.queueFamilyIndexCount = 0; //Optional here
+		createInfo.pQueueFamilyIndices = nullptr; //Optional here
+	}
+
+	createInfo.preTransform = swapChainSupport.capabilities.currentTransform; 
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	// Dont render whats covered by i.e. another window. Downside is that you cant read those pixels.
+	createInfo.clipped = VK_TRUE;
+
+	// Used when you for example resizes a window, lets the driver hand resources over from the old swapchain.
+	createInfo.oldSwapchain = oldSwapChain;
+
+	if (vkCreateSwapchainKHR(logicDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+		throw runtime_error("Failed to creat swapchain!");
+	}
+
+	vkGetSwapchainImagesKHR(logicDevice, swapChain, &imageCount, nullptr);
+	swapChainImages.resize(imageCount);
+	vkGetSwapchainImagesKHR(logicDevice, swapChain, &imageCount, swapChainImages.data());
+
+	swapChainImageFormat = surfaceFormat.format;
+	swapChainExtent = extent;
+}
+
+void Application::createOffscreenTargets() {
+	//RGBA8 so readback rows can be handed out without swizzling.
+	swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	swapChainExtent = { settings.width, settings.height };
+
+	//One target per frame in flight, frame N always renders into target N % framesInFlight.
+	swapChainImages.resize(settings.framesInFlight);
+	offscreenTargets.resize(settings.framesInFlight);
+
+	VkDeviceSize readbackSize = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = swapChainImageFormat;
+		imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(logicDevice, &imageInfo, nullptr, &swapChainImages[i]) != VK_SUCCESS) {
+			throw runtime_error("Failed to create offscreen image!");
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(logicDevice, swapChainImages[i], &memReqs);
+
+		OffscreenTarget &target = offscreenTargets[i];
+		target.imageAllocation = memoryAllocator.allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+		if (vkBindImageMemory(logicDevice, swapChainImages[i], target.imageAllocation.memory, target.imageAllocation.offset) != VK_SUCCESS) {
+			throw runtime_error("Failed to bind offscreen image memory!");
+		}
+
+		createBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			target.readbackBuffer, target.readbackAllocation);
+		target.pendingFrame = -1;
+	}
+}
+
+void Application::cleanupOffscreenTargets() {
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		vkDestroyImage(logicDevice, swapChainImages[i], nullptr);
+		memoryAllocator.free(offscreenTargets[i].imageAllocation);
+
+		vkDestroyBuffer(logicDevice, offscreenTargets[i].readbackBuffer, nullptr);
+		memoryAllocator.free(offscreenTargets[i].readbackAllocation);
+	}
+
+	swapChainImages.clear();
+	offscreenTargets.clear();
+}
+
+void Application::createImageViews() {
+	swapChainImageViews.resize(swapChainImages.size());
+
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		VkImageViewCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = swapChainImages[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = swapChainImageFormat;
+
+		createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(logicDevice, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+			throw runtime_error("Failed to create image views!");
+		}
+	}
+}
+
+VkFormat Application::findDepthFormat() {
+	//Nothing uses stencil, the formats with it only come after every depth only one.
+	const VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D16_UNORM,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT
+	};
+
+	for (VkFormat format : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+
+	throw runtime_error("Failed to find a supported depth format!");
+}
+
+void Application::createRenderGraph() {
+	//Windowed frames wait for the acquire semaphore at color output, offscreen targets were last read before the frame's fence.
+	RenderGraph::State acquired;
+	acquired.stages = settings.headless ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	colorResource = renderGraph.importImage("Color", VK_IMAGE_ASPECT_COLOR_BIT, acquired);
+
+	//Offscreen targets stay in whatever layout the readback left them in.
+	RenderGraph::State presented;
+	presented.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	presented.layout = settings.headless ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	renderGraph.exportResource(colorResource, presented);
+
+	//Only read by the depth tests of the frame that wrote it.
+	depthResource = renderGraph.createImage("Depth", depthFormat, swapChainExtent);
+
+	//The streamer synchronizes its own uploads, nothing in the graph depends on them.
+	RenderGraph::PassId texturePass = renderGraph.addPass("Texture streaming", [this](VkCommandBuffer commandBuffer) {
+		GpuProfiler::Scope textureScope(gpuProfiler, commandBuffer, "Texture streaming");
+		recordTextureUploads(commandBuffer);
+	});
+	renderGraph.setSideEffects(texturePass);
+
+	bool gpuDriven = settings.renderMode == RenderMode::GpuDriven;
+	if (gpuDriven) {
+		drawBufferResource = renderGraph.importBuffer("Draw commands", RenderGraph::State());
+		countBufferResource = renderGraph.importBuffer("Draw count", RenderGraph::State());
+
+		RenderGraph::PassId cullPass = renderGraph.addPass("Cull", [this](VkCommandBuffer commandBuffer) {
+			GpuProfiler::Scope cullScope(gpuProfiler, commandBuffer, "Cull");
+			gpuCulling.recordCull(commandBuffer, recordFrameIndex, viewProjection);
+		});
+		renderGraph.write(cullPass, drawBufferResource, RenderGraph::Usage::ComputeStorage);
+		renderGraph.write(cullPass, countBufferResource, RenderGraph::Usage::Transfer);
+		renderGraph.write(cullPass, countBufferResource, RenderGraph::Usage::ComputeStorage);
+	}
+
+	RenderGraph::PassId opaquePass = renderGraph.addPass("Opaque", [this](VkCommandBuffer commandBuffer) {
+		recordOpaquePass(commandBuffer);
+	});
+	renderGraph.write(opaquePass, colorResource, RenderGraph::Usage::ColorAttachment);
+	renderGraph.write(opaquePass, depthResource, RenderGraph::Usage::DepthAttachment);
+	if (gpuDriven) {
+		renderGraph.read(opaquePass, drawBufferResource, RenderGraph::Usage::IndirectArguments);
+		renderGraph.read(opaquePass, countBufferResource, RenderGraph::Usage::IndirectArguments);
+	}
+
+	if (settings.headless) {
+		readbackResource = renderGraph.importBuffer("Readback", RenderGraph::State());
+
+		RenderGraph::PassId readbackPass = renderGraph.addPass("Readback", [this](VkCommandBuffer commandBuffer) {
+			GpuProfiler::Scope readbackScope(gpuProfiler, commandBuffer, "Readback");
+			recordReadback(commandBuffer, recordImageIndex);
+		});
+		renderGraph.read(readbackPass, colorResource, RenderGraph::Usage::Transfer);
+		renderGraph.write(readbackPass, readbackResource, RenderGraph::Usage::Transfer);
+
+		//Without anyone reading the pixels the copy is culled, deliverFrame then has nothing to hand out.
+		if (frameCallback || !settings.outputPath.empty()) {
+			RenderGraph::State hostRead;
+			hostRead.stages = VK_PIPELINE_STAGE_HOST_BIT;
+			hostRead.access = VK_ACCESS_HOST_READ_BIT;
+			renderGraph.exportResource(readbackResource, hostRead);
+		}
+	}
+
+	renderGraph.compile();
+	if (settings.dumpRenderGraph) {
+		renderGraph.dump(cout);
+	}
+}
+
+void Application::createRenderPass() {
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = swapChainImageFormat;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	//The render graph's barriers transition the attachments around the pass and order it against the other passes.
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	if (vkCreateRenderPass(logicDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+		throw runtime_error("Failed to create renderpass!");
+	}
+}
+
+void Application::createPipelineLayouts() {
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawConstants);
+
+	VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, textureSetLayout };
+	pipelineLayoutCreateInfo.setLayoutCount = 2;
+	pipelineLayoutCreateInfo.pSetLayouts = setLayouts;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(logicDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw runtime_error("Failed to create pipeline layout!");
+	}
+
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		gpuCulling.init(logicDevice, descriptorAllocator);
+	}
+}
+
+PipelineKey Application::getGraphicsPipelineKey() {
+	PipelineKey key;
+	key.stages.push_back({ VK_SHADER_STAGE_VERTEX_BIT, "vert.spv" });
+	key.stages.push_back({ VK_SHADER_STAGE_FRAGMENT_BIT, "frag.spv" });
+
+	//Binding 0 steps per vertex, binding 1 per instance.
+	key.bindings.push_back(Vertex::getBindingDescription());
+	key.bindings.push_back(InstanceData::getBindingDescription());
+
+	auto vertexAttributeDesc = Vertex::getAttributeDescriptions();
+	auto instanceAttributeDesc = InstanceData::getAttributeDescriptions();
+	key.attributes.assign(vertexAttributeDesc.begin(), vertexAttributeDesc.end());
+	key.attributes.insert(key.attributes.end(), instanceAttributeDesc.begin(), instanceAttributeDesc.end());
+
+	//Viewport and scissor are dynamic, set in recordDraws, so the pipeline survives resizes.
+	key.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	key.polygonMode = VK_POLYGON_MODE_FILL;
+	key.cullMode = VK_CULL_MODE_BACK_BIT;
+	key.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	key.blendEnable = false;
+	key.depthTestEnable = true;
+	key.depthWriteEnable = true;
+	key.depthCompareOp = VK_COMPARE_OP_LESS;
+	key.layout = pipelineLayout;
+	key.renderPass = renderPass;
+	key.subpass = 0;
+
+	return key;
+}
+
+void Application::prewarmPipelines() {
+	vector<PipelineKey> keys = { getGraphicsPipelineKey() };
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		keys.push_back(gpuCulling.getPipelineKey("cull.spv"));
+	}
+
+	vector<PipelineManager::PipelineId> ids = pipelineManager.prewarm(keys);
+	graphicsPipelineId = ids[0];
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		cullPipelineId = ids[1];
+	}
+}
+
+void Application::resolvePipelines() {
+	CPU_PROFILE_SCOPE("Resolve pipelines");
+
+	graphicsPipeline = pipelineManager.get(graphicsPipelineId);
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		gpuCulling.setPipeline(pipelineManager.get(cullPipelineId));
+	}
+
+	PipelineManager::Stats stats = pipelineManager.getStats();
+	cout << "Pipelines: " << stats.compileCount << " compiled in the background in " << stats.compileMilliseconds << " ms (max "
+		<< stats.maxCompileMilliseconds << " ms, " << (pipelineCache.wasLoaded() ? "cache loaded from disk" : "cold cache") << "), startup waited "
+		<< stats.waitMilliseconds << " ms for them" << endl;
+}
+
+void Application::startShaderReload() {
+	if (!settings.hotReload) {
+		return;
+	}
+	if (ShaderLibrary::isEmbedded()) {
+		cout << "Shaders are embedded, hot reload is disabled" << endl;
+		return;
+	}
+
+	shaderLibrary.startWatching();
+	watchingShaders = true;
+}
+
+void Application::updatePipelineReloads() {
+	if (!watchingShaders) {
+		return;
+	}
+	CPU_PROFILE_SCOPE("Pipeline reloads");
+
+	destroyRetiredPipelines(false);
+
+	for (const string &name : shaderLibrary.takeChanges()) {
+		uint32_t reloadCount = pipelineManager.reloadShader(name);
+		cout << "Shader " << name << " changed, recompiling " << reloadCount << " pipelines" << endl;
+	}
+
+	//The new pipelines are bound from the next recorded frame on, frames in flight keep using the old ones.
+	vector<VkPipeline> replaced = pipelineManager.takeReplaced();
+	if (replaced.empty()) {
+		return;
+	}
+	for (VkPipeline pipeline : replaced) {
+		retiredPipelines.push_back({ pipeline, frameNumber });
+	}
+
+	graphicsPipeline = pipelineManager.get(graphicsPipelineId);
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		gpuCulling.setPipeline(pipelineManager.get(cullPipelineId));
+	}
+	cout << replaced.size() << " pipelines reloaded" << endl;
+}
+
+void Application::destroyRetiredPipelines(bool deviceIdle) {
+	while (!retiredPipelines.empty()) {
+		const RetiredPipeline &retired = retiredPipelines.front();
+
+		//Frames up to frameNumber - framesInFlight have passed their fence wait.
+		if (!deviceIdle && frameNumber < retired.retiredFrame + settings.framesInFlight) {
+			break;
+		}
+
+		vkDestroyPipeline(logicDevice, retired.pipeline, nullptr);
+		retiredPipelines.pop_front();
+	}
+}
+
+void Application::createFrameBuffers() {
+	swapChainFrameBuffers.resize(swapChainImageViews.size());
+
+	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+		VkImageView attachments[] = {
+			swapChainImageViews[i],
+			renderGraph.getImageView(depthResource)
+		};
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = renderPass;
+		framebufferCreateInfo.attachmentCount = 2;
+		framebufferCreateInfo.pAttachments = attachments;
+		framebufferCreateInfo.width = swapChainExtent.width;
+		framebufferCreateInfo.height = swapChainExtent.height;
+		framebufferCreateInfo.layers = 1;
+
+		if (vkCreateFramebuffer(logicDevice, &framebufferCreateInfo, nullptr, &swapChainFrameBuffers[i]) != VK_SUCCESS) {
+			throw runtime_error("Failed to create framebuffer!");
+		}
+	}
+}
+
+void Application::createCommandPool() {
+	QueueFamilyIndices indices = findQueueFamily(physicalDevice);
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.queueFamilyIndex = indices.graphicsFamily;
+	//Pools are reset as a whole every time their frame comes around.
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	frameCommands.resize(settings.framesInFlight);
+
+	for (FrameCommands &frame : frameCommands) {
+		if (vkCreateCommandPool(logicDevice, &commandPoolCreateInfo, nullptr, &frame.primaryPool) != VK_SUCCESS) {
+			throw runtime_error("Failed to create command pool");
+		}
+
+		frame.workerPools.resize(recordPool.getWorkerCount());
+		for (VkCommandPool &workerPool : frame.workerPools) {
+			if (vkCreateCommandPool(logicDevice, &commandPoolCreateInfo, nullptr, &workerPool) != VK_SUCCESS) {
+				throw runtime_error("Failed to create command pool");
+			}
+		}
+	}
+}
+
+void Application::createScene() {
+	objects.clear();
+	instances.clear();
+
+	glm::vec3 meshCenter(meshBoundingSphere.x, meshBoundingSphere.y, meshBoundingSphere.z);
+	float meshRadius = meshBoundingSphere.w;
+
+	//Square grid covering 1.5 times the view in each direction, roughly half the objects end up outside.
+	//Every cell holds one object per depth layer.
+	uint32_t layerCount = max(settings.depthLayers, 1u);
+	uint32_t cellCount = (settings.objectCount + layerCount - 1) / layerCount;
+	uint32_t gridSize = static_cast<uint32_t>(ceil(sqrt(static_cast<double>(cellCount))));
+	float cellSize = 3.f / gridSize;
+	//Every mesh is scaled to fit its cell.
+	float scale = meshRadius > 0.f ? cellSize * 0.55f / meshRadius : 1.f;
+	drawConstants.meshTransform = glm::vec4(meshCenter, scale);
+
+	//An instanced draw covers every object, the texture index would differ within a single draw.
+	uint32_t textureCount = textureStreamer.getTextureCount();
+	if (textureCount > 1 && settings.renderMode == RenderMode::Instanced) {
+		cout << "Instanced draws sample the first texture only" << endl;
+		textureCount = 1;
+	}
+	else if (textureCount > 1 && !enabledFeatures.shaderSampledImageArrayDynamicIndexing) {
+		cout << "shaderSampledImageArrayDynamicIndexing is not supported, every object samples the first texture" << endl;
+		textureCount = 1;
+	}
+
+	for (uint32_t i = 0; i < settings.objectCount; i++) {
+		uint32_t cell = i / layerCount;
+		float x = -1.5f + cellSize * (cell % gridSize + 0.5f);
+		float y = -1.5f + cellSize * (cell / gridSize + 0.5f);
+		//Layer 0 is the farthest, so objects in creation order are drawn back to front.
+		float z = 1.f - 2.f * (i % layerCount + 0.5f) / layerCount;
+
+		InstanceData instance = {};
+		instance.offsetScale = glm::vec4(x, y, 1.f, z);
+		//Tinted by grid position so neighbouring instances can be told apart.
+		instance.color = glm::vec4(0.5f + x / 3.f, 0.5f + y / 3.f, 1.f - (x + y) / 6.f, 1.f);
+		instance.textureIndex = textureCount > 0 ? i % textureCount : 0;
+		instances.push_back(instance);
+
+		ObjectData object = {};
+		//The vertex shader centers the mesh on the origin before placing it.
+		object.boundingSphere = glm::vec4(x, y, z, meshRadius * scale);
+		object.indexCount = meshIndexCount;
+		object.firstIndex = 0;
+		object.vertexOffset = 0;
+		objects.push_back(object);
+	}
+
+	//GPU culled and instanced draws are issued in object order. Nothing moves, so sorting the objects once
+	//keeps those draws front to back too, except where culling compacts them with atomics.
+	if (settings.sortDraws && settings.renderMode != RenderMode::CpuDraws) {
+		updateViewProjection();
+		buildOpaqueQueue();
+
+		vector<ObjectData> sortedObjects;
+		vector<InstanceData> sortedInstances;
+		for (const RenderQueue::Item &item : opaqueQueue.getItems()) {
+			sortedObjects.push_back(objects[item.drawIndex]);
+			sortedInstances.push_back(instances[item.drawIndex]);
+		}
+		objects.swap(sortedObjects);
+		instances.swap(sortedInstances);
+	}
+}
+
+void Application::createObjectBuffer() {
+	VkDeviceSize bufferSize = sizeof(ObjectData) * max(objects.size(), size_t(1));
+
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, objectBuffer, objectBufferAllocation);
+	uploadBuffer(objectBuffer, objects.data(), sizeof(ObjectData) * objects.size(), 0,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void Application::createDescriptorSetLayout() {
+	VkDescriptorSetLayoutBinding uniformBinding = {};
+	uniformBinding.binding = 0;
+	uniformBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	uniformBinding.descriptorCount = 1;
+	uniformBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	descriptorSetLayout = descriptorAllocator.getLayout({ uniformBinding });
+
+	VkDescriptorSetLayoutBinding textureBinding = {};
+	textureBinding.binding = 0;
+	textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureBinding.descriptorCount = MAX_TEXTURES;
+	textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	textureSetLayout = descriptorAllocator.getLayout({ textureBinding });
+}
+
+//Written once, every frame only changes the dynamic offset it is bound with.
+void Application::createDescriptorSets() {
+	VkDescriptorBufferInfo bufferInfo = uniformRing.getDescriptorInfo(sizeof(FrameUniforms));
+
+	frameDescriptorSet = descriptorAllocator.getStaticSet(descriptorSetLayout, {
+		DescriptorAllocator::Binding::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, bufferInfo.buffer, bufferInfo.offset, bufferInfo.range)
+	});
+}
+
+void Application::updateViewProjection() {
+	//No camera yet, the scene is in clip space and only corrected for the aspect ratio.
+	viewProjection = glm::mat4(1.f);
+	viewProjection[0][0] = static_cast<float>(swapChainExtent.height) / swapChainExtent.width;
+	viewProjection[2][2] = DEPTH_SCALE;
+	viewProjection[3][2] = 0.5f;
+}
+
+float Application::getViewDepth(const ObjectData &object) const {
+	glm::vec4 clip = viewProjection * glm::vec4(object.boundingSphere.x, object.boundingSphere.y, object.boundingSphere.z, 1.f);
+	return clip.z / clip.w;
+}
+
+void Application::buildOpaqueQueue() {
+	CPU_PROFILE_SCOPE("Sort draws");
+	opaqueQueue.clear();
+
+	//Every object uses the graphics pipeline, and its texture is all the material there is.
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		opaqueQueue.push(RenderQueue::makeKey(graphicsPipelineId, instances[i].textureIndex, getViewDepth(objects[i])), i);
+	}
+
+	if (settings.sortDraws) {
+		opaqueQueue.sort();
+	}
+}
+
+void Application::updateFrameUniforms() {
+	updateViewProjection();
+
+	FrameUniforms uniforms;
+	uniforms.viewProjection = viewProjection;
+	frameUniformOffset = uniformRing.push(uniforms);
+}
+
+void Application::createInstanceBuffers() {
+	VkDeviceSize bufferSize = sizeof(InstanceData) * max(instances.size(), size_t(1));
+
+	instanceBuffers.resize(settings.framesInFlight);
+	instanceBufferAllocations.resize(settings.framesInFlight);
+
+	for (size_t i = 0; i < settings.framesInFlight; i++) {
+		createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			instanceBuffers[i], instanceBufferAllocations[i]);
+	}
+
+	startTime = chrono::high_resolution_clock::now();
+}
+
+void Application::updateInstanceBuffer(uint32_t frameIndex) {
+	CPU_PROFILE_SCOPE("Update instances");
+	float seconds = settings.fixedTimeStep ? frameNumber / 60.f : chrono::duration<float>(chrono::high_resolution_clock::now() - startTime).count();
+	//Slow pulse so the per frame update is visible.
+	float brightness = 0.75f + 0.25f * sin(seconds * 2.f);
+
+	InstanceData* mapped = static_cast<InstanceData*>(instanceBufferAllocations[frameIndex].mappedData);
+	for (size_t i = 0; i < instances.size(); i++) {
+		mapped[i].offsetScale = instances[i].offsetScale;
+		mapped[i].color = instances[i].color * brightness;
+		mapped[i].textureIndex = instances[i].textureIndex;
+	}
+}
+
+void Application::createGpuCulling() {
+	if (settings.renderMode != RenderMode::GpuDriven) {
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	GpuCulling::Features features;
+	features.drawIndexedIndirectCount = drawIndexedIndirectCount;
+	features.multiDrawIndirect = enabledFeatures.multiDrawIndirect == VK_TRUE;
+	features.maxDrawIndirectCount = features.multiDrawIndirect ? properties.limits.maxDrawIndirectCount : 1;
+
+	gpuCulling.createBuffers(memoryAllocator, descriptorAllocator, objectBuffer, static_cast<uint32_t>(objects.size()), settings.framesInFlight, features);
+
+	cout << "GPU driven rendering with " << (drawIndexedIndirectCount ? "vkCmdDrawIndexedIndirectCountKHR" : "vkCmdDrawIndexedIndirect") << endl;
+}
+
+void Application::loadTextures() {
+	vector<VkFormat> sampleableFormats;
+	if (!settings.transcodeTextures) {
+		sampleableFormats = TextureStreamer::getSampleableFormats(physicalDevice, enabledFeatures);
+	}
+	textureStreamer.init(physicalDevice, logicDevice, memoryAllocator, settings.textureBudget, settings.framesInFlight, TEXTURE_LOAD_THREADS,
+		sampleableFormats);
+
+	for (const string &path : settings.texturePaths) {
+		textureStreamer.load(path);
+	}
+
+	for (uint32_t i = 0; i < settings.proceduralTextureCount; i++) {
+		//Checkers halve in size from one texture to the next, so the textures can be told apart.
+		uint32_t checkerSize = max(PROCEDURAL_TEXTURE_SIZE >> (i % 8 + 1), 1u);
+		uint8_t hue = static_cast<uint8_t>(i * 97);
+		textureStreamer.generate("procedural" + to_string(i), PROCEDURAL_TEXTURE_SIZE, PROCEDURAL_TEXTURE_SIZE,
+			[checkerSize, hue](uint32_t width, uint32_t height, uint8_t* pixels) {
+			for (uint32_t y = 0; y < height; y++) {
+				for (uint32_t x = 0; x < width; x++) {
+					bool dark = ((x / checkerSize) + (y / checkerSize)) % 2 == 1;
+					uint8_t* texel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+					texel[0] = dark ? 64 : 255;
+					texel[1] = dark ? hue : 255;
+					texel[2] = dark ? static_cast<uint8_t>(255 - hue) : 255;
+					texel[3] = 255;
+				}
+			}
+		});
+	}
+
+	textureReportTime = chrono::high_resolution_clock::now();
+}
+
+void Application::updateTextureUsage() {
+	uint32_t textureCount = textureStreamer.getTextureCount();
+	if (textureCount == 0) {
+		return;
+	}
+
+	//Texture coordinates repeat once per mesh unit, which the vertex shader scales by meshTransform.w. Clip space
+	//spans 2 units over the height of the image.
+	float aspect = static_cast<float>(swapChainExtent.height) / swapChainExtent.width;
+	uint32_t screenSize = static_cast<uint32_t>(ceil(drawConstants.meshTransform.w * swapChainExtent.height * 0.5f));
+
+	//Every object has the same size on screen, only which textures are on screen at all changes.
+	vector<bool> used(textureCount, false);
+	uint32_t usedCount = 0;
+	for (size_t i = 0; i < objects.size() && usedCount < textureCount; i++) {
+		const glm::vec4 &sphere = objects[i].boundingSphere;
+		if (fabs(sphere.x) * aspect - sphere.w * aspect > 1.f || fabs(sphere.y) - sphere.w > 1.f) {
+			continue;
+		}
+
+		uint32_t textureIndex = instances[i].textureIndex;
+		if (!used[textureIndex]) {
+			used[textureIndex] = true;
+			usedCount++;
+			textureStreamer.setUsage(textureIndex, screenSize);
+		}
+	}
+}
+
+void Application::recordTextureUploads(VkCommandBuffer commandBuffer) {
+	CPU_PROFILE_SCOPE("Texture streaming");
+	updateTextureUsage();
+	textureStreamer.recordUploads(commandBuffer);
+
+	uint32_t textureCount = textureStreamer.getTextureCount();
+	vector<DescriptorAllocator::Binding> bindings;
+	for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
+		VkDescriptorImageInfo imageInfo = i < textureCount ? textureStreamer.getDescriptor(i) : textureStreamer.getDefaultDescriptor();
+		bindings.push_back(DescriptorAllocator::Binding::image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageInfo.sampler,
+			imageInfo.imageView, imageInfo.imageLayout, i));
+	}
+
+	//Streamed levels replace images, so the set is written for every frame instead of cached.
+	textureDescriptorSet = descriptorAllocator.allocateTransient(textureSetLayout);
+	descriptorAllocator.write(textureDescriptorSet, bindings);
+}
+
+void Application::loadMesh() {
+	//Cooked meshes are copied straight from the file mapping into the staging ring.
+	if (settings.meshPath.size() > 5 && settings.meshPath.compare(settings.meshPath.size() - 5, 5, ".mesh") == 0) {
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+		MeshFile meshFile;
+		meshFile.open(settings.meshPath);
+
+		meshIndexType = meshFile.getIndexType();
+		meshIndexCount = static_cast<uint32_t>(meshFile.getHeader().indexCount);
+		meshBoundingSphere = meshFile.getBoundingSphere();
+		uint64_t vertexCount = meshFile.getHeader().vertexCount;
+		createMeshBuffers(meshFile.getVertexData(), meshFile.getVertexDataSize(), meshFile.getIndexData(), meshFile.getIndexDataSize());
+
+		meshFile.close();
+
+		cout << "Mesh " << settings.meshPath << ": " << vertexCount << " vertices, " << meshIndexCount / 3 << " triangles, loaded in "
+			<< chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() << " ms" << endl;
+	}
+	else {
+		Mesh mesh;
+		MeshLoader::Stats stats;
+
+		if (settings.gridResolution > 0) {
+			mesh = Mesh::createGrid(settings.gridResolution);
+			MeshLoader::optimize(mesh, &stats);
+			stats.cornerCount = mesh.indices.size();
+			MeshLoader::printStats("grid", mesh, stats);
+		}
+		else if (settings.meshPath.empty()) {
+			mesh.vertices = quadVertices;
+			mesh.indices = quadIndices;
+			MeshLoader::optimize(mesh, &stats);
+			stats.cornerCount = quadIndices.size();
+			MeshLoader::printStats("quad", mesh, stats);
+		}
+		else {
+			mesh = MeshLoader::loadObj(settings.meshPath, &stats);
+			MeshLoader::printStats(settings.meshPath, mesh, stats);
+		}
+
+		//16 bit when every vertex is addressable with it, halves the index fetch bandwidth
+		vector<uint8_t> packedIndices = mesh.packIndices();
+
+		meshIndexType = mesh.getIndexType();
+		meshIndexCount = static_cast<uint32_t>(mesh.indices.size());
+		meshBoundingSphere = mesh.computeBoundingSphere();
+		createMeshBuffers(mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size(), packedIndices.data(), packedIndices.size());
+	}
+
+	if (meshIndexCount == 0) {
+		throw runtime_error("Mesh has no triangles!");
+	}
+}
+
+void Application::createMeshBuffers(const void* vertexData, VkDeviceSize vertexDataSize, const void* indexData, VkDeviceSize indexDataSize) {
+	createBuffer(vertexDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation);
+	uploadBuffer(vertexBuffer, vertexData, vertexDataSize);
+
+	createBuffer(indexDataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation);
+	uploadBuffer(indexBuffer, indexData, indexDataSize);
+}
+
+void Application::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	const char* src = static_cast<const char*>(data);
+	VkDeviceSize maxChunk = stagingRing.getCapacity() / 2;
+
+	while (size > 0) {
+		VkDeviceSize chunk = min(size, maxChunk);
+
+		StagingRing::Region region;
+		if (!stagingRing.allocate(chunk, 16, region)) {
+			//Only transfers read from the ring, once they are done all of it can be reused.
+			uploadQueue.flush();
+			uploadQueue.waitIdle();
+			stagingRing.reset();
+			stagingRing.allocate(chunk, 16, region);
+		}
+
+		memcpy(region.data, src, (size_t)chunk);
+		uploadQueue.copyBuffer(region.buffer, dstBuffer, chunk, region.offset, dstOffset, dstStage, dstAccess);
+
+		src += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+	}
+}
+
+void Application::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation) {
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(logicDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to create verteb buffer!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(logicDevice, buffer, &memReqs);
+
+	allocation = memoryAllocator.allocate(memReqs, properties);
+
+	if (vkBindBufferMemory(logicDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw runtime_error("Failed to bind buffer memory!");
+	}
+}
+
+void Application::createCommandBuffers() {
+	for (FrameCommands &frame : frameCommands) {
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = frame.primaryPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(logicDevice, &allocateInfo, &frame.primaryCommandBuffer) != VK_SUCCESS) {
+			throw runtime_error("Failed to create commandbuffers!");
+		}
+
+		frame.secondaryCommandBuffers.resize(frame.workerPools.size());
+		for (size_t i = 0; i < frame.workerPools.size(); i++) {
+			allocateInfo.commandPool = frame.workerPools[i];
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+			if (vkAllocateCommandBuffers(logicDevice, &allocateInfo, &frame.secondaryCommandBuffers[i]) != VK_SUCCESS) {
+				throw runtime_error("Failed to create commandbuffers!");
+			}
+		}
+	}
+}
+
+void Application::bindDrawState(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	VkDescriptorSet descriptorSets[] = { frameDescriptorSet, textureDescriptorSet };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, descriptorSets, 1, &frameUniformOffset);
+
+	//Every object draws the same mesh, so one push covers all draws recorded into this buffer.
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &drawConstants);
+
+	//Dynamic state isn't inherited by secondary command buffers, every buffer sets its own.
+	VkViewport viewport = {};
+	viewport.x = 0.f;
+	viewport.y = 0.f;
+	viewport.width = (float)swapChainExtent.width;
+	viewport.height = (float)swapChainExtent.height;
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapChainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	VkBuffer vertexBuffers[] = { vertexBuffer, instanceBuffers[frameIndex] };
+	VkDeviceSize offsets[] = { 0, 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, meshIndexType);
+}
+
+void Application::recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t begin, uint32_t end) {
+	bindDrawState(commandBuffer, frameIndex);
+
+	const vector<RenderQueue::Item> &items = opaqueQueue.getItems();
+	for (uint32_t i = begin; i < end; i++) {
+		uint32_t objectIndex = items[i].drawIndex;
+		const ObjectData &object = objects[objectIndex];
+		vkCmdDrawIndexed(commandBuffer, object.indexCount, 1, object.firstIndex, object.vertexOffset, objectIndex);
+	}
+}
+
+void Application::recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex) {
+	CPU_PROFILE_SCOPE("Record");
+	chrono::high_resolution_clock::time_point recordStart = chrono::high_resolution_clock::now();
+	FrameCommands &frame = frameCommands[frameIndex];
+
+	//The frame's fence has signalled, nothing recorded from these pools is in use anymore.
+	vkResetCommandPool(logicDevice, frame.primaryPool, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(frame.primaryCommandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw runtime_error("Failed to begin recording command buffer!");
+	}
+
+	//Queries are reset outside the render pass, before the first scope.
+	gpuProfiler.beginFrame(frame.primaryCommandBuffer, frameIndex);
+	uint32_t frameScope = gpuProfiler.beginScope(frame.primaryCommandBuffer, "Frame");
+
+	updateFrameUniforms();
+	updateInstanceBuffer(frameIndex);
+
+	uint32_t objectCount = static_cast<uint32_t>(objects.size());
+	bool parallel = isRecordingParallel(frameIndex);
+
+	if (settings.renderMode == RenderMode::CpuDraws) {
+		chrono::high_resolution_clock::time_point sortStart = chrono::high_resolution_clock::now();
+		buildOpaqueQueue();
+		sortMilliseconds += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - sortStart).count();
+	}
+
+	recordFrameIndex = frameIndex;
+	recordImageIndex = imageIndex;
+	renderGraph.setImage(colorResource, swapChainImages[imageIndex]);
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		renderGraph.setBuffer(drawBufferResource, gpuCulling.getDrawBuffer(frameIndex));
+		renderGraph.setBuffer(countBufferResource, gpuCulling.getCountBuffer(frameIndex));
+	}
+	if (settings.headless) {
+		renderGraph.setBuffer(readbackResource, offscreenTargets[imageIndex].readbackBuffer);
+	}
+	renderGraph.execute(frame.primaryCommandBuffer);
+
+	gpuProfiler.endScope(frame.primaryCommandBuffer, frameScope);
+
+	if (vkEndCommandBuffer(frame.primaryCommandBuffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to record command buffer!");
+	}
+
+	double milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - recordStart).count();
+	recordMilliseconds += milliseconds;
+	totalRecordMilliseconds += milliseconds;
+	if (++recordedFrames == RECORD_STATS_INTERVAL) {
+		const char* drawDescription = settings.renderMode == RenderMode::GpuDriven ? " GPU culled objects" :
+			settings.renderMode == RenderMode::Instanced ? " instances in one draw" : " draws";
+		cout << "Recorded " << objectCount << drawDescription << " on " << (parallel ? frame.workerPools.size() : 1) << " threads in "
+			<< recordMilliseconds / recordedFrames << " ms/frame" << endl;
+		if (settings.renderMode == RenderMode::CpuDraws) {
+			cout << (settings.sortDraws ? "Sorted " : "Queued unsorted ") << opaqueQueue.size() << " draws in " << sortMilliseconds / recordedFrames
+				<< " ms/frame (" << opaqueQueue.getSortPasses() << " radix passes)" << endl;
+		}
+		gpuProfiler.printStats();
+
+		if (textureStreamer.getTextureCount() > 0) {
+			TextureStreamer::Stats textureStats = textureStreamer.getStats();
+			chrono::high_resolution_clock::time_point now = chrono::high_resolution_clock::now();
+			double seconds = chrono::duration<double>(now - textureReportTime).count();
+			cout << "Textures: " << textureStats.fullyResidentCount << "/" << textureStats.textureCount << " fully resident, "
+				<< textureStats.residentBytes / (1024.0 * 1024.0) << "/" << textureStats.budgetBytes / (1024.0 * 1024.0) << " MB, uploading "
+				<< (textureStats.uploadBytes - reportedTextureUploadBytes) / (1024.0 * 1024.0) / seconds << " MB/s, "
+				<< textureStats.evictionCount << " levels evicted, " << textureStats.compressedCount << " compressed, "
+				<< textureStats.transcodedCount << " transcoded" << endl;
+			reportedTextureUploadBytes = textureStats.uploadBytes;
+			textureReportTime = now;
+		}
+
+		recordMilliseconds = 0.0;
+		sortMilliseconds = 0.0;
+		recordedFrames = 0;
+	}
+}
+
+bool Application::isRecordingParallel(uint32_t frameIndex) const {
+	return settings.renderMode == RenderMode::CpuDraws && objects.size() >= PARALLEL_RECORD_THRESHOLD && !frameCommands[frameIndex].workerPools.empty();
+}
+
+void Application::recordOpaquePass(VkCommandBuffer commandBuffer) {
+	FrameCommands &frame = frameCommands[recordFrameIndex];
+	uint32_t objectCount = static_cast<uint32_t>(objects.size());
+	bool parallel = isRecordingParallel(recordFrameIndex);
+
+	array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { 0.f, 0.f, 0.f, 1.f };
+	clearValues[1].depthStencil = { 1.f, 0 };
+	VkRenderPassBeginInfo renderPassBeginInfo = {};
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass = renderPass;
+	renderPassBeginInfo.framebuffer = swapChainFrameBuffers[recordImageIndex];
+	renderPassBeginInfo.renderArea.offset = { 0, 0 };
+	renderPassBeginInfo.renderArea.extent = swapChainExtent;
+	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassBeginInfo.pClearValues = clearValues.data();
+
+	//Secondary command buffers leave no room for timestamps inside the render pass, the scope wraps it.
+	uint32_t renderPassScope = gpuProfiler.beginScope(commandBuffer, "Render pass");
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	if (parallel) {
+		uint32_t chunkCount = static_cast<uint32_t>(frame.workerPools.size());
+
+		recordPool.parallelFor(objectCount, chunkCount, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+			CPU_PROFILE_SCOPE("Record chunk");
+			vkResetCommandPool(logicDevice, frame.workerPools[chunk], 0);
+
+			VkCommandBufferInheritanceInfo inheritanceInfo = {};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = renderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = swapChainFrameBuffers[recordImageIndex];
+
+			VkCommandBufferBeginInfo secondaryBeginInfo = {};
+			secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			VkCommandBuffer secondary = frame.secondaryCommandBuffers[chunk];
+			if (vkBeginCommandBuffer(secondary, &secondaryBeginInfo) != VK_SUCCESS) {
+				throw runtime_error("Failed to begin recording secondary command buffer!");
+			}
+
+			recordDraws(secondary, recordFrameIndex, begin, end);
+
+			if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+				throw runtime_error("Failed to record secondary command buffer!");
+			}
+		});
+
+		//parallelFor never makes more chunks than draws
+		chunkCount = min(chunkCount, objectCount);
+		vkCmdExecuteCommands(commandBuffer, chunkCount, frame.secondaryCommandBuffers.data());
+	}
+	else if (settings.renderMode == RenderMode::GpuDriven) {
+		bindDrawState(commandBuffer, recordFrameIndex);
+		gpuCulling.recordDraw(commandBuffer, recordFrameIndex);
+	}
+	else if (settings.renderMode == RenderMode::Instanced) {
+		//Every object draws the same mesh range, so one draw covers the whole scene.
+		bindDrawState(commandBuffer, recordFrameIndex);
+		vkCmdDrawIndexed(commandBuffer, meshIndexCount, objectCount, 0, 0, 0);
+	}
+	else {
+		recordDraws(commandBuffer, recordFrameIndex, 0, objectCount);
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+	gpuProfiler.endScope(commandBuffer, renderPassScope);
+}
+
+void Application::recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	//0 means tightly packed rows
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, offscreenTargets[imageIndex].readbackBuffer, 1, &region);
+}
+
+void Application::createSemaphores() {
+	imageAvailableSemaphores.resize(settings.framesInFlight);
+	renderFinishedSemaphores.resize(settings.framesInFlight);
+	inFlightFences.resize(settings.framesInFlight);
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (size_t i = 0; i < settings.framesInFlight; i++) {
+		if (vkCreateSemaphore(logicDevice, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(logicDevice, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(logicDevice, &fenceCreateInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+
+			throw runtime_error("Failed to create semaphores!");
+		}
+	}
+}
+
+QueueFamilyIndices Application::findQueueFamily(VkPhysicalDevice device) {
+	QueueFamilyIndices indices;
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+	vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+	int i = 0;
+	for (const VkQueueFamilyProperties& queueFamily : queueFamilies) {
+		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			indices.graphicsFamily = i;
+		}
+
+		VkBool32 presentSupport = false;
+		if (settings.headless) {
+			//Nothing is presented, the graphics family stands in for presentation.
+			presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		}
+		else {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
+
+		if (queueFamily.queueCount > 0 && presentSupport) {
+			indices.presentFamily = i;
+		}
+
+		if (indices.isComplete()) {
+			break;
+		}
+
+		i++;
+	}
+
+	//Prefer a transfer only family, those map to the DMA engines on discrete GPUs.
+	for (uint32_t j = 0; j < queueFamilyCount; j++) {
+		VkQueueFlags flags = queueFamilies[j].queueFlags;
+		if (queueFamilies[j].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			indices.transferFamily = j;
+			break;
+		}
+	}
+
+	if (indices.transferFamily == -1) {
+		indices.transferFamily = indices.graphicsFamily;
+	}
+
+	return indices;
+}
+
+SwapChainSupportDetails Application::querySwapChainSupport(VkPhysicalDevice device) {
+	SwapChainSupportDetails details;
+
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+	uint32_t formatCount = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+
+	if (formatCount != 0) {
+		details.formats.resize(formatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+	}
+
+	uint32_t presentModeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+	if (presentModeCount != 0) {
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+	}
+
+	return details;
+}
+
+VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const vector<VkSurfaceFormatKHR> &availableFormats) {
+	if (availableFormats.size() == 1 && availableFormats[0].format == VK_FORMAT_UNDEFINED) {
+		return { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	}
+
+	for (const VkSurfaceFormatKHR &availableFormat : availableFormats) {
+		if (availableFormat.format == VK_FORMAT_B8G8R8A8_UNORM && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			return availableFormat;
+		}
+	}
+
+	//TODO Create format ranking.
+	return availableFormats[0];
+}
+
+VkPresentModeKHR Application::chooseSwapPresentMode(const vector<VkPresentModeKHR> availablePresentModes) {
+	if (settings.presentMode != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+		if (find(availablePresentModes.begin(), availablePresentModes.end(), settings.presentMode) != availablePresentModes.end()) {
+			return settings.presentMode;
+		}
+		//FIFO is the only mode every surface supports.
+		cout << "Requested present mode is not supported, falling back to FIFO" << endl;
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	//Driver compability support
+	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	for (const VkPresentModeKHR &availablePresentMode : availablePresentModes) {
+		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+			return availablePresentMode;
+		}
+		else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+			bestMode = availablePresentMode;
+		}
+	}
+
+	return bestMode;
+}
+
+VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilites) {
+	if (capabilites.currentExtent.width != numeric_limits<uint32_t>::max()) {
+		return capabilites.currentExtent;
+	} else {
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+
+		VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+		actualExtent.width = max(capabilites.minImageExtent.width, min(capabilites.maxImageExtent.width, actualExtent.width));
+		actualExtent.height = max(capabilites.minImageExtent.height, min(capabilites.maxImageExtent.height, actualExtent.height));
+
+		return actualExtent;
+	}
+}
+
+string Application::getUnsuitableReason(VkPhysicalDevice device) {
+	QueueFamilyIndices indices = findQueueFamily(device);
+	if (indices.graphicsFamily < 0) {
+		return "no graphics queue";
+	}
+	if (indices.presentFamily < 0) {
+		return "no queue can present to the window";
+	}
+
+	if (!checkDeviceExtensionSupport(device)) {
+		return "missing swapchain support";
+	}
+
+	if (!settings.headless) {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) {
+			return "no surface formats or present modes";
+		}
+	}
+
+	if (!TextureStreamer::isDeviceSupported(device)) {
+		return "can't sample, blit and filter RGBA8 textures";
+	}
+
+	return "";
+}
+
+bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device) {
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	vector<const char*> requiredDeviceExtensions = getDeviceExtensions();
+	set<string> requiredExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
+
+	for (const VkExtensionProperties& extension : availableExtensions) {
+		requiredExtensions.erase(extension.extensionName);
+	}
+
+	return requiredExtensions.empty();
+}
+
+bool Application::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const VkExtensionProperties& extension : availableExtensions) {
+		if (strcmp(extension.extensionName, extensionName) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Application::checkValidationLayerSupport() {
+	uint32_t layerCount;
+	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+	vector<VkLayerProperties> availableLayers(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+	for (const char* layerName : validationLayers) {
+		bool layerFound = false;
+
+		for (const VkLayerProperties& layerProperties : availableLayers) {
+			if (strcmp(layerName, layerProperties.layerName) == 0) {
+				layerFound = true;
+				break;
+			}
+		}
+
+		if (!layerFound) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Headless mode needs no swapchain.
+vector<const char*> Application::getDeviceExtensions() {
+	if (settings.headless) {
+		return {};
+	}
+
+	return deviceExtensions;
+}
+
+vector<const char*> Application::getRequiredExtensions() {
+	vector<const char*> extensions;
+
+	//GLFW is never initialized in headless mode, and no surface extensions are needed.
+	if (!settings.headless) {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
+
+	if (enableValidationLayers) {
+		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
+
+	return extensions;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL Application::debugCallback(
+	VkDebugReportFlagsEXT flags,
+	VkDebugReportObjectTypeEXT objType,
+	uint64_t obj,
+	size_t location,
+	int32_t code,
+	const char* layerPrefix,
+	const char* msg,
+	void* userData) {
+
+	cerr << "validation layer: " << msg << endl;
+
+	// To test layers themself, use VK_TRUE
+	return VK_FALSE;
+}
+
+void Application::writePPM(const string &fileName, uint32_t width, uint32_t height, const uint8_t* pixels) {
+	ofstream file(fileName, ios::binary);
+
+	if (!file.is_open()) {
+		throw runtime_error("Failed to open " + fileName + "!");
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	vector<char> row(width * 3);
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++) {
+			row[x * 3 + 0] = static_cast<char>(src[x * 4 + 0]);
+			row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+			row[x * 3 + 2] = static_cast<char>(src[x * 4 + 2]);
+		}
+		file.write(row.data(), row.size());
+	}
+}
+
+void Application::deliverFrame(OffscreenTarget &target) {
+	if (target.pendingFrame < 0) {
+		return;
+	}
+
+	uint32_t frame = static_cast<uint32_t>(target.pendingFrame);
+	const uint8_t* pixels = static_cast<const uint8_t*>(target.readbackAllocation.mappedData);
+
+	if (frameCallback) {
+		frameCallback(frame, swapChainExtent.width, swapChainExtent.height, pixels);
+	}
+
+	if (!settings.outputPath.empty()) {
+		writePPM(settings.outputPath + to_string(frame) + ".ppm", swapChainExtent.width, swapChainExtent.height, pixels);
+	}
+
+	target.pendingFrame = -1;
+}
+
+void Application::drawOffscreenFrame() {
+	CPU_PROFILE_SCOPE("Frame");
+
+	uploadQueue.collect();
+
+	{
+		CPU_PROFILE_SCOPE("Wait for fence");
+		vkWaitForFences(logicDevice, 1, &inFlightFences[currentFrame], VK_TRUE, numeric_limits<uint64_t>::max());
+	}
+	framePacer.markComplete(static_cast<uint32_t>(currentFrame));
+	{
+		CPU_PROFILE_SCOPE("Frame limiter");
+		framePacer.waitForNextFrame();
+	}
+	framePacer.markInput(static_cast<uint32_t>(currentFrame));
+
+	stagingRing.beginFrame(static_cast<uint32_t>(currentFrame));
+	uniformRing.beginFrame(static_cast<uint32_t>(currentFrame));
+	descriptorAllocator.beginFrame(static_cast<uint32_t>(currentFrame));
+	textureStreamer.beginFrame(static_cast<uint32_t>(currentFrame), frameNumber);
+
+	uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+	OffscreenTarget &target = offscreenTargets[imageIndex];
+	{
+		CPU_PROFILE_SCOPE("Deliver frame");
+		deliverFrame(target);
+	}
+
+	FrameCommands &frame = frameCommands[currentFrame];
+	recordCommandBuffer(static_cast<uint32_t>(currentFrame), imageIndex);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &frame.primaryCommandBuffer;
+
+	{
+		CPU_PROFILE_SCOPE("Flush uploads");
+		uploadQueue.flush();
+	}
+
+	vkResetFences(logicDevice, 1, &inFlightFences[currentFrame]);
+
+	gpuProfiler.markSubmit(static_cast<uint32_t>(currentFrame));
+	{
+		CPU_PROFILE_SCOPE("Submit");
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+			throw runtime_error("Failed to submit draw command buffer!");
+		}
+	}
+	framePacer.markSubmit(static_cast<uint32_t>(currentFrame));
+	//Nothing is presented, the frame is handed off once it is submitted.
+	framePacer.markPresent(static_cast<uint32_t>(currentFrame));
+
+	target.pendingFrame = frameNumber;
+	frameNumber++;
+	currentFrame = (currentFrame + 1) % settings.framesInFlight;
+}
+
+void Application::renderHeadless() {
+	//Without a window there is nothing to close, default to a single frame.
+	uint32_t frameCount = settings.frameCount > 0 ? settings.frameCount : 1;
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	frameMilliseconds.reserve(frameCount);
+
+	while (frameNumber < frameCount) {
+		chrono::high_resolution_clock::time_point frameStart = chrono::high_resolution_clock::now();
+		drawOffscreenFrame();
+		frameMilliseconds.push_back(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - frameStart).count());
+	}
+
+	vkDeviceWaitIdle(logicDevice);
+
+	//The last frames in flight, oldest first.
+	for (size_t i = 0; i < settings.framesInFlight; i++) {
+		deliverFrame(offscreenTargets[(currentFrame + i) % settings.framesInFlight]);
+	}
+
+	headlessMilliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	uploadStats = uploadQueue.getStats();
+	memoryStats = memoryAllocator.getStats();
+	pipelineStats = pipelineManager.getStats();
+	if (textureStreamer.getTextureCount() > 0) {
+		TextureStreamer::Stats textureStats = textureStreamer.getStats();
+		cout << "Streamed " << textureStats.uploadBytes / (1024.0 * 1024.0) << " MB of texture levels in " << textureStats.uploadCount << " uploads, "
+			<< textureStats.fullyResidentCount << "/" << textureStats.textureCount << " textures fully resident, "
+			<< textureStats.residentBytes / (1024.0 * 1024.0) << " MB resident" << endl;
+		cout << textureStats.compressedCount << " textures compressed, saving "
+			<< (textureStats.uncompressedBytes - textureStats.residentBytes) / (1024.0 * 1024.0) << " MB over RGBA8" << endl;
+		if (textureStats.transcodedCount > 0) {
+			cout << textureStats.transcodedCount << " textures transcoded on the CPU at "
+				<< textureStats.transcodedBytes / (1024.0 * 1024.0) / (textureStats.transcodeMilliseconds / 1000.0) << " MB/s" << endl;
+		}
+	}
+	if (gpuProfiler.isEnabled()) {
+		gpuProfiler.flush();
+		gpuStats = gpuProfiler.getStats();
+	}
+	cout << "Rendered " << frameCount << " headless frames in " << headlessMilliseconds << " ms ("
+		<< frameCount * 1000.0 / headlessMilliseconds << " frames/s)" << endl;
+}
+
+void Application::drawFrame() {
+	CPU_PROFILE_SCOPE("Frame");
+
+	//Frees staging memory of finished uploads
+	uploadQueue.collect();
+
+	{
+		CPU_PROFILE_SCOPE("Wait for fence");
+		vkWaitForFences(logicDevice, 1, &inFlightFences[currentFrame], VK_TRUE, numeric_limits<uint64_t>::max());
+	}
+	framePacer.markComplete(static_cast<uint32_t>(currentFrame));
+	{
+		CPU_PROFILE_SCOPE("Frame limiter");
+		framePacer.waitForNextFrame();
+	}
+
+	//Input is sampled as late as possible, after waiting for the frame slot and the frame limit.
+	{
+		CPU_PROFILE_SCOPE("Poll events");
+		glfwPollEvents();
+	}
+	framePacer.markInput(static_cast<uint32_t>(currentFrame));
+
+	//Uploads flushed before this frame's last submit are done, their staging ranges can be reused.
+	stagingRing.beginFrame(static_cast<uint32_t>(currentFrame));
+	uniformRing.beginFrame(static_cast<uint32_t>(currentFrame));
+	descriptorAllocator.beginFrame(static_cast<uint32_t>(currentFrame));
+	textureStreamer.beginFrame(static_cast<uint32_t>(currentFrame), frameNumber);
+
+	destroyRetiredSwapChains(false);
+	updatePipelineReloads();
+
+	uint32_t imageIndex;
+	VkResult result;
+	{
+		CPU_PROFILE_SCOPE("Acquire");
+		result = vkAcquireNextImageKHR(logicDevice, swapChain, numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	}
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		recreateSwapChain();
+		return;
+	} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		throw runtime_error("Failed to acquire swap chain image!");
+	}
+
+	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	FrameCommands &frame = frameCommands[currentFrame];
+	recordCommandBuffer(static_cast<uint32_t>(currentFrame), imageIndex);
+
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &frame.primaryCommandBuffer;
+
+	//Uploads recorded this frame go ahead of it on the graphics queue
+	{
+		CPU_PROFILE_SCOPE("Flush uploads");
+		uploadQueue.flush();
+	}
+
+	vkResetFences(logicDevice, 1, &inFlightFences[currentFrame]);
+
+	gpuProfiler.markSubmit(static_cast<uint32_t>(currentFrame));
+	{
+		CPU_PROFILE_SCOPE("Submit");
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+			throw runtime_error("Failed to submit draw command buffer!");
+		}
+	}
+	framePacer.markSubmit(static_cast<uint32_t>(currentFrame));
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+
+	VkSwapchainKHR swapChains[] = { swapChain };
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = swapChains;
+	presentInfo.pImageIndices = &imageIndex;
+
+	presentInfo.pResults = nullptr;
+
+	{
+		CPU_PROFILE_SCOPE("Present");
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+	framePacer.markPresent(static_cast<uint32_t>(currentFrame));
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+		framebufferResized = false;
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
+		throw runtime_error("Failed to present swap chain image!");
+	}
+
+	frameNumber++;
+	currentFrame = (currentFrame + 1) % settings.framesInFlight;
+}
+
+void Application::mainLoop() {
+	//Main loop that loops as long as window close event is not pending.
+	while (!glfwWindowShouldClose(window) && (settings.frameCount == 0 || frameNumber < settings.frameCount)) {
+		drawFrame();
+	}
+
+	//Waiting for all operations to complete before exiting
+	vkDeviceWaitIdle(logicDevice);
+}
+
+void Application::writeTrace() {
+	ofstream file(settings.tracePath);
+	if (!file.is_open()) {
+		throw runtime_error("Failed to open trace file!");
+	}
+
+	file << "{\"traceEvents\":[" << endl << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Vulkan\"}}";
+
+	CpuProfiler::writeTraceEvents(file);
+	if (gpuProfiler.isEnabled()) {
+		gpuProfiler.flush();
+		gpuProfiler.writeTraceEvents(file);
+	}
+
+	file << endl << "]}" << endl;
+
+	if (!file) {
+		throw runtime_error("Failed to write trace file!");
+	}
+
+	cout << "Wrote trace to " << settings.tracePath << endl;
+}
+
+void Application::cleanup() {
+	destroyRetiredPipelines(true);
+
+	cleanupSwapChain();
+	destroyRetiredSwapChains(true);
+	cleanupPipeline();
+	//Waits for compiles in flight, they use the pipeline layouts and shaders.
+	pipelineManager.cleanup();
+	shaderLibrary.cleanup();
+	vkDestroyPipelineLayout(logicDevice, pipelineLayout, nullptr);
+
+	uploadQueue.cleanup();
+	stagingRing.cleanup(memoryAllocator);
+
+	uniformRing.cleanup(memoryAllocator);
+	textureStreamer.cleanup();
+
+	vkDestroyBuffer(logicDevice, indexBuffer, nullptr);
+	memoryAllocator.free(indexBufferAllocation);
+
+	vkDestroyBuffer(logicDevice, vertexBuffer, nullptr);
+	memoryAllocator.free(vertexBufferAllocation);
+
+	if (settings.renderMode == RenderMode::GpuDriven) {
+		gpuCulling.cleanup(memoryAllocator);
+	}
+
+	for (size_t i = 0; i < instanceBuffers.size(); i++) {
+		vkDestroyBuffer(logicDevice, instanceBuffers[i], nullptr);
+		memoryAllocator.free(instanceBufferAllocations[i]);
+	}
+
+	vkDestroyBuffer(logicDevice, objectBuffer, nullptr);
+	memoryAllocator.free(objectBufferAllocation);
+
+	for (size_t i = 0; i < settings.framesInFlight; i++) {
+		vkDestroySemaphore(logicDevice, imageAvailableSemaphores[i], nullptr);
+		vkDestroySemaphore(logicDevice, renderFinishedSemaphores[i], nullptr);
+		vkDestroyFence(logicDevice, inFlightFences[i], nullptr);
+	}
+
+	for (FrameCommands &frame : frameCommands) {
+		vkDestroyCommandPool(logicDevice, frame.primaryPool, nullptr);
+		for (VkCommandPool workerPool : frame.workerPools) {
+			vkDestroyCommandPool(logicDevice, workerPool, nullptr);
+		}
+	}
+
+	descriptorAllocator.cleanup();
+
+	if (!settings.tracePath.empty()) {
+		writeTrace();
+	}
+	gpuProfiler.cleanup();
+	pipelineCache.cleanup();
+	memoryAllocator.cleanup();
+	vkDestroyDevice(logicDevice, nullptr);
+	if (enableValidationLayers) {
+		DestroyDebugReportCallbackEXT(instance, callback, nullptr);
+	}
+
+	if (!settings.headless) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
+	vkDestroyInstance(instance, nullptr);
+
+	if (!settings.headless) {
+		glfwDestroyWindow(window);
+
+		glfwTerminate();
+	}
+}
+
+static VkPresentModeKHR parsePresentMode(const string &name) {
+	if (name == "fifo") {
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+	if (name == "fifo-relaxed") {
+		return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	}
+	if (name == "mailbox") {
+		return VK_PRESENT_MODE_MAILBOX_KHR;
+	}
+	if (name == "immediate") {
+		return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+	throw runtime_error("Unknown present mode " + name);
+}
+
+AppSettings parseArguments(int argc, char* argv[]) {
+	AppSettings settings;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (arg == "--objects" && i + 1 < argc) {
+			settings.objectCount = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--depth-layers" && i + 1 < argc) {
+			settings.depthLayers = static_cast<uint32_t>(stoul(argv[++i]));
+			if (settings.depthLayers == 0) {
+				throw runtime_error("--depth-layers must be at least 1");
+			}
+		}
+		else if (arg == "--unsorted-draws") {
+			settings.sortDraws = false;
+		}
+		else if (arg == "--device" && i + 1 < argc) {
+			settings.device = argv[++i];
+		}
+		else if (arg == "--dump-render-graph") {
+			settings.dumpRenderGraph = true;
+		}
+		else if (arg == "--mesh" && i + 1 < argc) {
+			settings.meshPath = argv[++i];
+		}
+		else if (arg == "--cpu-draws") {
+			settings.renderMode = RenderMode::CpuDraws;
+		}
+		else if (arg == "--instanced") {
+			settings.renderMode = RenderMode::Instanced;
+		}
+		else if (arg == "--instancing-benchmark") {
+			settings.instancingBenchmark = true;
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			settings.recordThreads = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--headless") {
+			settings.headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			settings.frameCount = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--output" && i + 1 < argc) {
+			settings.outputPath = argv[++i];
+		}
+		else if (arg == "--width" && i + 1 < argc) {
+			settings.width = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--height" && i + 1 < argc) {
+			settings.height = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--present-mode" && i + 1 < argc) {
+			settings.presentMode = parsePresentMode(argv[++i]);
+		}
+		else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			settings.framesInFlight = static_cast<uint32_t>(stoul(argv[++i]));
+			if (settings.framesInFlight < 1 || settings.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+				throw runtime_error("--frames-in-flight must be between 1 and " + to_string(MAX_FRAMES_IN_FLIGHT));
+			}
+		}
+		else if (arg == "--fps-limit" && i + 1 < argc) {
+			settings.fpsLimit = stod(argv[++i]);
+		}
+		else if (arg == "--trace" && i + 1 < argc) {
+			settings.tracePath = argv[++i];
+		}
+		else if (arg == "--hot-reload") {
+			settings.hotReload = true;
+		}
+		else if (arg == "--benchmark" && i + 1 < argc) {
+			settings.benchmarkPath = argv[++i];
+		}
+		else if (arg == "--benchmark-scene" && i + 1 < argc) {
+			Benchmark::Scene scene = Benchmark::parseScene(argv[++i]);
+			if (scene.framesInFlight < 1 || scene.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+				throw runtime_error("frames-in-flight must be between 1 and " + to_string(MAX_FRAMES_IN_FLIGHT));
+			}
+			settings.benchmarkScenes.push_back(scene);
+		}
+		else if (arg == "--texture" && i + 1 < argc) {
+			settings.texturePaths.push_back(argv[++i]);
+		}
+		else if (arg == "--procedural-textures" && i + 1 < argc) {
+			settings.proceduralTextureCount = static_cast<uint32_t>(stoul(argv[++i]));
+		}
+		else if (arg == "--texture-budget" && i + 1 < argc) {
+			settings.textureBudget = static_cast<VkDeviceSize>(stoull(argv[++i])) * 1024 * 1024;
+		}
+		else if (arg == "--transcode-textures") {
+			settings.transcodeTextures = true;
+		}
+		else {
+			throw runtime_error("Unknown argument " + arg);
+		}
+	}
+
+	if (settings.texturePaths.size() + settings.proceduralTextureCount > MAX_TEXTURES) {
+		throw runtime_error("At most " + to_string(MAX_TEXTURES) + " textures are supported");
+	}
+
+	return settings;
+}
@@ -0,0 +1,637 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/glm.hpp>
+
+#include "MemoryAllocator.h"
+#include "UploadQueue.h"
+#include "StagingRing.h"
+#include "UniformRing.h"
+#include "DescriptorAllocator.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "ThreadPool.h"
+#include "PipelineCache.h"
+#include "PipelineManager.h"
+#include "GpuCulling.h"
+#include "ShaderLibrary.h"
+#include "TextureStreamer.h"
+#include "RenderQueue.h"
+#include "RenderGraph.h"
+#include "RenderMode.h"
+#include "Benchmark.h"
+#include "Mesh.h"
+
+const int WIDTH = 800;
+const int HEIGHT = 600;
+
+// Upper bound for --frames-in-flight.
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Textures the fragment shader can sample, must match MAX_TEXTURES in shader.frag.
+const uint32_t MAX_TEXTURES = 16;
+
+// Runtime options, see parseArguments.
+struct AppSettings {
+	// Copies of the mesh in the scene, laid out on a grid that overflows the view so some get culled.
+	uint32_t objectCount = 1;
+	// Copies of the grid stacked from back to front that objectCount is spread over. Only the front one is
+	// visible, the others are overdraw that depth testing rejects.
+	uint32_t depthLayers = 1;
+	// Orders opaque draws by pipeline, material and front to back depth. Off draws in object order, which
+	// is back to front with depthLayers.
+	bool sortDraws = true;
+	RenderMode renderMode = RenderMode::GpuDriven;
+	// Threads recording secondary command buffers, 0 for one per hardware thread.
+	uint32_t recordThreads = 0;
+
+	// Frames the CPU may run ahead of the GPU, more hides CPU spikes at the cost of latency.
+	uint32_t framesInFlight = 2;
+	// Used when the surface supports it, MAX_ENUM picks MAILBOX, then IMMEDIATE, then FIFO.
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+	// CPU side frame rate cap, 0 for none.
+	double fpsLimit = 0.0;
+
+	// Index or part of the name of the physical device to use, the best ranked one when empty. Takes
+	// precedence over the VULKAN_DEVICE environment variable.
+	std::string device;
+
+	// Render into offscreen images without GLFW, a surface or a swapchain.
+	bool headless = false;
+	// Frames to render before exiting, 0 runs until the window is closed.
+	uint32_t frameCount = 0;
+	// Headless frames are written to <outputPath><frame>.ppm when set.
+	std::string outputPath;
+	uint32_t width = WIDTH;
+	uint32_t height = HEIGHT;
+	// OBJ or cooked .mesh file drawn by every object, the built in quad when empty.
+	std::string meshPath;
+	// Draws a grid mesh with this many cells per side instead of meshPath when non zero.
+	uint32_t gridResolution = 0;
+	// Animates by 1/60 s per frame instead of by wall time, so runs render the same images.
+	bool fixedTimeStep = false;
+	// Renders the scene headless with one draw per object and then instanced, and compares the two.
+	bool instancingBenchmark = false;
+	// CPU and GPU scope timings are written there as one Chrome trace on exit when set.
+	std::string tracePath;
+	// Rebuilds pipelines in the background when their compiled shaders change on disk. Ignored headless and
+	// in builds with embedded shaders.
+	bool hotReload = false;
+	// Runs benchmarkScenes headless and writes the results there as JSON when set.
+	std::string benchmarkPath;
+	// Prints the render graph's passes with their barriers and transient memory whenever it is built.
+	bool dumpRenderGraph = false;
+	// Benchmark::getDefaultScenes() when empty.
+	std::vector<Benchmark::Scene> benchmarkScenes;
+	// KTX2 or binary PPM files streamed in as textures, object i samples texture i % count. At most MAX_TEXTURES
+	// together with the procedural ones.
+	std::vector<std::string> texturePaths;
+	// Checkerboards generated on the texture loader threads, after texturePaths.
+	uint32_t proceduralTextureCount = 0;
+	// Device memory the resident texture levels may use, in bytes.
+	VkDeviceSize textureBudget = 128 * 1024 * 1024;
+	// Decodes compressed textures to RGBA8 on the CPU even where the device samples them natively.
+	bool transcodeTextures = false;
+};
+
+// Receives each headless frame as tightly packed RGBA8 rows.
+typedef std::function<void(uint32_t frame, uint32_t width, uint32_t height, const uint8_t* pixels)> FrameCallback;
+
+struct QueueFamilyIndices {
+	int graphicsFamily = -1;
+	int presentFamily = -1;
+	// Dedicated transfer family when the device has one, graphicsFamily otherwise.
+	int transferFamily = -1;
+
+	bool isComplete() {
+		return graphicsFamily > -1 && presentFamily > -1;
+	}
+};
+
+// Per object data in the object storage buffer read by the culling pass. Must match ObjectData in cull.comp.
+struct ObjectData {
+	// xyz center, w radius
+	glm::vec4 boundingSphere;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t padding;
+};
+
+// Per object vertex attributes, fetched once per instance from binding 1. Every draw, instanced or not,
+// passes the index of its first object as firstInstance.
+struct InstanceData {
+	// xy offset, z uniform scale, w depth
+	glm::vec4 offsetScale;
+	// Multiplied with the vertex color
+	glm::vec4 color;
+	// Slot in the fragment shader's texture array
+	uint32_t textureIndex;
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	// Locations follow the two Vertex attributes.
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 3> attributeDesc = {};
+		attributeDesc[0].binding = 1;
+		attributeDesc[0].location = 2;
+		attributeDesc[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDesc[0].offset = offsetof(InstanceData, offsetScale);
+
+		attributeDesc[1].binding = 1;
+		attributeDesc[1].location = 3;
+		attributeDesc[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDesc[1].offset = offsetof(InstanceData, color);
+
+		attributeDesc[2].binding = 1;
+		attributeDesc[2].location = 4;
+		attributeDesc[2].format = VK_FORMAT_R32_UINT;
+		attributeDesc[2].offset = offsetof(InstanceData, textureIndex);
+
+		return attributeDesc;
+	}
+};
+
+// Per frame uniform block, bound with a dynamic offset into the uniform ring. Must match FrameUniforms in shader.vert.
+struct FrameUniforms {
+	glm::mat4 viewProjection;
+};
+
+// Per draw push constants. Must match DrawConstants in shader.vert.
+struct DrawConstants {
+	// xyz mesh center, w scale fitting the mesh into one grid cell
+	glm::vec4 meshTransform;
+};
+
+// Command pools and buffers owned by one frame in flight.
+struct FrameCommands {
+	VkCommandPool primaryPool;
+	VkCommandBuffer primaryCommandBuffer;
+
+	// One pool and secondary command buffer per recording chunk, each chunk is recorded by a single thread.
+	std::vector<VkCommandPool> workerPools;
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+};
+
+// Device local color target and the host visible buffer it is copied back into, used in place
+// of a swapchain image in headless mode.
+struct OffscreenTarget {
+	Allocation imageAllocation;
+	VkBuffer readbackBuffer;
+	Allocation readbackAllocation;
+	// Frame whose copy is in flight, -1 when the buffer holds nothing unread.
+	int64_t pendingFrame = -1;
+};
+
+// Pipeline replaced by a hot reload, destroyed once no frame in flight can still reference it.
+struct RetiredPipeline {
+	VkPipeline pipeline;
+	// frameNumber when it was retired
+	uint32_t retiredFrame;
+};
+
+// Extent dependent objects replaced by a resize, destroyed once no frame in flight can still reference them.
+struct RetiredSwapChain {
+	VkSwapchainKHR swapChain;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> frameBuffers;
+	RenderGraph::Transients transients;
+	// frameNumber when it was retired
+	uint32_t retiredFrame;
+};
+
+struct SwapChainSupportDetails {
+	// Min/max of images in swapchain, min/max resolution..
+	VkSurfaceCapabilitiesKHR capabilities;
+	// Color depth, pixel formats
+	std::vector<VkSurfaceFormatKHR> formats;
+	// Condition for swapping images, as I understand i.e. v-sync?
+	std::vector<VkPresentModeKHR> presentModes;
+};
+
+// Renders the scene of its settings into a window, or headless into offscreen targets.
+class Application {
+
+public:
+	explicit Application(const AppSettings &settings);
+	void run();
+
+	// Called for every headless frame once its copy has completed, in frame order.
+	void setFrameCallback(FrameCallback callback);
+
+	// Wall time of the headless run, valid once run() returned.
+	double getHeadlessMilliseconds() const;
+
+	// CPU time spent recording command buffers, including the instance buffer updates.
+	double getRecordMilliseconds() const;
+
+	// Wall time of every headless frame, from the fence wait to the submit.
+	const std::vector<double>& getFrameMilliseconds() const;
+
+	// Time from the first scene upload until all of them completed, headless only.
+	double getUploadMilliseconds() const;
+
+	// The stats below are captured at the end of the headless run.
+	UploadQueue::Stats getUploadStats() const;
+
+	MemoryAllocator::Stats getMemoryStats() const;
+	PipelineManager::Stats getPipelineStats() const;
+	std::vector<GpuProfiler::ScopeStats> getGpuStats() const;
+	const std::string& getDeviceName() const;
+
+private:
+	AppSettings settings;
+
+	// Window instance, nullptr in headless mode
+	GLFWwindow * window = nullptr;
+
+	//Vulkan instance
+	VkInstance instance;
+
+	//Debug callback handler
+	VkDebugReportCallbackEXT callback;
+
+	//The physical device vulkan works with
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	std::string deviceName;
+
+	//Vulkan logical device
+	VkDevice logicDevice;
+
+	//Handle to the graphics queue
+	VkQueue graphicsQueue;
+
+	//Handle to the presentation queue
+	VkQueue presentQueue;
+
+	//Handle to the transfer queue, same as graphicsQueue if there is no dedicated transfer family
+	VkQueue transferQueue;
+
+	//Vulkan surface interface, VK_NULL_HANDLE in headless mode
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+	//Vulkan swapchain that handles the delivery of frames from the physical device to the surface.
+	VkSwapchainKHR swapChain;
+
+	//Swapchain images for reference til render operations, the offscreen images in headless mode
+	std::vector<VkImage> swapChainImages;
+
+	//Memory and readback buffers behind swapChainImages in headless mode
+	std::vector<OffscreenTarget> offscreenTargets;
+
+	FrameCallback frameCallback;
+
+	//Swapchain properties
+	VkFormat swapChainImageFormat;
+	VkExtent2D swapChainExtent;
+
+	//Image views to view the frames
+	std::vector<VkImageView> swapChainImageViews;
+
+	VkFormat depthFormat;
+
+	//Passes of a frame and their resources, rebuilt with the swapchain. Owns the depth buffer as a transient.
+	RenderGraph renderGraph;
+	RenderGraph::ResourceId colorResource;
+	RenderGraph::ResourceId depthResource;
+	RenderGraph::ResourceId drawBufferResource;
+	RenderGraph::ResourceId countBufferResource;
+	RenderGraph::ResourceId readbackResource;
+
+	//Frame in flight and image the graph's passes record for
+	uint32_t recordFrameIndex = 0;
+	uint32_t recordImageIndex = 0;
+
+	//Render pass
+	VkRenderPass renderPass;
+
+	//Graphics pipeline layout
+	VkPipelineLayout pipelineLayout;
+
+	//Graphics pipeline, owned by pipelineManager
+	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+
+	//Shared by every pipeline creation, loaded from and saved to PIPELINE_CACHE_PATH
+	PipelineCache pipelineCache;
+
+	//Compiles and owns every pipeline, on worker threads
+	PipelineManager pipelineManager;
+	PipelineManager::PipelineId graphicsPipelineId = 0;
+	PipelineManager::PipelineId cullPipelineId = 0;
+
+	//Compiled shaders, embedded or read from SHADER_DIRECTORY
+	ShaderLibrary shaderLibrary;
+
+	//Hot reload, only set when the shader files are watched
+	bool watchingShaders = false;
+	std::deque<RetiredPipeline> retiredPipelines;
+
+	//Framebuffers for swapchain
+	std::vector<VkFramebuffer> swapChainFrameBuffers;
+
+	//Replaced by resizes and waiting for the frames that used them
+	std::deque<RetiredSwapChain> retiredSwapChains;
+
+	//Swapchain recreation times, to measure resize latency
+	uint32_t recreateCount = 0;
+	double recreateTotalMilliseconds = 0.0;
+	double recreateMaxMilliseconds = 0.0;
+
+	//Sub-allocates buffer memory from large per memory type blocks
+	MemoryAllocator memoryAllocator;
+
+	//Batches buffer uploads on the transfer queue
+	UploadQueue uploadQueue;
+
+	//Persistently mapped staging memory, recycled per frame in flight
+	StagingRing stagingRing;
+
+	//Growable descriptor pools, owns every set layout and descriptor set
+	DescriptorAllocator descriptorAllocator;
+
+	//Per frame uniform blocks, all read through frameDescriptorSet with dynamic offsets
+	UniformRing uniformRing;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorSet frameDescriptorSet;
+
+	//Streams the textures of settings into a device memory budget, uploads are recorded into the frame's commands
+	TextureStreamer textureStreamer;
+	//Set 1, MAX_TEXTURES combined image samplers rewritten every frame, unused slots sample opaque white
+	VkDescriptorSetLayout textureSetLayout;
+	VkDescriptorSet textureDescriptorSet = VK_NULL_HANDLE;
+	//Upload bytes and time of the last stats report, for the upload bandwidth
+	uint64_t reportedTextureUploadBytes = 0;
+	std::chrono::high_resolution_clock::time_point textureReportTime;
+
+	//Dynamic offset of the FrameUniforms written for the frame being recorded
+	uint32_t frameUniformOffset = 0;
+	glm::mat4 viewProjection;
+
+	//Pushed wherever draw state is bound
+	DrawConstants drawConstants;
+
+	//Command buffers are re-recorded every frame, one set per frame in flight
+	std::vector<FrameCommands> frameCommands;
+
+	//Records secondary command buffers in parallel
+	ThreadPool recordPool;
+
+	//Objects in the scene, uploaded to objectBuffer
+	std::vector<ObjectData> objects;
+
+	//CPU recorded draws in the order they are recorded, rebuilt every frame
+	RenderQueue opaqueQueue;
+	double sortMilliseconds = 0.0;
+
+	//Object storage buffer read by the culling pass
+	VkBuffer objectBuffer;
+	Allocation objectBufferAllocation;
+
+	//Per object transform and color, copied into the frame's instance buffer every frame
+	std::vector<InstanceData> instances;
+
+	//Persistently mapped instance vertex buffers, one per frame in flight so the CPU never writes one the GPU reads
+	std::vector<VkBuffer> instanceBuffers;
+	std::vector<Allocation> instanceBufferAllocations;
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	//Compute frustum culling feeding indirect draws, only initialized in RenderMode::GpuDriven
+	GpuCulling gpuCulling;
+
+	//Optional device support for the GPU driven path
+	VkPhysicalDeviceFeatures enabledFeatures = {};
+	PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+
+	//Frame rate limit and latency timestamps
+	FramePacer framePacer;
+
+	//Timestamp queries around the passes of every frame
+	GpuProfiler gpuProfiler;
+
+	//Accumulated record time since the last report
+	double recordMilliseconds = 0.0;
+	uint32_t recordedFrames = 0;
+
+	//Record time and wall time of the whole headless run, for benchmarks
+	double totalRecordMilliseconds = 0.0;
+	double headlessMilliseconds = 0.0;
+	std::vector<double> frameMilliseconds;
+	double uploadMilliseconds = 0.0;
+	UploadQueue::Stats uploadStats;
+	MemoryAllocator::Stats memoryStats;
+	PipelineManager::Stats pipelineStats;
+	std::vector<GpuProfiler::ScopeStats> gpuStats;
+
+	//Mesh drawn by every object, only what drawing needs is kept once it is uploaded
+	VkIndexType meshIndexType;
+	uint32_t meshIndexCount = 0;
+	glm::vec4 meshBoundingSphere;
+
+	// Vertex buffer
+	VkBuffer vertexBuffer;
+
+	// Vertex buffer sub-allocated memory
+	Allocation vertexBufferAllocation;
+
+	// Index buffer
+	VkBuffer indexBuffer;
+
+	// Index buffer sub-allocated memory
+	Allocation indexBufferAllocation;
+
+	//Semaphores used to syncronize commandcalls accross operations
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+	std::vector<VkFence> inFlightFences;
+	size_t currentFrame = 0;
+
+	//Frames submitted since start
+	uint32_t frameNumber = 0;
+
+	bool framebufferResized = false;
+
+	void initWindow();
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+	void initVulkan();
+	void cleanupSwapChain();
+	void cleanupPipeline();
+
+	// Destroys retired swapchains no frame in flight can reference anymore, or all of them once the device is idle.
+	void destroyRetiredSwapChains(bool deviceIdle);
+
+	// Replaces the swapchain, its views and framebuffers without waiting for the device. The old ones
+	// are handed to createSwapChain as oldSwapchain and destroyed by destroyRetiredSwapChains.
+	void recreateSwapChain();
+
+	void createInstance();
+	void setupDebugCallback();
+	void createSurface();
+	void pickPhysicalDevice();
+	void createLogicalDevice();
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+	void createOffscreenTargets();
+	void cleanupOffscreenTargets();
+	void createImageViews();
+
+	// First depth only format the device can render to, depth stencil formats otherwise.
+	VkFormat findDepthFormat();
+
+	// Declares the frame's passes and creates its transients at swapChainExtent, recreated with the swapchain.
+	void createRenderGraph();
+	void createRenderPass();
+
+	// Graphics and culling pipeline layouts, they outlive render pass changes.
+	void createPipelineLayouts();
+
+	// Vertex layout of Vertex and InstanceData, the fixed function state and the current render pass.
+	PipelineKey getGraphicsPipelineKey();
+
+	// Requests every pipeline the render mode needs at once, they compile on the pipeline manager's workers
+	// while the scene is loaded and uploaded.
+	void prewarmPipelines();
+
+	// Picks up the prewarmed pipelines, only waits for compiles that have not finished yet.
+	void resolvePipelines();
+
+	// Starts watching the shader files when AppSettings::hotReload is set.
+	void startShaderReload();
+
+	// Called once per frame. Starts recompiling pipelines whose shaders changed and swaps in finished ones.
+	void updatePipelineReloads();
+
+	void destroyRetiredPipelines(bool deviceIdle);
+	void createFrameBuffers();
+	void createCommandPool();
+	void createScene();
+	void createObjectBuffer();
+	void createDescriptorSetLayout();
+	void createDescriptorSets();
+
+	// Aspect corrected clip space for x and y, z is scaled into the depth range.
+	void updateViewProjection();
+
+	// Clip space depth of the object's center.
+	float getViewDepth(const ObjectData &object) const;
+
+	// Fills opaqueQueue with every object, sorted unless settings.sortDraws is off.
+	void buildOpaqueQueue();
+
+	// Writes this frame's uniforms into the uniform ring. Only valid once the frame's fence has signalled.
+	void updateFrameUniforms();
+
+	void createInstanceBuffers();
+
+	// Writes this frame's instance data. Only valid once the frame's fence has signalled.
+	void updateInstanceBuffer(uint32_t frameIndex);
+
+	void createGpuCulling();
+
+	// Starts decoding and generating the textures of settings on the streamer's loader threads.
+	void loadTextures();
+
+	// Marks the textures of objects on screen as used, with the size their texture repeat covers on screen.
+	void updateTextureUsage();
+
+	// Streams texture levels in and writes this frame's texture descriptor set. Outside the render pass.
+	void recordTextureUploads(VkCommandBuffer commandBuffer);
+	void loadMesh();
+	void createMeshBuffers(const void* vertexData, VkDeviceSize vertexDataSize, const void* indexData, VkDeviceSize indexDataSize);
+
+	// Copies data through the staging ring into a device local buffer. Large uploads are split
+	// into chunks and only stall when more than the whole ring is in flight.
+	void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0,
+		VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation);
+	void createCommandBuffers();
+
+	// Binds the pipeline, frame uniforms, draw constants, dynamic state, mesh and the frame's instance buffer.
+	void bindDrawState(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Records the objects of opaqueQueue items [begin, end) with one draw each, the object index is passed as firstInstance.
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t begin, uint32_t end);
+
+	// Whether the CPU draws of the frame are recorded into secondary command buffers on recordPool.
+	bool isRecordingParallel(uint32_t frameIndex) const;
+
+	void recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex);
+
+	// The render pass drawing the scene for recordFrameIndex into recordImageIndex.
+	void recordOpaquePass(VkCommandBuffer commandBuffer);
+
+	// Copies the rendered image into its readback buffer, the render graph moves it to TRANSFER_SRC_OPTIMAL.
+	void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+	void createSemaphores();
+	QueueFamilyIndices findQueueFamily(VkPhysicalDevice device);
+	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
+	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes);
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilites);
+	// Empty when the renderer can run on the device, otherwise what is missing.
+	std::string getUnsuitableReason(VkPhysicalDevice device);
+	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+	bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
+	bool checkValidationLayerSupport();
+	std::vector<const char*> getDeviceExtensions();
+	std::vector<const char*> getRequiredExtensions();
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
+		VkDebugReportFlagsEXT flags,
+		VkDebugReportObjectTypeEXT objType,
+		uint64_t obj,
+		size_t location,
+		int32_t code,
+		const char* layerPrefix,
+		const char* msg,
+		void* userData);
+
+	// Binary PPM, drops the alpha channel.
+	static void writePPM(const std::string &fileName, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+	// Hands a completed readback to the callback and/or writes it to disk. The target's fence must have signalled.
+	void deliverFrame(OffscreenTarget &target);
+
+	// Renders into offscreen target currentFrame. No acquire or present, the readback of the frame that used
+	// the target last is delivered once its fence has signalled, so copies overlap with rendering.
+	void drawOffscreenFrame();
+
+	void renderHeadless();
+	void drawFrame();
+	void mainLoop();
+
+	// CPU and GPU scopes in one Chrome trace, both on the steady_clock timeline so stalls on either side line up.
+	// Opens in chrome://tracing and Perfetto. Only valid once the device is idle.
+	void writeTrace();
+
+	void cleanup();
+};
+
+// --objects N, --mesh file.obj, --cpu-draws, --instanced, --instancing-benchmark, --threads N, --headless, --frames N, --output prefix, --width N,
+// --height N, --present-mode fifo|fifo-relaxed|mailbox|immediate, --frames-in-flight N, --fps-limit N, --depth-layers N, --unsorted-draws,
+// --dump-render-graph, --device index|name, --trace file.json, --hot-reload, --benchmark results.json and --benchmark-scene spec (repeatable, see Benchmark::parseScene),
+// --texture file.ktx2|file.ppm (repeatable), --procedural-textures N, --texture-budget MB, --transcode-textures, unknown arguments
+// are rejected.
+AppSettings parseArguments(int argc, char* argv[]);
@@ -0,0 +1,362 @@
+#include "Benchmark.h"
+
+#include "Application.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+// Quotes and escapes text for a JSON string.
+static string jsonString(const string &text) {
+	string result = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			result += ' ';
+		}
+		else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+static void writeDistribution(ostream &out, const Benchmark::Distribution &distribution) {
+	out << "{\"samples\":" << distribution.sampleCount << ",\"min\":" << distribution.min << ",\"avg\":" << distribution.avg
+		<< ",\"stddev\":" << distribution.stddev << ",\"p50\":" << distribution.p50 << ",\"p90\":" << distribution.p90
+		<< ",\"p99\":" << distribution.p99 << ",\"max\":" << distribution.max << "}";
+}
+
+vector<Benchmark::Scene> Benchmark::getDefaultScenes() {
+	vector<Benchmark::Scene> scenes;
+
+	Scene scene;
+	scene.name = "draws-1k";
+	scenes.push_back(scene);
+
+	scene.name = "draws-10k";
+	scene.objectCount = 10000;
+	scenes.push_back(scene);
+
+	scene.name = "draws-10k-instanced";
+	scene.mode = "instanced";
+	scenes.push_back(scene);
+
+	scene = Scene();
+	scene.name = "vertices-1m";
+	scene.objectCount = 16;
+	scene.vertexCount = 65536;
+	scenes.push_back(scene);
+
+	scene = Scene();
+	scene.name = "frames-in-flight-3";
+	scene.framesInFlight = 3;
+	scenes.push_back(scene);
+
+	scene = Scene();
+	scene.name = "resolution-1080p";
+	scene.width = 1920;
+	scene.height = 1080;
+	scenes.push_back(scene);
+
+	//CPU recorded draws are sorted front to back every frame, compare with --unsorted-draws.
+	scene = Scene();
+	scene.name = "overdraw-8";
+	scene.mode = "cpu";
+	scene.depthLayers = 8;
+	scenes.push_back(scene);
+
+	scene = Scene();
+	scene.name = "record-threads-10k";
+	scene.objectCount = 10000;
+	scene.mode = "cpu";
+	scene.maxRecordThreads = 4;
+	scenes.push_back(scene);
+
+	return scenes;
+}
+
+Benchmark::Scene Benchmark::parseScene(const string &spec) {
+	Scene scene;
+	scene.name = spec;
+
+	stringstream stream(spec);
+	string pair;
+	while (getline(stream, pair, ',')) {
+		size_t separator = pair.find('=');
+		if (separator == string::npos) {
+			throw runtime_error("Benchmark scene option " + pair + " is not key=value!");
+		}
+
+		string key = pair.substr(0, separator);
+		string value = pair.substr(separator + 1);
+
+		if (key == "name") {
+			scene.name = value;
+		}
+		else if (key == "objects") {
+			scene.objectCount = static_cast<uint32_t>(stoul(value));
+		}
+		else if (key == "vertices") {
+			scene.vertexCount = static_cast<uint32_t>(stoul(value));
+		}
+		else if (key == "resolution") {
+			size_t x = value.find('x');
+			if (x == string::npos) {
+				throw runtime_error("Benchmark scene resolution " + value + " is not WxH!");
+			}
+			scene.width = static_cast<uint32_t>(stoul(value.substr(0, x)));
+			scene.height = static_cast<uint32_t>(stoul(value.substr(x + 1)));
+		}
+		else if (key == "frames-in-flight") {
+			scene.framesInFlight = static_cast<uint32_t>(stoul(value));
+		}
+		else if (key == "mode") {
+			if (value != "gpu" && value != "cpu" && value != "instanced") {
+				throw runtime_error("Unknown benchmark mode " + value + "!");
+			}
+			scene.mode = value;
+		}
+		else if (key == "layers") {
+			scene.depthLayers = static_cast<uint32_t>(stoul(value));
+		}
+		else if (key == "threads") {
+			scene.maxRecordThreads = static_cast<uint32_t>(stoul(value));
+			if (scene.maxRecordThreads == 0) {
+				throw runtime_error("Benchmark scene threads has to be at least 1!");
+			}
+		}
+		else {
+			throw runtime_error("Unknown benchmark scene option " + key + "!");
+		}
+	}
+
+	if (scene.objectCount == 0 || scene.width == 0 || scene.height == 0 || scene.depthLayers == 0) {
+		throw runtime_error("Benchmark scene " + spec + " renders nothing!");
+	}
+
+	return scene;
+}
+
+uint32_t Benchmark::getGridResolution(const Scene &scene) {
+	if (scene.vertexCount <= 4) {
+		return 0;
+	}
+
+	//(resolution + 1)^2 vertices
+	uint32_t rowLength = static_cast<uint32_t>(round(sqrt(static_cast<double>(scene.vertexCount))));
+	return max(rowLength, 2u) - 1;
+}
+
+Benchmark::Distribution Benchmark::computeDistribution(vector<double> samples) {
+	Distribution distribution;
+	if (samples.empty()) {
+		return distribution;
+	}
+
+	sort(samples.begin(), samples.end());
+
+	distribution.sampleCount = static_cast<uint32_t>(samples.size());
+	distribution.min = samples.front();
+	distribution.max = samples.back();
+	distribution.p50 = samples[samples.size() / 2];
+	distribution.p90 = samples[min(samples.size() - 1, samples.size() * 90 / 100)];
+	distribution.p99 = samples[min(samples.size() - 1, samples.size() * 99 / 100)];
+
+	for (double sample : samples) {
+		distribution.avg += sample;
+	}
+	distribution.avg /= samples.size();
+
+	for (double sample : samples) {
+		distribution.stddev += (sample - distribution.avg) * (sample - distribution.avg);
+	}
+	distribution.stddev = sqrt(distribution.stddev / samples.size());
+
+	return distribution;
+}
+
+uint64_t Benchmark::hashPixels(const uint8_t* pixels, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= pixels[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void Benchmark::writeJson(const string &fileName, const string &deviceName, const vector<Result> &results) {
+	ofstream file(fileName);
+	if (!file.is_open()) {
+		throw runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	file.precision(4);
+	file << fixed;
+	file << "{" << endl << "\"device\":" << jsonString(deviceName) << "," << endl << "\"warmupFrames\":" << WARMUP_FRAMES << ","
+		<< endl << "\"scenes\":[";
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &result = results[i];
+		const Scene &scene = result.scene;
+		double uploadSeconds = result.uploadMilliseconds / 1000.0;
+
+		file << (i > 0 ? "," : "") << endl << "{\"name\":" << jsonString(scene.name) << ",\"objects\":" << scene.objectCount
+			<< ",\"vertices\":" << scene.vertexCount << ",\"width\":" << scene.width << ",\"height\":" << scene.height
+			<< ",\"framesInFlight\":" << scene.framesInFlight << ",\"mode\":" << jsonString(scene.mode) << ",\"layers\":" << scene.depthLayers
+			<< "," << endl;
+
+		file << " \"frames\":" << result.frameCount << ",\"totalMs\":" << result.totalMilliseconds << ",\"frameMs\":";
+		writeDistribution(file, result.frameMilliseconds);
+		file << "," << endl;
+
+		file << " \"recordMs\":" << result.recordMilliseconds << ",\"recordSweep\":[";
+		for (size_t j = 0; j < result.recordSweep.size(); j++) {
+			file << (j > 0 ? "," : "") << "{\"threads\":" << result.recordSweep[j].threadCount << ",\"recordMs\":" << result.recordSweep[j].recordMilliseconds << "}";
+		}
+		file << "]," << endl;
+
+		file << " \"uploads\":{\"copies\":" << result.uploadCount << ",\"bytes\":" << result.uploadBytes << ",\"batches\":" << result.uploadBatches
+			<< ",\"ms\":" << result.uploadMilliseconds << ",\"uploadsPerSecond\":" << (uploadSeconds > 0.0 ? result.uploadCount / uploadSeconds : 0.0)
+			<< ",\"bytesPerSecond\":" << (uploadSeconds > 0.0 ? result.uploadBytes / uploadSeconds : 0.0) << "}," << endl;
+
+		file << " \"memory\":{\"reserved\":" << result.memoryReserved << ",\"used\":" << result.memoryUsed << ",\"blocks\":" << result.memoryBlockCount
+			<< ",\"allocations\":" << result.allocationCount << "}," << endl;
+
+		file << " \"pipelines\":{\"compiles\":" << result.pipelineCompileCount << ",\"compileMs\":" << result.pipelineCompileMilliseconds
+			<< ",\"waitMs\":" << result.pipelineWaitMilliseconds << "}," << endl;
+
+		file << " \"gpuMs\":{";
+		for (size_t j = 0; j < result.gpuScopes.size(); j++) {
+			const GpuProfiler::ScopeStats &stats = result.gpuScopes[j];
+			file << (j > 0 ? "," : "") << jsonString(stats.name) << ":{\"samples\":" << stats.sampleCount << ",\"min\":" << stats.minMilliseconds
+				<< ",\"avg\":" << stats.avgMilliseconds << ",\"p99\":" << stats.p99Milliseconds << ",\"max\":" << stats.maxMilliseconds << "}";
+		}
+		file << "}," << endl;
+
+		file << " \"imageHash\":\"" << hex << result.imageHash << dec << "\"}";
+	}
+
+	file << endl << "]}" << endl;
+
+	if (!file) {
+		throw runtime_error("Failed to write " + fileName + "!");
+	}
+
+	cout << "Wrote benchmark results to " << fileName << endl;
+}
+
+// One headless run of a scene with the settings derived from it.
+static Benchmark::Result runScene(const AppSettings &settings, const Benchmark::Scene &scene, string &deviceName) {
+	Benchmark::Result result;
+	result.scene = scene;
+	result.frameCount = settings.frameCount;
+
+	Application app(settings);
+	uint32_t lastFrame = settings.frameCount - 1;
+	app.setFrameCallback([&result, lastFrame](uint32_t frame, uint32_t width, uint32_t height, const uint8_t* pixels) {
+		if (frame == lastFrame) {
+			result.imageHash = Benchmark::hashPixels(pixels, static_cast<size_t>(width) * height * 4);
+		}
+	});
+	app.run();
+
+	const vector<double> &frameMilliseconds = app.getFrameMilliseconds();
+	result.totalMilliseconds = app.getHeadlessMilliseconds();
+	result.recordMilliseconds = app.getRecordMilliseconds() / settings.frameCount;
+	result.frameMilliseconds = Benchmark::computeDistribution(vector<double>(frameMilliseconds.begin() + Benchmark::WARMUP_FRAMES, frameMilliseconds.end()));
+
+	UploadQueue::Stats uploadStats = app.getUploadStats();
+	result.uploadCount = uploadStats.copyCount;
+	result.uploadBytes = uploadStats.byteCount;
+	result.uploadBatches = uploadStats.batchCount;
+	result.uploadMilliseconds = app.getUploadMilliseconds();
+
+	MemoryAllocator::Stats memoryStats = app.getMemoryStats();
+	result.memoryReserved = memoryStats.reserved;
+	result.memoryUsed = memoryStats.used;
+	result.memoryBlockCount = memoryStats.blockCount;
+	result.allocationCount = memoryStats.allocationCount;
+
+	PipelineManager::Stats pipelineStats = app.getPipelineStats();
+	result.pipelineCompileCount = pipelineStats.compileCount;
+	result.pipelineCompileMilliseconds = pipelineStats.compileMilliseconds;
+	result.pipelineWaitMilliseconds = pipelineStats.waitMilliseconds;
+
+	result.gpuScopes = app.getGpuStats();
+	deviceName = app.getDeviceName();
+
+	return result;
+}
+
+void Benchmark::run(AppSettings settings) {
+	settings.headless = true;
+	settings.outputPath.clear();
+	settings.meshPath.clear();
+	settings.fixedTimeStep = true;
+	settings.fpsLimit = 0.0;
+	if (settings.frameCount == 0) {
+		settings.frameCount = 300;
+	}
+
+	uint32_t warmupFrames = WARMUP_FRAMES;
+	if (settings.frameCount <= warmupFrames) {
+		throw runtime_error("Benchmarks need more than " + to_string(warmupFrames) + " frames!");
+	}
+
+	vector<Scene> scenes = settings.benchmarkScenes.empty() ? getDefaultScenes() : settings.benchmarkScenes;
+	vector<Result> results;
+	string deviceName;
+
+	for (const Scene &scene : scenes) {
+		cout << endl << "Benchmark " << scene.name << endl;
+
+		AppSettings sceneSettings = settings;
+		sceneSettings.objectCount = scene.objectCount;
+		sceneSettings.gridResolution = getGridResolution(scene);
+		sceneSettings.width = scene.width;
+		sceneSettings.height = scene.height;
+		sceneSettings.framesInFlight = scene.framesInFlight;
+		sceneSettings.depthLayers = scene.depthLayers;
+		if (scene.mode == "cpu") {
+			sceneSettings.renderMode = RenderMode::CpuDraws;
+		}
+		else if (scene.mode == "instanced") {
+			sceneSettings.renderMode = RenderMode::Instanced;
+		}
+		else {
+			sceneSettings.renderMode = RenderMode::GpuDriven;
+		}
+
+		//Without a sweep the scene runs once with the worker count of the settings.
+		uint32_t firstThreadCount = scene.maxRecordThreads > 0 ? 1 : settings.recordThreads;
+		uint32_t lastThreadCount = scene.maxRecordThreads > 0 ? scene.maxRecordThreads : settings.recordThreads;
+		vector<RecordTiming> recordSweep;
+		Result result;
+		for (uint32_t threadCount = firstThreadCount; threadCount <= lastThreadCount; threadCount++) {
+			sceneSettings.recordThreads = threadCount;
+			result = runScene(sceneSettings, scene, deviceName);
+			if (scene.maxRecordThreads > 0) {
+				RecordTiming timing;
+				timing.threadCount = threadCount;
+				timing.recordMilliseconds = result.recordMilliseconds;
+				recordSweep.push_back(timing);
+				cout << scene.name << ": " << result.recordMilliseconds << " ms/frame recording on " << threadCount << " threads" << endl;
+			}
+		}
+		result.recordSweep = recordSweep;
+		results.push_back(result);
+
+		cout << scene.name << ": " << result.frameMilliseconds.avg << " ms/frame avg, " << result.frameMilliseconds.p99 << " ms p99" << endl;
+	}
+
+	writeJson(settings.benchmarkPath, deviceName, results);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GpuProfiler.h"
+
+struct AppSettings;
+
+// Scenes and results of the headless benchmark, written as JSON so regressions can be tracked per commit.
+// Runs are deterministic: animation advances by a fixed step per frame and nothing is frame limited, so
+// the same scene renders the same images on any driver, including lavapipe and SwiftShader.
+class Benchmark {
+
+public:
+	// Frames at the start of every run left out of the frame time distribution, they include pipeline warm up.
+	static const uint32_t WARMUP_FRAMES = 10;
+
+	// One point of the parameter space, see parseScene.
+	struct Scene {
+		std::string name;
+		uint32_t objectCount = 1000;
+		// Vertices of the mesh every object draws, rounded to a square grid. 4 or less draws the built in quad.
+		uint32_t vertexCount = 4;
+		uint32_t width = 640;
+		uint32_t height = 480;
+		uint32_t framesInFlight = 2;
+		// gpu, cpu or instanced.
+		std::string mode = "gpu";
+		// Copies of the object grid stacked in depth, see AppSettings::depthLayers.
+		uint32_t depthLayers = 1;
+		// Runs the scene once per record worker count from 1 to this, 0 runs it once with AppSettings::recordThreads.
+		uint32_t maxRecordThreads = 0;
+	};
+
+	// CPU time spent recording per frame with a given number of record workers.
+	struct RecordTiming {
+		uint32_t threadCount = 0;
+		double recordMilliseconds = 0.0;
+	};
+
+	struct Distribution {
+		uint32_t sampleCount = 0;
+		double min = 0.0;
+		double avg = 0.0;
+		double stddev = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	struct Result {
+		Scene scene;
+		uint32_t frameCount = 0;
+		double totalMilliseconds = 0.0;
+		Distribution frameMilliseconds;
+		// Average over all frames, including the warm up.
+		double recordMilliseconds = 0.0;
+		// One entry per run of a scene with maxRecordThreads, the other results are those of the last run.
+		std::vector<RecordTiming> recordSweep;
+		// Mesh, object and instance uploads made before the first frame, and the time until they completed.
+		uint64_t uploadCount = 0;
+		uint64_t uploadBytes = 0;
+		uint64_t uploadBatches = 0;
+		double uploadMilliseconds = 0.0;
+		VkDeviceSize memoryReserved = 0;
+		VkDeviceSize memoryUsed = 0;
+		uint32_t memoryBlockCount = 0;
+		uint32_t allocationCount = 0;
+		// Pipeline compiles on the pipeline manager's workers, and how long startup waited for them.
+		uint32_t pipelineCompileCount = 0;
+		double pipelineCompileMilliseconds = 0.0;
+		double pipelineWaitMilliseconds = 0.0;
+		std::vector<GpuProfiler::ScopeStats> gpuScopes;
+		// FNV-1a of the last frame's pixels, changes whenever the rendered image does.
+		uint64_t imageHash = 0;
+	};
+
+	// Small and large draw counts, a high vertex count, more frames in flight, a high resolution, overdraw and
+	// CPU recording on 1 to 4 threads.
+	static std::vector<Scene> getDefaultScenes();
+
+	// Comma separated key=value pairs, every key is optional:
+	// name=text,objects=N,vertices=N,resolution=WxH,frames-in-flight=N,mode=gpu|cpu|instanced,layers=N,threads=N
+	static Scene parseScene(const std::string &spec);
+
+	// Cells per side of the grid mesh closest to scene.vertexCount, 0 for the built in quad.
+	static uint32_t getGridResolution(const Scene &scene);
+
+	static Distribution computeDistribution(std::vector<double> samples);
+
+	static uint64_t hashPixels(const uint8_t* pixels, size_t size);
+
+	static void writeJson(const std::string &fileName, const std::string &deviceName, const std::vector<Result> &results);
+
+	// Renders every scene of settings.benchmarkScenes, or the default ones, headless for settings.frameCount frames
+	// with one Application per run, and writes all results to settings.benchmarkPath.
+	static void run(AppSettings settings);
+};
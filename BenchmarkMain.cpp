@@ -0,0 +1,27 @@
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "Application.h"
+#include "Benchmark.h"
+
+using namespace std;
+
+// Entry point of the benchmark target. Takes the same arguments as the application and writes
+// benchmark.json unless --benchmark names another file.
+int main(int argc, char* argv[]) {
+	try {
+		AppSettings settings = parseArguments(argc, argv);
+		if (settings.benchmarkPath.empty()) {
+			settings.benchmarkPath = "benchmark.json";
+		}
+
+		Benchmark::run(settings);
+	}
+	catch (const exception& e) {
+		cerr << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "BlockAllocator.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+BlockAllocator::BlockAllocator(uint64_t size) : size(size) {
+	if (size > 0) {
+		freeRanges[0] = size;
+	}
+}
+
+uint64_t BlockAllocator::allocate(uint64_t allocSize, uint64_t alignment) {
+	if (allocSize == 0) {
+		return INVALID_OFFSET;
+	}
+	if (alignment == 0) {
+		alignment = 1;
+	}
+
+	//Best fit, smallest range that can hold the aligned allocation keeps the big ranges intact.
+	map<uint64_t, uint64_t>::iterator best = freeRanges.end();
+	uint64_t bestWaste = ~0ULL;
+
+	for (map<uint64_t, uint64_t>::iterator it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		uint64_t alignedOffset = (it->first + alignment - 1) & ~(alignment - 1);
+		uint64_t padding = alignedOffset - it->first;
+
+		if (it->second < padding || it->second - padding < allocSize) {
+			continue;
+		}
+
+		uint64_t waste = it->second - padding - allocSize;
+		if (waste < bestWaste) {
+			best = it;
+			bestWaste = waste;
+			if (waste == 0) {
+				break;
+			}
+		}
+	}
+
+	if (best == freeRanges.end()) {
+		return INVALID_OFFSET;
+	}
+
+	uint64_t rangeStart = best->first;
+	uint64_t rangeEnd = best->first + best->second;
+	uint64_t alignedOffset = (rangeStart + alignment - 1) & ~(alignment - 1);
+
+	//Alignment padding in front stays free for smaller allocations.
+	if (alignedOffset > rangeStart) {
+		best->second = alignedOffset - rangeStart;
+	}
+	else {
+		freeRanges.erase(best);
+	}
+	if (rangeEnd > alignedOffset + allocSize) {
+		freeRanges[alignedOffset + allocSize] = rangeEnd - (alignedOffset + allocSize);
+	}
+
+	allocations[alignedOffset] = allocSize;
+	used += allocSize;
+
+	return alignedOffset;
+}
+
+void BlockAllocator::free(uint64_t offset) {
+	map<uint64_t, uint64_t>::iterator it = allocations.find(offset);
+	if (it == allocations.end()) {
+		throw runtime_error("Freeing an offset that was never allocated!");
+	}
+
+	uint64_t allocSize = it->second;
+	allocations.erase(it);
+	used -= allocSize;
+
+	insertFreeRange(offset, allocSize);
+}
+
+void BlockAllocator::insertFreeRange(uint64_t start, uint64_t rangeSize) {
+	map<uint64_t, uint64_t>::iterator next = freeRanges.lower_bound(start);
+
+	//Merge with the following range
+	if (next != freeRanges.end() && start + rangeSize == next->first) {
+		rangeSize += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	//Merge with the preceding range
+	if (next != freeRanges.begin()) {
+		map<uint64_t, uint64_t>::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second == start) {
+			prev->second += rangeSize;
+			return;
+		}
+	}
+
+	freeRanges.insert(next, make_pair(start, rangeSize));
+}
+
+bool BlockAllocator::isEmpty() const {
+	return allocations.empty();
+}
+
+uint64_t BlockAllocator::getSize() const {
+	return size;
+}
+
+uint64_t BlockAllocator::getUsed() const {
+	return used;
+}
+
+BlockAllocator::Stats BlockAllocator::getStats() const {
+	Stats stats;
+	stats.size = size;
+	stats.used = used;
+	stats.allocationCount = static_cast<uint32_t>(allocations.size());
+	stats.freeRangeCount = static_cast<uint32_t>(freeRanges.size());
+
+	for (const pair<const uint64_t, uint64_t>& range : freeRanges) {
+		if (range.second > stats.largestFreeRange) {
+			stats.largestFreeRange = range.second;
+		}
+	}
+
+	uint64_t freeSize = size - used;
+	if (freeSize > 0) {
+		stats.fragmentation = 1.f - (float)stats.largestFreeRange / (float)freeSize;
+	}
+
+	return stats;
+}
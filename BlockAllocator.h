@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Sub-allocates offsets inside one fixed size range, i.e. a single VkDeviceMemory block.
+// Free space is kept as an address ordered list of ranges that are merged with their
+// neighbours on free. Has no Vulkan dependency so it can be exercised without a device.
+class BlockAllocator {
+
+public:
+	static const uint64_t INVALID_OFFSET = ~0ULL;
+
+	struct Stats {
+		uint64_t size = 0;
+		uint64_t used = 0;
+		uint64_t largestFreeRange = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeRangeCount = 0;
+		// 0 when all free space is one range, closer to 1 the more it is splintered.
+		float fragmentation = 0.f;
+	};
+
+	explicit BlockAllocator(uint64_t size);
+
+	// Returns the aligned offset of the allocation, INVALID_OFFSET if no free range fits.
+	// Alignment has to be a power of two.
+	uint64_t allocate(uint64_t size, uint64_t alignment);
+
+	// Offset has to be one returned by allocate.
+	void free(uint64_t offset);
+
+	bool isEmpty() const;
+	uint64_t getSize() const;
+	uint64_t getUsed() const;
+	Stats getStats() const;
+
+private:
+	uint64_t size;
+	uint64_t used = 0;
+
+	// Range start -> range size.
+	std::map<uint64_t, uint64_t> freeRanges;
+
+	// Aligned offset handed out -> allocation size.
+	std::map<uint64_t, uint64_t> allocations;
+
+	void insertFreeRange(uint64_t start, uint64_t rangeSize);
+};
@@ -0,0 +1,124 @@
+#include "CpuProfiler.h"
+
+#include <atomic>
+#include <ios>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Thread id 0 is the GPU in GpuProfiler's events.
+static const uint32_t FIRST_THREAD_ID = 1;
+
+struct CpuEvent {
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+struct ThreadEvents {
+	uint32_t threadId = 0;
+	string name;
+	vector<CpuEvent> events;
+	// Events ever recorded, the next one goes to head % THREAD_CAPACITY. Only the owning thread writes it.
+	atomic<uint64_t> head;
+
+	ThreadEvents() : events(CpuProfiler::THREAD_CAPACITY), head(0) {}
+};
+
+static atomic<bool> recording(false);
+
+// Rings outlive their threads so events of finished threads still make it into the trace.
+static mutex& registryMutex() {
+	static mutex registryMutex;
+	return registryMutex;
+}
+
+static vector<unique_ptr<ThreadEvents>>& registry() {
+	static vector<unique_ptr<ThreadEvents>> registry;
+	return registry;
+}
+
+static thread_local ThreadEvents* threadEvents = nullptr;
+
+static ThreadEvents& getThreadEvents() {
+	if (threadEvents == nullptr) {
+		lock_guard<mutex> lock(registryMutex());
+		unique_ptr<ThreadEvents> events(new ThreadEvents());
+		events->threadId = FIRST_THREAD_ID + static_cast<uint32_t>(registry().size());
+		events->name = "Thread " + to_string(events->threadId);
+		threadEvents = events.get();
+		registry().push_back(move(events));
+	}
+	return *threadEvents;
+}
+
+CpuProfiler::Scope::Scope(const char* name) : name(name) {
+	start = recording.load(memory_order_relaxed) ? now() : -1;
+}
+
+CpuProfiler::Scope::~Scope() {
+	if (start >= 0) {
+		record(name, start, now());
+	}
+}
+
+void CpuProfiler::setEnabled(bool enabled) {
+	recording.store(enabled, memory_order_relaxed);
+}
+
+bool CpuProfiler::isEnabled() {
+	return recording.load(memory_order_relaxed);
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+	ThreadEvents &events = getThreadEvents();
+	lock_guard<mutex> lock(registryMutex());
+	events.name = name;
+}
+
+int64_t CpuProfiler::now() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CpuProfiler::record(const char* name, int64_t start, int64_t end) {
+	ThreadEvents &events = getThreadEvents();
+
+	uint64_t head = events.head.load(memory_order_relaxed);
+	CpuEvent &event = events.events[head % THREAD_CAPACITY];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	events.head.store(head + 1, memory_order_release);
+}
+
+void CpuProfiler::writeTraceEvents(ostream &out) {
+	lock_guard<mutex> lock(registryMutex());
+
+	//Trace timestamps are in microseconds, steady_clock ones are too large for the default precision.
+	//The caller's formatting is restored once the events are written.
+	ios_base::fmtflags flags = out.flags();
+	streamsize precision = out.precision(3);
+	out << fixed;
+
+	for (const unique_ptr<ThreadEvents> &events : registry()) {
+		out << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << events->threadId
+			<< ",\"args\":{\"name\":\"" << events->name << "\"}}";
+
+		uint64_t head = events->head.load(memory_order_acquire);
+		uint64_t capacity = THREAD_CAPACITY;
+		uint64_t count = head < capacity ? head : capacity;
+
+		for (uint64_t i = head - count; i < head; i++) {
+			const CpuEvent &event = events->events[i % THREAD_CAPACITY];
+			out << "," << endl << "{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << events->threadId
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
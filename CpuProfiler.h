@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Scoped CPU timing for the render loop. Every thread records into its own fixed size ring of events,
+// so recording takes no locks. Only the first event of a thread registers its ring, under a mutex.
+// Defining NO_CPU_PROFILING compiles every CPU_PROFILE_SCOPE out. Otherwise a scope costs a relaxed
+// load while recording is disabled, and two clock reads while it is enabled.
+//
+// Usage: CPU_PROFILE_SCOPE("Acquire"); times the rest of the enclosing block. Names must be string literals.
+class CpuProfiler {
+
+public:
+	// Events kept per thread, older ones are overwritten.
+	static const uint32_t THREAD_CAPACITY = 32768;
+
+	class Scope {
+	public:
+		explicit Scope(const char* name);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name;
+		int64_t start;
+	};
+
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	// Names the calling thread in the trace, threads are "Thread N" otherwise.
+	static void setThreadName(const char* name);
+
+	// steady_clock nanoseconds, the timeline GpuProfiler maps GPU timestamps onto.
+	static int64_t now();
+
+	static void record(const char* name, int64_t start, int64_t end);
+
+	// Writes the recorded events as Chrome trace events, each preceded by a comma. Only valid while
+	// no thread is recording, i.e. on exit.
+	static void writeTraceEvents(std::ostream &out);
+};
+
+#ifdef NO_CPU_PROFILING
+#define CPU_PROFILE_SCOPE(name)
+#else
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_SCOPE(name) CpuProfiler::Scope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#endif
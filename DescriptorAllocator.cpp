@@ -0,0 +1,287 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+// Descriptors per set each pool reserves, by type. Sized for what the renderer uses, a pool that
+// runs out of one type early just makes the chain grow sooner.
+static const VkDescriptorPoolSize POOL_SIZE_RATIOS[] = {
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+};
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+// FNV-1a, fed one value at a time so struct padding never ends up in the hash.
+static void hashValue(uint64_t &hash, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		hash = (hash ^ ((value >> (i * 8)) & 0xff)) * FNV_PRIME;
+	}
+}
+
+template<typename T>
+static uint64_t handleValue(T handle) {
+	//Non dispatchable handles are pointers or 64 bit integers depending on the platform.
+	return (uint64_t)handle;
+}
+
+static bool isImageType(VkDescriptorType type) {
+	return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+		|| type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+static bool equalBindings(const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) {
+	return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+		&& a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+}
+
+static bool equalBindings(const DescriptorAllocator::Binding &a, const DescriptorAllocator::Binding &b) {
+	if (a.binding != b.binding || a.arrayElement != b.arrayElement || a.type != b.type) {
+		return false;
+	}
+	if (isImageType(a.type)) {
+		return a.imageInfo.sampler == b.imageInfo.sampler && a.imageInfo.imageView == b.imageInfo.imageView && a.imageInfo.imageLayout == b.imageInfo.imageLayout;
+	}
+	return a.bufferInfo.buffer == b.bufferInfo.buffer && a.bufferInfo.offset == b.bufferInfo.offset && a.bufferInfo.range == b.bufferInfo.range;
+}
+
+template<typename T>
+static bool equalBindings(const vector<T> &a, const vector<T> &b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (!equalBindings(a[i], b[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+DescriptorAllocator::Binding DescriptorAllocator::Binding::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	Binding result;
+	result.binding = binding;
+	result.type = type;
+	result.bufferInfo = { buffer, offset, range };
+	return result;
+}
+
+DescriptorAllocator::Binding DescriptorAllocator::Binding::image(uint32_t binding, VkDescriptorType type, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout,
+	uint32_t arrayElement) {
+	Binding result;
+	result.binding = binding;
+	result.arrayElement = arrayElement;
+	result.type = type;
+	result.imageInfo = { sampler, imageView, imageLayout };
+	return result;
+}
+
+void DescriptorAllocator::init(VkDevice logicDevice, uint32_t frameCount) {
+	this->logicDevice = logicDevice;
+	frameChains.resize(frameCount);
+	currentFrame = 0;
+}
+
+void DescriptorAllocator::cleanup() {
+	destroyChain(staticChain);
+	for (PoolChain &chain : frameChains) {
+		destroyChain(chain);
+	}
+	frameChains.clear();
+	sets.clear();
+
+	for (auto &entry : layouts) {
+		for (CachedLayout &cached : entry.second) {
+			vkDestroyDescriptorSetLayout(logicDevice, cached.layout, nullptr);
+		}
+	}
+	layouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorAllocator::getLayout(const vector<VkDescriptorSetLayoutBinding> &bindings) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (const VkDescriptorSetLayoutBinding &binding : bindings) {
+		hashValue(hash, binding.binding);
+		hashValue(hash, binding.descriptorType);
+		hashValue(hash, binding.descriptorCount);
+		hashValue(hash, binding.stageFlags);
+		hashValue(hash, (uint64_t)(uintptr_t)binding.pImmutableSamplers);
+	}
+
+	vector<CachedLayout> &candidates = layouts[hash];
+	for (const CachedLayout &cached : candidates) {
+		if (equalBindings(cached.bindings, bindings)) {
+			return cached.layout;
+		}
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	CachedLayout cached;
+	cached.bindings = bindings;
+	if (vkCreateDescriptorSetLayout(logicDevice, &layoutInfo, nullptr, &cached.layout) != VK_SUCCESS) {
+		throw runtime_error("Failed to create descriptor set layout!");
+	}
+
+	candidates.push_back(cached);
+	return cached.layout;
+}
+
+VkDescriptorSet DescriptorAllocator::getStaticSet(VkDescriptorSetLayout layout, const vector<Binding> &bindings) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	hashValue(hash, handleValue(layout));
+	for (const Binding &binding : bindings) {
+		hashValue(hash, binding.binding);
+		hashValue(hash, binding.arrayElement);
+		hashValue(hash, binding.type);
+		if (isImageType(binding.type)) {
+			hashValue(hash, handleValue(binding.imageInfo.sampler));
+			hashValue(hash, handleValue(binding.imageInfo.imageView));
+			hashValue(hash, binding.imageInfo.imageLayout);
+		}
+		else {
+			hashValue(hash, handleValue(binding.bufferInfo.buffer));
+			hashValue(hash, binding.bufferInfo.offset);
+			hashValue(hash, binding.bufferInfo.range);
+		}
+	}
+
+	vector<CachedSet> &candidates = sets[hash];
+	for (const CachedSet &cached : candidates) {
+		if (cached.layout == layout && equalBindings(cached.bindings, bindings)) {
+			return cached.set;
+		}
+	}
+
+	CachedSet cached;
+	cached.layout = layout;
+	cached.bindings = bindings;
+	cached.set = allocate(staticChain, layout);
+	write(cached.set, bindings);
+
+	candidates.push_back(cached);
+	return cached.set;
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex) {
+	currentFrame = frameIndex;
+
+	PoolChain &chain = frameChains[frameIndex];
+	//Pools after current were never touched since their last reset.
+	for (size_t i = 0; i <= chain.current && i < chain.pools.size(); i++) {
+		vkResetDescriptorPool(logicDevice, chain.pools[i], 0);
+	}
+	chain.current = 0;
+	chain.setCount = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout) {
+	return allocate(frameChains[currentFrame], layout);
+}
+
+void DescriptorAllocator::write(VkDescriptorSet set, const vector<Binding> &bindings) {
+	vector<VkWriteDescriptorSet> writes(bindings.size());
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		const Binding &binding = bindings[i];
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = binding.binding;
+		writes[i].dstArrayElement = binding.arrayElement;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = binding.type;
+		if (isImageType(binding.type)) {
+			writes[i].pImageInfo = &binding.imageInfo;
+		}
+		else {
+			writes[i].pBufferInfo = &binding.bufferInfo;
+		}
+	}
+
+	vkUpdateDescriptorSets(logicDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::getStats() const {
+	Stats stats;
+	stats.poolCount = static_cast<uint32_t>(staticChain.pools.size());
+	stats.staticSetCount = staticChain.setCount;
+	for (const PoolChain &chain : frameChains) {
+		stats.poolCount += static_cast<uint32_t>(chain.pools.size());
+		stats.transientSetCount += chain.setCount;
+	}
+	for (const auto &entry : layouts) {
+		stats.layoutCount += static_cast<uint32_t>(entry.second.size());
+	}
+	return stats;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain &chain, VkDescriptorSetLayout layout) {
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+
+	while (true) {
+		bool newPool = chain.current == chain.pools.size();
+		if (newPool) {
+			uint32_t shift = static_cast<uint32_t>(min(chain.pools.size(), size_t(16)));
+			uint32_t maxSets = INITIAL_SETS_PER_POOL << shift;
+			chain.pools.push_back(createPool(maxSets < MAX_SETS_PER_POOL ? maxSets : MAX_SETS_PER_POOL));
+		}
+
+		allocateInfo.descriptorPool = chain.pools[chain.current];
+
+		VkDescriptorSet set;
+		VkResult result = vkAllocateDescriptorSets(logicDevice, &allocateInfo, &set);
+		if (result == VK_SUCCESS) {
+			chain.setCount++;
+			return set;
+		}
+
+		//A full pool moves the chain on to the next one, a fresh pool failing means the layout can never fit.
+		if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || newPool) {
+			throw runtime_error("Failed to allocate descriptor set!");
+		}
+		chain.current++;
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets) {
+	vector<VkDescriptorPoolSize> poolSizes;
+	for (const VkDescriptorPoolSize &ratio : POOL_SIZE_RATIOS) {
+		poolSizes.push_back({ ratio.type, ratio.descriptorCount * maxSets });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = maxSets;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(logicDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw runtime_error("Failed to create descriptor pool!");
+	}
+	return pool;
+}
+
+void DescriptorAllocator::destroyChain(PoolChain &chain) {
+	for (VkDescriptorPool pool : chain.pools) {
+		vkDestroyDescriptorPool(logicDevice, pool, nullptr);
+	}
+	chain.pools.clear();
+	chain.current = 0;
+	chain.setCount = 0;
+}
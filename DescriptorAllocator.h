@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hands out descriptor sets from chains of descriptor pools that grow by adding pools instead of
+// failing once one is exhausted.
+// - Static sets never change once written. getStaticSet caches them by a hash of their layout and
+//   bindings, so asking for the same set twice returns the first one.
+// - Transient sets live for one frame. Each frame in flight has its own chain, and beginFrame resets
+//   all of its pools at once instead of freeing sets one by one.
+// Set layouts are cached the same way, so equal layouts are the same handle and compare equal.
+class DescriptorAllocator {
+
+public:
+	// One descriptor of a set, a buffer or an image depending on type.
+	struct Binding {
+		uint32_t binding = 0;
+		// Element of an arrayed binding
+		uint32_t arrayElement = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		VkDescriptorBufferInfo bufferInfo = {};
+		VkDescriptorImageInfo imageInfo = {};
+
+		static Binding buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+		static Binding image(uint32_t binding, VkDescriptorType type, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout,
+			uint32_t arrayElement = 0);
+	};
+
+	struct Stats {
+		uint32_t poolCount = 0;
+		uint32_t staticSetCount = 0;
+		uint32_t layoutCount = 0;
+		// Allocated since the frame's last reset, summed over all frames in flight.
+		uint32_t transientSetCount = 0;
+	};
+
+	void init(VkDevice logicDevice, uint32_t frameCount);
+	void cleanup();
+
+	VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+	// Allocates and writes the set on first use, later calls with equal arguments return the same set.
+	// Sets are only released by cleanup, so the resources they reference must not be recreated in between.
+	VkDescriptorSet getStaticSet(VkDescriptorSetLayout layout, const std::vector<Binding> &bindings);
+
+	// Call once the fence of frameIndex has signalled, resets the pools of that frame's transient sets.
+	void beginFrame(uint32_t frameIndex);
+
+	// Valid until beginFrame is called with the same frame index again. Not written.
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+	// Writes bindings into set, i.e. a transient set.
+	void write(VkDescriptorSet set, const std::vector<Binding> &bindings);
+
+	Stats getStats() const;
+
+private:
+	// Sets in the first pool of a chain, each pool added doubles it up to MAX_SETS_PER_POOL.
+	static const uint32_t INITIAL_SETS_PER_POOL = 64;
+	static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+	struct PoolChain {
+		std::vector<VkDescriptorPool> pools;
+		// Pool allocations currently go to, pools after it are reset and unused.
+		size_t current = 0;
+		uint32_t setCount = 0;
+	};
+
+	struct CachedLayout {
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		VkDescriptorSetLayout layout;
+	};
+
+	struct CachedSet {
+		VkDescriptorSetLayout layout;
+		std::vector<Binding> bindings;
+		VkDescriptorSet set;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+
+	PoolChain staticChain;
+	std::vector<PoolChain> frameChains;
+	uint32_t currentFrame = 0;
+
+	// Keyed by hash, entries sharing a hash are told apart by comparing their contents.
+	std::unordered_map<uint64_t, std::vector<CachedLayout>> layouts;
+	std::unordered_map<uint64_t, std::vector<CachedSet>> sets;
+
+	VkDescriptorSet allocate(PoolChain &chain, VkDescriptorSetLayout layout);
+	VkDescriptorPool createPool(uint32_t maxSets);
+	void destroyChain(PoolChain &chain);
+};
@@ -0,0 +1,250 @@
+#include "DeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+
+using namespace std;
+
+//One point per 64 MB, up to 16 GB. Integrated GPUs report system memory as device local, the cap keeps them below.
+static const VkDeviceSize MEMORY_SCORE_UNIT = 64ull * 1024 * 1024;
+static const uint32_t MAX_MEMORY_SCORE = 256;
+
+static const uint32_t TRANSFER_QUEUE_SCORE = 40;
+static const uint32_t COMPUTE_QUEUE_SCORE = 20;
+static const uint32_t MULTI_DRAW_INDIRECT_SCORE = 40;
+static const uint32_t DRAW_INDIRECT_COUNT_SCORE = 40;
+static const uint32_t TEXTURE_COMPRESSION_BC_SCORE = 30;
+static const uint32_t TEXTURE_COMPRESSION_ASTC_SCORE = 10;
+
+static const uint32_t MAX_FEATURE_SCORE = MAX_MEMORY_SCORE + TRANSFER_QUEUE_SCORE + COMPUTE_QUEUE_SCORE + MULTI_DRAW_INDIRECT_SCORE
+	+ DRAW_INDIRECT_COUNT_SCORE + TEXTURE_COMPRESSION_BC_SCORE + TEXTURE_COMPRESSION_ASTC_SCORE;
+
+//Types are TYPE_SCORE_STEP apart, more than all other points together, so the rest only breaks ties within a type.
+static const uint32_t TYPE_SCORE_STEP = 1000;
+static const uint32_t DISCRETE_SCORE = 4 * TYPE_SCORE_STEP;
+static const uint32_t INTEGRATED_SCORE = 3 * TYPE_SCORE_STEP;
+static const uint32_t VIRTUAL_SCORE = 2 * TYPE_SCORE_STEP;
+static const uint32_t OTHER_SCORE = TYPE_SCORE_STEP;
+static const uint32_t CPU_SCORE = 0;
+static_assert(MAX_FEATURE_SCORE < TYPE_SCORE_STEP, "Feature points must not outweigh the device type");
+
+static string toLower(string text) {
+	transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return text;
+}
+
+DeviceSelector::Candidate DeviceSelector::describe(VkPhysicalDevice device) {
+	Candidate candidate;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	candidate.name = properties.deviceName;
+	candidate.type = properties.deviceType;
+
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(device, &memProperties);
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			candidate.deviceLocalBytes = max(candidate.deviceLocalBytes, memProperties.memoryHeaps[i].size);
+		}
+	}
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+	vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+	for (const VkQueueFamilyProperties &queueFamily : queueFamilies) {
+		if (queueFamily.queueCount == 0) {
+			continue;
+		}
+		VkQueueFlags flags = queueFamily.queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			candidate.transferQueue = true;
+		}
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+			candidate.computeQueue = true;
+		}
+	}
+
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(device, &features);
+	candidate.multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+	candidate.textureCompressionBC = features.textureCompressionBC == VK_TRUE;
+	candidate.textureCompressionASTC = features.textureCompressionASTC_LDR == VK_TRUE;
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+	for (const VkExtensionProperties &extension : extensions) {
+		if (strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0) {
+			candidate.drawIndirectCount = true;
+		}
+	}
+
+	return candidate;
+}
+
+uint32_t DeviceSelector::score(const Candidate &candidate) {
+	uint32_t score = 0;
+	switch (candidate.type) {
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		score += DISCRETE_SCORE;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		score += INTEGRATED_SCORE;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		score += VIRTUAL_SCORE;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		score += CPU_SCORE;
+		break;
+	default:
+		score += OTHER_SCORE;
+		break;
+	}
+
+	score += static_cast<uint32_t>(min<VkDeviceSize>(candidate.deviceLocalBytes / MEMORY_SCORE_UNIT, MAX_MEMORY_SCORE));
+
+	if (candidate.transferQueue) {
+		score += TRANSFER_QUEUE_SCORE;
+	}
+	if (candidate.computeQueue) {
+		score += COMPUTE_QUEUE_SCORE;
+	}
+	if (candidate.multiDrawIndirect) {
+		score += MULTI_DRAW_INDIRECT_SCORE;
+	}
+	if (candidate.drawIndirectCount) {
+		score += DRAW_INDIRECT_COUNT_SCORE;
+	}
+	if (candidate.textureCompressionBC) {
+		score += TEXTURE_COMPRESSION_BC_SCORE;
+	}
+	if (candidate.textureCompressionASTC) {
+		score += TEXTURE_COMPRESSION_ASTC_SCORE;
+	}
+	return score;
+}
+
+uint32_t DeviceSelector::select(vector<Candidate> &candidates, const string &preference) {
+	for (Candidate &candidate : candidates) {
+		candidate.score = score(candidate);
+	}
+
+	if (!preference.empty()) {
+		uint32_t selected = NONE;
+		bool isIndex = all_of(preference.begin(), preference.end(), [](unsigned char c) { return isdigit(c) != 0; });
+		if (isIndex) {
+			selected = static_cast<uint32_t>(stoul(preference));
+			if (selected >= candidates.size()) {
+				throw runtime_error("Failed to select device " + preference + ", there are only " + to_string(candidates.size()) + " devices!");
+			}
+		}
+		else {
+			//Suitable matches first, then the higher score.
+			string pattern = toLower(preference);
+			for (uint32_t i = 0; i < candidates.size(); i++) {
+				if (toLower(candidates[i].name).find(pattern) == string::npos) {
+					continue;
+				}
+				if (selected == NONE) {
+					selected = i;
+					continue;
+				}
+				const Candidate &best = candidates[selected];
+				bool suitable = candidates[i].unsuitableReason.empty();
+				bool bestSuitable = best.unsuitableReason.empty();
+				if ((suitable && !bestSuitable) || (suitable == bestSuitable && candidates[i].score > best.score)) {
+					selected = i;
+				}
+			}
+			if (selected == NONE) {
+				throw runtime_error("Failed to find a device matching " + preference + "!");
+			}
+		}
+
+		if (!candidates[selected].unsuitableReason.empty()) {
+			throw runtime_error("Failed to select device " + candidates[selected].name + ", " + candidates[selected].unsuitableReason + "!");
+		}
+		return selected;
+	}
+
+	//The first device wins ties, which keeps the loader's order.
+	uint32_t selected = NONE;
+	for (uint32_t i = 0; i < candidates.size(); i++) {
+		if (!candidates[i].unsuitableReason.empty()) {
+			continue;
+		}
+		if (selected == NONE || candidates[i].score > candidates[selected].score) {
+			selected = i;
+		}
+	}
+
+	if (selected == NONE) {
+		throw runtime_error("Failed to find a suitable GPU!");
+	}
+	return selected;
+}
+
+void DeviceSelector::print(ostream &out, const vector<Candidate> &candidates, uint32_t selected, const string &reason) {
+	//Memory in GB with one decimal. The caller's formatting is restored once the list is written.
+	ios_base::fmtflags flags = out.flags();
+	streamsize precision = out.precision(1);
+	out << fixed;
+
+	out << "Devices:" << endl;
+	for (uint32_t i = 0; i < candidates.size(); i++) {
+		const Candidate &candidate = candidates[i];
+		out << (i == selected ? "  * " : "    ") << i << " " << candidate.name << " (" << getTypeName(candidate.type) << ", "
+			<< candidate.deviceLocalBytes / (1024.0 * 1024.0 * 1024.0) << " GB device local";
+		if (candidate.transferQueue) {
+			out << ", transfer queue";
+		}
+		if (candidate.computeQueue) {
+			out << ", compute queue";
+		}
+		if (candidate.multiDrawIndirect) {
+			out << ", multi draw indirect";
+		}
+		if (candidate.drawIndirectCount) {
+			out << ", draw indirect count";
+		}
+		if (candidate.textureCompressionBC) {
+			out << ", BC";
+		}
+		if (candidate.textureCompressionASTC) {
+			out << ", ASTC";
+		}
+		out << "): ";
+		if (candidate.unsuitableReason.empty()) {
+			out << "score " << candidate.score << endl;
+		}
+		else {
+			out << "unsuitable, " << candidate.unsuitableReason << endl;
+		}
+	}
+	out << "Selected " << candidates[selected].name << " " << reason << endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+const char* DeviceSelector::getTypeName(VkPhysicalDeviceType type) {
+	switch (type) {
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return "discrete";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return "integrated";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return "virtual";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		return "CPU";
+	default:
+		return "other";
+	}
+}
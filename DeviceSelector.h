@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Ranks the physical devices the renderer can run on. The device type dominates the score, a discrete GPU always
+// beats an integrated one and anything beats a software rasterizer. Within a type the device local memory, a
+// transfer only queue family for uploads, a compute only family and the optional features the renderer uses
+// break the tie. Scoring works on Candidate alone, so rankings can be checked without the devices.
+class DeviceSelector {
+
+public:
+	static const uint32_t NONE = ~0u;
+
+	struct Candidate {
+		std::string name;
+		VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+		// Largest heap with VK_MEMORY_HEAP_DEVICE_LOCAL_BIT
+		VkDeviceSize deviceLocalBytes = 0;
+		bool transferQueue = false;
+		bool computeQueue = false;
+		bool multiDrawIndirect = false;
+		bool drawIndirectCount = false;
+		bool textureCompressionBC = false;
+		bool textureCompressionASTC = false;
+		// Empty when the renderer can run on the device, set by the caller.
+		std::string unsuitableReason;
+		// Filled by select
+		uint32_t score = 0;
+	};
+
+	// Everything but unsuitableReason.
+	static Candidate describe(VkPhysicalDevice device);
+
+	static uint32_t score(const Candidate &candidate);
+
+	// Scores all candidates and returns the index of the best suitable one. preference overrides the ranking with
+	// an index into candidates or a case insensitive part of a device name, ties between matching names go to the
+	// higher score. Throws when nothing is suitable or the preferred device is missing or unsuitable.
+	static uint32_t select(std::vector<Candidate> &candidates, const std::string &preference);
+
+	// One line per candidate with its score or why it was skipped, then the selected device and why.
+	static void print(std::ostream &out, const std::vector<Candidate> &candidates, uint32_t selected, const std::string &reason);
+
+	static const char* getTypeName(VkPhysicalDeviceType type);
+};
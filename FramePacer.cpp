@@ -0,0 +1,106 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// Sleeping is only accurate to the scheduler tick, the last stretch before a deadline is spun.
+static const chrono::microseconds SPIN_TIME(2000);
+
+static double millisecondsBetween(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end) {
+	return chrono::duration<double, milli>(end - start).count();
+}
+
+void FramePacer::LatencyStats::add(double milliseconds) {
+	totalMilliseconds += milliseconds;
+	maxMilliseconds = max(maxMilliseconds, milliseconds);
+	count++;
+}
+
+double FramePacer::LatencyStats::average() const {
+	return count > 0 ? totalMilliseconds / count : 0.0;
+}
+
+void FramePacer::init(uint32_t frameCount, double fpsLimit, uint32_t reportInterval) {
+	frames.assign(frameCount, FrameTimestamps());
+	this->reportInterval = reportInterval;
+
+	limited = fpsLimit > 0.0;
+	if (limited) {
+		frameInterval = chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / fpsLimit));
+	}
+
+	nextFrame = Clock::now();
+	reportStart = nextFrame;
+}
+
+void FramePacer::waitForNextFrame() {
+	if (!limited) {
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (now > nextFrame + frameInterval) {
+		nextFrame = now;
+	}
+
+	if (now < nextFrame) {
+		Clock::time_point spinStart = nextFrame - SPIN_TIME;
+		if (now < spinStart) {
+			this_thread::sleep_until(spinStart);
+		}
+		while (Clock::now() < nextFrame) {
+			this_thread::yield();
+		}
+	}
+
+	nextFrame += frameInterval;
+}
+
+void FramePacer::markInput(uint32_t frameIndex) {
+	frames[frameIndex].input = Clock::now();
+}
+
+void FramePacer::markSubmit(uint32_t frameIndex) {
+	FrameTimestamps &frame = frames[frameIndex];
+	frame.submit = Clock::now();
+	inputToSubmit.add(millisecondsBetween(frame.input, frame.submit));
+}
+
+void FramePacer::markPresent(uint32_t frameIndex) {
+	FrameTimestamps &frame = frames[frameIndex];
+	frame.present = Clock::now();
+	frame.pending = true;
+	inputToPresent.add(millisecondsBetween(frame.input, frame.present));
+
+	if (reportInterval > 0 && ++reportFrames == reportInterval) {
+		report();
+	}
+}
+
+void FramePacer::markComplete(uint32_t frameIndex) {
+	FrameTimestamps &frame = frames[frameIndex];
+	if (!frame.pending) {
+		return;
+	}
+
+	frame.pending = false;
+	inputToComplete.add(millisecondsBetween(frame.input, Clock::now()));
+}
+
+void FramePacer::report() {
+	Clock::time_point now = Clock::now();
+	double seconds = chrono::duration<double>(now - reportStart).count();
+
+	cout << "Frame pacing: " << reportFrames / seconds << " frames/s, " << frames.size() << " frames in flight, input to submit "
+		<< inputToSubmit.average() << " ms, to present " << inputToPresent.average() << " ms (max " << inputToPresent.maxMilliseconds
+		<< "), to GPU done " << inputToComplete.average() << " ms (max " << inputToComplete.maxMilliseconds << ")" << endl;
+
+	reportFrames = 0;
+	reportStart = now;
+	inputToSubmit = LatencyStats();
+	inputToPresent = LatencyStats();
+	inputToComplete = LatencyStats();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// CPU side frame limiting and latency measurement. Every frame in flight slot carries the time its
+// input was sampled, its submit and its present. The time to GPU completion is taken when the slot's
+// fence is next seen signalled, which makes it an upper bound.
+class FramePacer {
+
+public:
+	// fpsLimit 0 renders as fast as the present mode allows. Stats are printed every reportInterval frames, 0 never.
+	void init(uint32_t frameCount, double fpsLimit, uint32_t reportInterval);
+
+	// Sleeps until the next frame may start. A frame that starts late resets the schedule instead of
+	// being made up with a burst of short frames.
+	void waitForNextFrame();
+
+	void markInput(uint32_t frameIndex);
+	void markSubmit(uint32_t frameIndex);
+	void markPresent(uint32_t frameIndex);
+
+	// Call right after the fence of frameIndex was waited on, completes the frame that last used the slot.
+	void markComplete(uint32_t frameIndex);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct FrameTimestamps {
+		Clock::time_point input;
+		Clock::time_point submit;
+		Clock::time_point present;
+		bool pending = false;
+	};
+
+	struct LatencyStats {
+		double totalMilliseconds = 0.0;
+		double maxMilliseconds = 0.0;
+		uint32_t count = 0;
+
+		void add(double milliseconds);
+		double average() const;
+	};
+
+	std::vector<FrameTimestamps> frames;
+
+	bool limited = false;
+	Clock::duration frameInterval;
+	Clock::time_point nextFrame;
+
+	uint32_t reportInterval = 0;
+	uint32_t reportFrames = 0;
+	Clock::time_point reportStart;
+	LatencyStats inputToSubmit;
+	LatencyStats inputToPresent;
+	LatencyStats inputToComplete;
+
+	void report();
+};
@@ -0,0 +1,180 @@
+#include "GpuCulling.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+void GpuCulling::init(VkDevice logicDevice, DescriptorAllocator &descriptorAllocator) {
+	this->logicDevice = logicDevice;
+
+	vector<VkDescriptorSetLayoutBinding> bindings(3);
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	descriptorSetLayout = descriptorAllocator.getLayout(bindings);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(logicDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw runtime_error("Failed to create culling pipeline layout!");
+	}
+}
+
+void GpuCulling::createBuffers(MemoryAllocator &memoryAllocator, DescriptorAllocator &descriptorAllocator, VkBuffer objectBuffer, uint32_t objectCount,
+	uint32_t frameCount, const Features &features) {
+	this->objectCount = objectCount;
+	this->features = features;
+
+	//The count variant reads its draws in one go, larger scenes are split into several plain indirect draws instead.
+	useDrawCount = features.drawIndexedIndirectCount != nullptr && objectCount <= features.maxDrawIndirectCount;
+
+	//Draws are written and read within one frame, each frame in flight gets its own so frames never wait on each other.
+	frames.resize(frameCount);
+	for (FrameBuffers &frame : frames) {
+		createBuffer(memoryAllocator, sizeof(VkDrawIndexedIndirectCommand) * max(objectCount, 1u),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, frame.drawBuffer, frame.drawAllocation);
+		createBuffer(memoryAllocator, sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, frame.countBuffer, frame.countAllocation);
+
+		frame.descriptorSet = descriptorAllocator.getStaticSet(descriptorSetLayout, {
+			DescriptorAllocator::Binding::buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer),
+			DescriptorAllocator::Binding::buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.drawBuffer),
+			DescriptorAllocator::Binding::buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.countBuffer)
+		});
+	}
+}
+
+void GpuCulling::cleanup(MemoryAllocator &memoryAllocator) {
+	for (FrameBuffers &frame : frames) {
+		vkDestroyBuffer(logicDevice, frame.drawBuffer, nullptr);
+		memoryAllocator.free(frame.drawAllocation);
+		vkDestroyBuffer(logicDevice, frame.countBuffer, nullptr);
+		memoryAllocator.free(frame.countAllocation);
+	}
+	frames.clear();
+
+	vkDestroyPipelineLayout(logicDevice, pipelineLayout, nullptr);
+}
+
+PipelineKey GpuCulling::getPipelineKey(const string &shaderName) const {
+	return PipelineKey::compute(shaderName, pipelineLayout);
+}
+
+void GpuCulling::setPipeline(VkPipeline pipeline) {
+	this->pipeline = pipeline;
+}
+
+void GpuCulling::recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection) {
+	FrameBuffers &frame = frames[frameIndex];
+
+	if (useDrawCount) {
+		vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, sizeof(uint32_t), 0);
+
+		VkMemoryBarrier clearBarrier = {};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	CullConstants constants;
+	extractFrustumPlanes(viewProjection, constants.planes);
+	constants.objectCount = objectCount;
+	constants.compact = useDrawCount ? 1 : 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+VkBuffer GpuCulling::getDrawBuffer(uint32_t frameIndex) const {
+	return frames[frameIndex].drawBuffer;
+}
+
+VkBuffer GpuCulling::getCountBuffer(uint32_t frameIndex) const {
+	return frames[frameIndex].countBuffer;
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	FrameBuffers &frame = frames[frameIndex];
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (useDrawCount) {
+		features.drawIndexedIndirectCount(commandBuffer, frame.drawBuffer, 0, frame.countBuffer, 0, objectCount, stride);
+	}
+	else if (features.multiDrawIndirect) {
+		//Culled draws have instanceCount 0 and cost the GPU next to nothing.
+		for (uint32_t first = 0; first < objectCount; first += features.maxDrawIndirectCount) {
+			uint32_t count = min(features.maxDrawIndirectCount, objectCount - first);
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.drawBuffer, static_cast<VkDeviceSize>(first) * stride, count, stride);
+		}
+	}
+	else {
+		//Without multiDrawIndirect drawCount has to be 1.
+		for (uint32_t i = 0; i < objectCount; i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.drawBuffer, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+		}
+	}
+}
+
+void GpuCulling::extractFrustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]) {
+	const glm::mat4 &m = viewProjection;
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	//Gribb/Hartmann, with Vulkan's 0 to 1 depth range for the near plane.
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	for (int i = 0; i < 6; i++) {
+		float length = sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+		if (length > 0.f) {
+			planes[i] = planes[i] / length;
+		}
+	}
+}
+
+void GpuCulling::createBuffer(MemoryAllocator &memoryAllocator, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer, Allocation &allocation) {
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(logicDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to create culling buffer!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(logicDevice, buffer, &memReqs);
+
+	allocation = memoryAllocator.allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkBindBufferMemory(logicDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw runtime_error("Failed to bind culling buffer memory!");
+	}
+}
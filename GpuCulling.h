@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "DescriptorAllocator.h"
+#include "PipelineManager.h"
+
+// Frustum culls every object of the scene in a compute pass and writes one VkDrawIndexedIndirectCommand
+// per visible object, so drawing the whole scene costs the CPU a handful of commands regardless of the
+// object count. The draws carry the object index in firstInstance.
+class GpuCulling {
+
+public:
+	struct Features {
+		// vkCmdDrawIndexedIndirectCountKHR, nullptr when VK_KHR_draw_indirect_count is not enabled.
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+		bool multiDrawIndirect = false;
+		uint32_t maxDrawIndirectCount = 1;
+	};
+
+	// Creates the set and pipeline layouts, the pipeline is compiled by the caller with getPipelineKey.
+	void init(VkDevice logicDevice, DescriptorAllocator &descriptorAllocator);
+
+	// objectBuffer holds objectCount entries laid out as ObjectData in shaders/cull.comp.
+	void createBuffers(MemoryAllocator &memoryAllocator, DescriptorAllocator &descriptorAllocator, VkBuffer objectBuffer, uint32_t objectCount,
+		uint32_t frameCount, const Features &features);
+	void cleanup(MemoryAllocator &memoryAllocator);
+
+	PipelineKey getPipelineKey(const std::string &shaderName) const;
+
+	// The pipeline is owned by the caller's PipelineManager. Set before the first recordCull and again after reloads.
+	void setPipeline(VkPipeline pipeline);
+
+	// Records the culling dispatch. Has to be outside a render pass, before recordDraw of the same frame. The caller
+	// makes the written draw and count buffers visible to the indirect draws, e.g. through the render graph.
+	void recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection);
+
+	// Written by recordCull of the frame and read by its recordDraw.
+	VkBuffer getDrawBuffer(uint32_t frameIndex) const;
+	VkBuffer getCountBuffer(uint32_t frameIndex) const;
+
+	// Records the indirect draws inside the render pass, with the graphics pipeline and mesh buffers bound.
+	void recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Planes point inwards, a point p is inside when dot(plane, vec4(p, 1)) >= 0 for all six.
+	static void extractFrustumPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]);
+
+private:
+	static const uint32_t WORKGROUP_SIZE = 64;
+
+	struct CullConstants {
+		glm::vec4 planes[6];
+		uint32_t objectCount;
+		// Compacts visible draws to the front and counts them, otherwise culled draws get instanceCount 0.
+		uint32_t compact;
+	};
+
+	struct FrameBuffers {
+		VkBuffer drawBuffer = VK_NULL_HANDLE;
+		Allocation drawAllocation;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		Allocation countAllocation;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	//Owned by the DescriptorAllocator, like the frames' descriptor sets.
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	uint32_t objectCount = 0;
+	Features features;
+	bool useDrawCount = false;
+	std::vector<FrameBuffers> frames;
+
+	void createBuffer(MemoryAllocator &memoryAllocator, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer, Allocation &allocation);
+};
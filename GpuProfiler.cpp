@@ -0,0 +1,240 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ios>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+static int64_t steadyNanoseconds() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GpuProfiler::Scope::Scope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char* name)
+	: profiler(profiler), commandBuffer(commandBuffer) {
+	scope = profiler.beginScope(commandBuffer, name);
+}
+
+GpuProfiler::Scope::~Scope() {
+	profiler.endScope(commandBuffer, scope);
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, uint32_t queueFamily, uint32_t frameCount) {
+	this->logicDevice = logicDevice;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+	enabled = validBits > 0;
+	if (!enabled) {
+		cout << "Timestamp queries are not supported, GPU profiling is disabled" << endl;
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+	frames.resize(frameCount);
+	for (Frame &frame : frames) {
+		if (vkCreateQueryPool(logicDevice, &queryPoolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+			throw runtime_error("Failed to create timestamp query pool!");
+		}
+	}
+}
+
+void GpuProfiler::cleanup() {
+	for (Frame &frame : frames) {
+		vkDestroyQueryPool(logicDevice, frame.queryPool, nullptr);
+	}
+	frames.clear();
+}
+
+bool GpuProfiler::isEnabled() const {
+	return enabled;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!enabled) {
+		return;
+	}
+
+	currentFrame = frameIndex;
+	Frame &frame = frames[frameIndex];
+
+	if (frame.submitted) {
+		readBack(frame);
+	}
+
+	frame.scopes.clear();
+	frame.queryCount = 0;
+	frame.submitted = false;
+
+	vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+	if (!enabled) {
+		return UINT32_MAX;
+	}
+
+	Frame &frame = frames[currentFrame];
+	if (frame.scopes.size() == MAX_SCOPES_PER_FRAME) {
+		return UINT32_MAX;
+	}
+
+	PendingScope scope = { name, frame.queryCount };
+	frame.queryCount += 2;
+	frame.scopes.push_back(scope);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope.query);
+	return static_cast<uint32_t>(frame.scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+	if (!enabled || scope == UINT32_MAX) {
+		return;
+	}
+
+	Frame &frame = frames[currentFrame];
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.scopes[scope].query + 1);
+}
+
+void GpuProfiler::markSubmit(uint32_t frameIndex) {
+	if (!enabled) {
+		return;
+	}
+
+	Frame &frame = frames[frameIndex];
+	frame.submitNanoseconds = steadyNanoseconds();
+	frame.submitted = true;
+}
+
+void GpuProfiler::readBack(Frame &frame) {
+	if (frame.queryCount == 0) {
+		return;
+	}
+
+	vector<uint64_t> timestamps(frame.queryCount);
+	//No WAIT flag, the fence has signalled so the results are available and a failure just drops the frame.
+	VkResult result = vkGetQueryPoolResults(logicDevice, frame.queryPool, 0, frame.queryCount, timestamps.size() * sizeof(uint64_t),
+		timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	int64_t frameStart = INT64_MAX;
+
+	for (const PendingScope &scope : frame.scopes) {
+		uint64_t begin = timestamps[scope.query] & timestampMask;
+		uint64_t end = timestamps[scope.query + 1] & timestampMask;
+		//Wrapped counters or scopes that were never closed.
+		if (end < begin) {
+			continue;
+		}
+
+		int64_t start = static_cast<int64_t>(begin * timestampPeriod);
+		int64_t duration = static_cast<int64_t>((end - begin) * timestampPeriod);
+		frameStart = min(frameStart, start);
+
+		ScopeHistory &scopeHistory = history[scope.name];
+		double milliseconds = duration / 1e6;
+		if (scopeHistory.samples.size() < STATS_WINDOW) {
+			scopeHistory.samples.push_back(milliseconds);
+		}
+		else {
+			scopeHistory.samples[scopeHistory.next] = milliseconds;
+			scopeHistory.next = (scopeHistory.next + 1) % STATS_WINDOW;
+		}
+
+		TraceEvent event = { scope.name, start, duration };
+		trace.push_back(event);
+		if (trace.size() > TRACE_CAPACITY) {
+			trace.pop_front();
+		}
+	}
+
+	if (frameStart != INT64_MAX) {
+		int64_t offset = frame.submitNanoseconds - frameStart;
+		if (!offsetKnown || offset > gpuToCpuOffset) {
+			gpuToCpuOffset = offset;
+			offsetKnown = true;
+		}
+	}
+}
+
+void GpuProfiler::flush() {
+	for (Frame &frame : frames) {
+		if (frame.submitted) {
+			readBack(frame);
+			frame.submitted = false;
+		}
+	}
+}
+
+vector<GpuProfiler::ScopeStats> GpuProfiler::getStats() const {
+	vector<ScopeStats> result;
+
+	for (const auto &entry : history) {
+		const vector<double> &samples = entry.second.samples;
+		if (samples.empty()) {
+			continue;
+		}
+
+		vector<double> sorted = samples;
+		sort(sorted.begin(), sorted.end());
+
+		ScopeStats stats;
+		stats.name = entry.first;
+		stats.sampleCount = static_cast<uint32_t>(sorted.size());
+		stats.minMilliseconds = sorted.front();
+		stats.maxMilliseconds = sorted.back();
+		for (double sample : sorted) {
+			stats.avgMilliseconds += sample;
+		}
+		stats.avgMilliseconds /= sorted.size();
+		stats.p99Milliseconds = sorted[min(sorted.size() - 1, sorted.size() * 99 / 100)];
+
+		result.push_back(stats);
+	}
+
+	return result;
+}
+
+void GpuProfiler::printStats() const {
+	for (const ScopeStats &stats : getStats()) {
+		cout << "GPU " << stats.name << ": min " << stats.minMilliseconds << " ms, avg " << stats.avgMilliseconds << " ms, max "
+			<< stats.maxMilliseconds << " ms, p99 " << stats.p99Milliseconds << " ms over " << stats.sampleCount << " frames" << endl;
+	}
+}
+
+void GpuProfiler::writeTraceEvents(ostream &out) const {
+	out << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+
+	//Trace timestamps are in microseconds. The caller's formatting is restored once the events are written.
+	ios_base::fmtflags flags = out.flags();
+	streamsize precision = out.precision(3);
+	out << fixed;
+	for (const TraceEvent &event : trace) {
+		out << "," << endl << "{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":"
+			<< (event.start + gpuToCpuOffset) / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+int64_t GpuProfiler::getGpuToCpuOffset() const {
+	return gpuToCpuOffset;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Measures GPU time of named scopes with timestamp queries. Every frame in flight has its own query
+// pool, which is read back when the frame's slot comes around again. Its fence has signalled by then,
+// so reading never stalls. Scope names must outlive the profiler, i.e. string literals.
+class GpuProfiler {
+
+public:
+	static const uint32_t MAX_SCOPES_PER_FRAME = 64;
+	// Samples per scope the rolling statistics are computed over.
+	static const uint32_t STATS_WINDOW = 512;
+	// Scopes kept for the Chrome trace, older ones are dropped.
+	static const size_t TRACE_CAPACITY = 200000;
+
+	struct ScopeStats {
+		std::string name;
+		uint32_t sampleCount = 0;
+		double minMilliseconds = 0.0;
+		double avgMilliseconds = 0.0;
+		double maxMilliseconds = 0.0;
+		double p99Milliseconds = 0.0;
+	};
+
+	// Ends its scope when it goes out of scope.
+	class Scope {
+	public:
+		Scope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char* name);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		GpuProfiler &profiler;
+		VkCommandBuffer commandBuffer;
+		uint32_t scope;
+	};
+
+	// Disables itself when queueFamily has no timestamp support.
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, uint32_t queueFamily, uint32_t frameCount);
+	void cleanup();
+
+	bool isEnabled() const;
+
+	// Reads back what frameIndex recorded last time around and records the reset of its queries.
+	// The frame's fence must have signalled, and commandBuffer must be outside a render pass.
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Returns the scope to pass to endScope. Scopes may nest, but can't span a render pass recorded with secondary command buffers.
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+	// Call right before submitting the frame, its CPU time anchors GPU timestamps to the CPU clock.
+	void markSubmit(uint32_t frameIndex);
+
+	// Reads back every submitted frame. Only valid once the device is idle, i.e. before writing a trace on exit.
+	void flush();
+
+	std::vector<ScopeStats> getStats() const;
+	void printStats() const;
+
+	// Writes complete scopes as Chrome trace events on a "GPU" thread, each preceded by a comma.
+	// They are timed on the steady_clock timeline, the same one CpuProfiler uses.
+	void writeTraceEvents(std::ostream &out) const;
+
+	// Converts GPU nanoseconds to steady_clock nanoseconds, valid once a frame has been read back.
+	int64_t getGpuToCpuOffset() const;
+
+private:
+	struct PendingScope {
+		const char* name;
+		uint32_t query;
+	};
+
+	struct Frame {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<PendingScope> scopes;
+		uint32_t queryCount = 0;
+		int64_t submitNanoseconds = 0;
+		bool submitted = false;
+	};
+
+	struct ScopeHistory {
+		std::vector<double> samples;
+		size_t next = 0;
+	};
+
+	struct TraceEvent {
+		const char* name;
+		// GPU nanoseconds
+		int64_t start;
+		int64_t duration;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	bool enabled = false;
+	double timestampPeriod = 1.0;
+	uint64_t timestampMask = ~0ull;
+
+	std::vector<Frame> frames;
+	uint32_t currentFrame = 0;
+
+	std::map<std::string, ScopeHistory> history;
+	std::deque<TraceEvent> trace;
+
+	// Largest submit time minus GPU start seen. The GPU never starts before the submit, so this is the tightest bound.
+	int64_t gpuToCpuOffset = 0;
+	bool offsetKnown = false;
+
+	void readBack(Frame &frame);
+};
@@ -0,0 +1,107 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+void MappedFile::open(const string &fileName) {
+	close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		fileHandle = nullptr;
+		throw runtime_error("Failed to open " + fileName + "!");
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	//Empty files can't be mapped
+	if (size > 0) {
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		data = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+		if (!data) {
+			close();
+			throw runtime_error("Failed to map " + fileName + "!");
+		}
+	}
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("Failed to open " + fileName + "!");
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		::close(fd);
+		throw runtime_error("Failed to stat " + fileName + "!");
+	}
+	size = static_cast<size_t>(fileStat.st_size);
+
+	//Empty files can't be mapped
+	if (size > 0) {
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			::close(fd);
+			size = 0;
+			throw runtime_error("Failed to map " + fileName + "!");
+		}
+
+		//The whole file is read right away, start reading ahead.
+		madvise(mapping, size, MADV_WILLNEED);
+		data = mapping;
+	}
+
+	//The mapping keeps the file alive
+	::close(fd);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle) {
+		CloseHandle(fileHandle);
+		fileHandle = nullptr;
+	}
+#else
+	if (data) {
+		munmap(const_cast<void*>(data), size);
+	}
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+const void* MappedFile::getData() const {
+	return data;
+}
+
+size_t MappedFile::getSize() const {
+	return size;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read only memory mapping of a whole file, the OS pages it in on first access instead of copying it.
+class MappedFile {
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Throws when the file can't be opened or mapped.
+	void open(const std::string &fileName);
+	void close();
+
+	const void* getData() const;
+	size_t getSize() const;
+
+private:
+	const void* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
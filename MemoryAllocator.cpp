@@ -0,0 +1,212 @@
+#include "MemoryAllocator.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, VkDeviceSize blockSize) {
+	this->logicDevice = logicDevice;
+	this->blockSize = blockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	bufferImageGranularity = max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+	maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+}
+
+void MemoryAllocator::cleanup() {
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (unique_ptr<MemoryBlock> &block : blocks[i]) {
+			if (!block->allocator.isEmpty()) {
+				cerr << "Memory type " << i << " block destroyed with live allocations!" << endl;
+			}
+			if (block->mappedData != nullptr) {
+				vkUnmapMemory(logicDevice, block->memory);
+			}
+			vkFreeMemory(logicDevice, block->memory, nullptr);
+		}
+		blocks[i].clear();
+	}
+	deviceAllocationCount = 0;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements &memReqs, VkMemoryPropertyFlags properties, bool optimalImage) {
+	uint32_t memoryType = findMemoryType(memReqs.memoryTypeBits, properties);
+
+	VkDeviceSize size = memReqs.size;
+	VkDeviceSize alignment = memReqs.alignment;
+	if (optimalImage) {
+		alignment = max(alignment, bufferImageGranularity);
+		size = (size + bufferImageGranularity - 1) & ~(bufferImageGranularity - 1);
+	}
+
+	MemoryBlock* target = nullptr;
+	VkDeviceSize offset = BlockAllocator::INVALID_OFFSET;
+
+	VkDeviceSize typeBlockSize = getBlockSize(memoryType);
+	if (size > typeBlockSize / 2) {
+		//Big resources get their own block so they don't eat up a shared one.
+		target = createBlock(memoryType, size, true);
+		offset = target->allocator.allocate(size, alignment);
+	}
+	else {
+		for (unique_ptr<MemoryBlock> &block : blocks[memoryType]) {
+			if (block->dedicated) {
+				continue;
+			}
+			offset = block->allocator.allocate(size, alignment);
+			if (offset != BlockAllocator::INVALID_OFFSET) {
+				target = block.get();
+				break;
+			}
+		}
+
+		if (target == nullptr) {
+			target = createBlock(memoryType, typeBlockSize, false);
+			offset = target->allocator.allocate(size, alignment);
+		}
+	}
+
+	if (offset == BlockAllocator::INVALID_OFFSET) {
+		throw runtime_error("Failed to sub-allocate device memory!");
+	}
+
+	Allocation allocation;
+	allocation.memory = target->memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.memoryType = memoryType;
+	allocation.block = target;
+	if (target->mappedData != nullptr) {
+		allocation.mappedData = static_cast<char*>(target->mappedData) + offset;
+	}
+
+	return allocation;
+}
+
+void MemoryAllocator::free(Allocation &allocation) {
+	if (allocation.block == nullptr) {
+		return;
+	}
+
+	MemoryBlock* block = allocation.block;
+	block->allocator.free(allocation.offset);
+
+	if (block->allocator.isEmpty()) {
+		//Keep one empty shared block per type around to not thrash vkAllocateMemory.
+		bool otherEmptyBlock = false;
+		for (unique_ptr<MemoryBlock> &other : blocks[block->memoryType]) {
+			if (other.get() != block && !other->dedicated && other->allocator.isEmpty()) {
+				otherEmptyBlock = true;
+				break;
+			}
+		}
+
+		if (block->dedicated || otherEmptyBlock) {
+			destroyBlock(block->memoryType, block);
+		}
+	}
+
+	allocation = Allocation();
+}
+
+MemoryBlock* MemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated) {
+	if (maxAllocationCount > 0 && deviceAllocationCount >= maxAllocationCount) {
+		throw runtime_error("Reached maxMemoryAllocationCount!");
+	}
+
+	unique_ptr<MemoryBlock> block(new MemoryBlock(size));
+	block->memoryType = memoryType;
+	block->dedicated = dedicated;
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(logicDevice, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+		throw runtime_error("Failed to allocate device memory block!");
+	}
+	deviceAllocationCount++;
+
+	//Host visible blocks stay mapped for their whole lifetime.
+	if (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(logicDevice, block->memory, 0, size, 0, &block->mappedData) != VK_SUCCESS) {
+			vkFreeMemory(logicDevice, block->memory, nullptr);
+			deviceAllocationCount--;
+			throw runtime_error("Failed to map device memory block!");
+		}
+	}
+
+	MemoryBlock* result = block.get();
+	blocks[memoryType].push_back(move(block));
+	return result;
+}
+
+void MemoryAllocator::destroyBlock(uint32_t memoryType, MemoryBlock* block) {
+	vector<unique_ptr<MemoryBlock>> &typeBlocks = blocks[memoryType];
+
+	for (size_t i = 0; i < typeBlocks.size(); i++) {
+		if (typeBlocks[i].get() == block) {
+			if (block->mappedData != nullptr) {
+				vkUnmapMemory(logicDevice, block->memory);
+			}
+			vkFreeMemory(logicDevice, block->memory, nullptr);
+			deviceAllocationCount--;
+
+			typeBlocks.erase(typeBlocks.begin() + i);
+			return;
+		}
+	}
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType) const {
+	//Small heaps, i.e. the 256MB host visible device local heap, get smaller blocks.
+	VkDeviceSize heapSize = memProperties.memoryHeaps[memProperties.memoryTypes[memoryType].heapIndex].size;
+	return min(blockSize, max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw runtime_error("Failed to find suitable memory type!");
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats() const {
+	Stats stats;
+	float weightedFragmentation = 0.f;
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (const unique_ptr<MemoryBlock> &block : blocks[i]) {
+			BlockAllocator::Stats blockStats = block->allocator.getStats();
+			stats.reserved += blockStats.size;
+			stats.used += blockStats.used;
+			stats.blockCount++;
+			stats.allocationCount += blockStats.allocationCount;
+			weightedFragmentation += blockStats.fragmentation * (float)blockStats.size;
+		}
+	}
+
+	if (stats.reserved > 0) {
+		stats.fragmentation = weightedFragmentation / (float)stats.reserved;
+	}
+
+	return stats;
+}
+
+void MemoryAllocator::printStats() const {
+	Stats stats = getStats();
+
+	cout << "Device memory:" << endl;
+	cout << "\t" << stats.allocationCount << " allocations in " << stats.blockCount << " blocks" << endl;
+	cout << "\t" << stats.used / 1024 << " KiB used of " << stats.reserved / 1024 << " KiB reserved" << endl;
+	cout << "\tFragmentation " << stats.fragmentation * 100.f << "%" << endl;
+}
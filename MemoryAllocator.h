@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <vector>
+
+#include "BlockAllocator.h"
+
+struct MemoryBlock;
+
+// A sub-range of a VkDeviceMemory block handed out by the MemoryAllocator.
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	uint32_t memoryType = 0;
+
+	// Points at offset inside the persistently mapped block, nullptr for non host visible memory.
+	void* mappedData = nullptr;
+
+	MemoryBlock* block = nullptr;
+};
+
+struct MemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	void* mappedData = nullptr;
+	uint32_t memoryType = 0;
+	// Allocated for a single resource that did not fit the regular block size.
+	bool dedicated = false;
+	BlockAllocator allocator;
+
+	MemoryBlock(VkDeviceSize size) : allocator(size) {}
+};
+
+// Reserves large VkDeviceMemory blocks per memory type and sub-allocates resources from them,
+// instead of one vkAllocateMemory per resource.
+class MemoryAllocator {
+
+public:
+	static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	struct Stats {
+		VkDeviceSize reserved = 0;
+		VkDeviceSize used = 0;
+		uint32_t blockCount = 0;
+		uint32_t allocationCount = 0;
+		// Weighted by block size, see BlockAllocator::Stats.
+		float fragmentation = 0.f;
+	};
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	void cleanup();
+
+	// optimalImage has to be set for images with VK_IMAGE_TILING_OPTIMAL, they are padded to
+	// bufferImageGranularity so they never share a page with linear resources.
+	Allocation allocate(const VkMemoryRequirements &memReqs, VkMemoryPropertyFlags properties, bool optimalImage = false);
+	void free(Allocation &allocation);
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	Stats getStats() const;
+	void printStats() const;
+
+private:
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memProperties;
+	VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+	VkDeviceSize bufferImageGranularity = 1;
+	uint32_t maxAllocationCount = 0;
+	uint32_t deviceAllocationCount = 0;
+
+	// Blocks per memory type index.
+	std::vector<std::unique_ptr<MemoryBlock>> blocks[VK_MAX_MEMORY_TYPES];
+
+	MemoryBlock* createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated);
+	void destroyBlock(uint32_t memoryType, MemoryBlock* block);
+	VkDeviceSize getBlockSize(uint32_t memoryType) const;
+};
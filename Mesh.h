@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec3 color;
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(Vertex);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 2> attributeDesc = {};
+		//Vertex channel
+		attributeDesc[0].binding = 0;
+		//Location from shader input.
+		attributeDesc[0].location = 0;
+		//RGBA_SFLOAT, 32bit, float = R, vec2 = RG and so on.
+		attributeDesc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDesc[0].offset = offsetof(Vertex, pos);
+
+		//Color channel
+		attributeDesc[1].binding = 0;
+		attributeDesc[1].location = 1;
+		attributeDesc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDesc[1].offset = offsetof(Vertex, color);
+
+		return attributeDesc;
+	}
+};
+
+// Indexed triangle list. Indices are kept 32 bit on the CPU and narrowed to 16 bit on upload when they fit.
+struct Mesh {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	VkIndexType getIndexType() const {
+		return vertices.size() <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	VkDeviceSize getIndexSize() const {
+		return getIndexType() == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	// Indices in getIndexType() format, ready to upload.
+	std::vector<uint8_t> packIndices() const {
+		std::vector<uint8_t> packed(indices.size() * static_cast<size_t>(getIndexSize()));
+
+		if (getIndexType() == VK_INDEX_TYPE_UINT16) {
+			uint16_t* dst = reinterpret_cast<uint16_t*>(packed.data());
+			for (size_t i = 0; i < indices.size(); i++) {
+				dst[i] = static_cast<uint16_t>(indices[i]);
+			}
+		}
+		else if (!indices.empty()) {
+			memcpy(packed.data(), indices.data(), packed.size());
+		}
+
+		return packed;
+	}
+
+	// Sphere around the bounding box center, xyz center and w radius.
+	glm::vec4 computeBoundingSphere() const {
+		if (vertices.empty()) {
+			return glm::vec4(0.f);
+		}
+
+		glm::vec3 boundsMin(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+		for (const Vertex &vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.f;
+		for (const Vertex &vertex : vertices) {
+			radius = std::max(radius, glm::length(vertex.pos - center));
+		}
+
+		return glm::vec4(center, radius);
+	}
+
+	// Flat grid of resolution x resolution cells spanning [-0.5, 0.5] in XY, (resolution + 1)^2 vertices.
+	// Lets benchmarks scale the vertex count independently of the object count.
+	static Mesh createGrid(uint32_t resolution) {
+		Mesh mesh;
+		uint32_t rowLength = resolution + 1;
+
+		mesh.vertices.reserve(static_cast<size_t>(rowLength) * rowLength);
+		for (uint32_t y = 0; y <= resolution; y++) {
+			for (uint32_t x = 0; x <= resolution; x++) {
+				float u = static_cast<float>(x) / resolution;
+				float v = static_cast<float>(y) / resolution;
+
+				Vertex vertex;
+				vertex.pos = glm::vec3(u - 0.5f, v - 0.5f, 0.f);
+				vertex.color = glm::vec3(u, v, 1.f - u * v);
+				mesh.vertices.push_back(vertex);
+			}
+		}
+
+		//Same winding as the built in quad.
+		mesh.indices.reserve(static_cast<size_t>(resolution) * resolution * 6);
+		for (uint32_t y = 0; y < resolution; y++) {
+			for (uint32_t x = 0; x < resolution; x++) {
+				uint32_t corner = y * rowLength + x;
+				uint32_t cellIndices[6] = { corner, corner + 1, corner + rowLength + 1, corner + rowLength + 1, corner + rowLength, corner };
+				mesh.indices.insert(mesh.indices.end(), cellIndices, cellIndices + 6);
+			}
+		}
+
+		return mesh;
+	}
+
+	// GPU memory taken by the vertex and index buffers.
+	VkDeviceSize getMemorySize() const {
+		return sizeof(Vertex) * vertices.size() + getIndexSize() * indices.size();
+	}
+};
@@ -0,0 +1,75 @@
+#include "MeshCooker.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+#include "MeshLoader.h"
+#include "MeshFile.h"
+
+using namespace std;
+
+void MeshCooker::cook(const string &objFileName, const string &meshFileName) {
+	MeshLoader::Stats stats;
+	Mesh mesh = MeshLoader::loadObj(objFileName, &stats);
+	MeshLoader::printStats(objFileName, mesh, stats);
+
+	MeshFile::write(meshFileName, mesh);
+
+	cout << "Cooked " << objFileName << " into " << meshFileName << endl;
+}
+
+void MeshCooker::benchmark(const string &objFileName, uint32_t iterations) {
+	string meshFileName = objFileName + ".mesh";
+	cook(objFileName, meshFileName);
+
+	iterations = max(iterations, 1u);
+
+	//Stands in for the staging ring, both paths end with the data copied into it.
+	vector<char> staging;
+
+	vector<double> objTimes;
+	vector<double> cookedTimes;
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+		Mesh mesh = MeshLoader::loadObj(objFileName);
+		vector<uint8_t> indexData = mesh.packIndices();
+		size_t vertexDataSize = sizeof(Vertex) * mesh.vertices.size();
+		staging.resize(vertexDataSize + indexData.size());
+		memcpy(staging.data(), mesh.vertices.data(), vertexDataSize);
+		memcpy(staging.data() + vertexDataSize, indexData.data(), indexData.size());
+
+		objTimes.push_back(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count());
+	}
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+		MeshFile meshFile;
+		meshFile.open(meshFileName);
+		size_t vertexDataSize = static_cast<size_t>(meshFile.getVertexDataSize());
+		size_t indexDataSize = static_cast<size_t>(meshFile.getIndexDataSize());
+		staging.resize(vertexDataSize + indexDataSize);
+		memcpy(staging.data(), meshFile.getVertexData(), vertexDataSize);
+		memcpy(staging.data() + vertexDataSize, meshFile.getIndexData(), indexDataSize);
+		meshFile.close();
+
+		cookedTimes.push_back(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count());
+	}
+
+	auto report = [iterations](const char* name, const vector<double> &times) {
+		double total = 0.0;
+		for (double time : times) {
+			total += time;
+		}
+		cout << "\t" << name << ": min " << *min_element(times.begin(), times.end()) << " ms, avg " << total / iterations << " ms" << endl;
+	};
+
+	cout << "Mesh load benchmark, " << iterations << " iterations:" << endl;
+	report("OBJ parse + optimize", objTimes);
+	report("cooked mmap + checksum", cookedTimes);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Offline conversion of text meshes into MeshFile containers, and a comparison of both load paths.
+class MeshCooker {
+
+public:
+	// Loads and optimizes an OBJ and writes it as a cooked mesh.
+	static void cook(const std::string &objFileName, const std::string &meshFileName);
+
+	// Cooks objFileName next to itself, then times iterations loads of both files up to the point
+	// where the data sits in upload ready memory, and prints min and average times.
+	static void benchmark(const std::string &objFileName, uint32_t iterations);
+};
@@ -0,0 +1,149 @@
+#include "MeshFile.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+
+static_assert(sizeof(MeshFile::Header) == 128, "MeshFile::Header is part of the file format");
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+void MeshFile::write(const string &fileName, const Mesh &mesh) {
+	vector<uint8_t> indexData = mesh.packIndices();
+	VkDeviceSize vertexDataSize = sizeof(Vertex) * mesh.vertices.size();
+
+	Header fileHeader;
+	memset(&fileHeader, 0, sizeof(fileHeader));
+	fileHeader.magic = MAGIC;
+	fileHeader.version = VERSION;
+	fileHeader.vertexStride = sizeof(Vertex);
+	fileHeader.indexSize = static_cast<uint32_t>(mesh.getIndexSize());
+	fileHeader.vertexCount = mesh.vertices.size();
+	fileHeader.indexCount = mesh.indices.size();
+	fileHeader.vertexOffset = alignOffset(sizeof(Header), BLOB_ALIGNMENT);
+	fileHeader.indexOffset = alignOffset(fileHeader.vertexOffset + vertexDataSize, BLOB_ALIGNMENT);
+
+	glm::vec4 boundingSphere = mesh.computeBoundingSphere();
+	for (int i = 0; i < 4; i++) {
+		fileHeader.boundingSphere[i] = boundingSphere[i];
+	}
+
+	fileHeader.checksum = checksum(mesh.vertices.data(), static_cast<size_t>(vertexDataSize));
+	fileHeader.checksum = checksum(indexData.data(), indexData.size(), fileHeader.checksum);
+
+	ofstream out(fileName, ios::binary | ios::trunc);
+	if (!out.is_open()) {
+		throw runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	const char padding[BLOB_ALIGNMENT] = {};
+
+	out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	out.write(padding, fileHeader.vertexOffset - sizeof(fileHeader));
+	out.write(reinterpret_cast<const char*>(mesh.vertices.data()), vertexDataSize);
+	out.write(padding, fileHeader.indexOffset - fileHeader.vertexOffset - vertexDataSize);
+	out.write(reinterpret_cast<const char*>(indexData.data()), indexData.size());
+
+	if (!out) {
+		throw runtime_error("Failed to write " + fileName + "!");
+	}
+}
+
+void MeshFile::open(const string &fileName, bool verifyChecksum) {
+	close();
+	file.open(fileName);
+
+	if (file.getSize() < sizeof(Header)) {
+		close();
+		throw runtime_error(fileName + " is not a cooked mesh!");
+	}
+
+	header = static_cast<const Header*>(file.getData());
+
+	if (header->magic != MAGIC) {
+		close();
+		throw runtime_error(fileName + " is not a cooked mesh!");
+	}
+
+	if (header->version != VERSION || header->vertexStride != sizeof(Vertex)) {
+		close();
+		throw runtime_error(fileName + " was cooked for another version, cook it again!");
+	}
+
+	if ((header->indexSize != 2 && header->indexSize != 4) ||
+		header->vertexOffset + getVertexDataSize() > file.getSize() ||
+		header->indexOffset + getIndexDataSize() > file.getSize()) {
+		close();
+		throw runtime_error(fileName + " is truncated or corrupt!");
+	}
+
+	if (verifyChecksum) {
+		uint64_t hash = checksum(getVertexData(), static_cast<size_t>(getVertexDataSize()));
+		hash = checksum(getIndexData(), static_cast<size_t>(getIndexDataSize()), hash);
+
+		if (hash != header->checksum) {
+			close();
+			throw runtime_error(fileName + " failed its checksum!");
+		}
+	}
+}
+
+void MeshFile::close() {
+	file.close();
+	header = nullptr;
+}
+
+const MeshFile::Header& MeshFile::getHeader() const {
+	return *header;
+}
+
+const void* MeshFile::getVertexData() const {
+	return getBytes() + header->vertexOffset;
+}
+
+VkDeviceSize MeshFile::getVertexDataSize() const {
+	return header->vertexCount * header->vertexStride;
+}
+
+const void* MeshFile::getIndexData() const {
+	return getBytes() + header->indexOffset;
+}
+
+VkDeviceSize MeshFile::getIndexDataSize() const {
+	return header->indexCount * header->indexSize;
+}
+
+VkIndexType MeshFile::getIndexType() const {
+	return header->indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+glm::vec4 MeshFile::getBoundingSphere() const {
+	return glm::vec4(header->boundingSphere[0], header->boundingSphere[1], header->boundingSphere[2], header->boundingSphere[3]);
+}
+
+uint64_t MeshFile::checksum(const void* data, size_t size, uint64_t hash) {
+	const uint64_t prime = 1099511628211ull;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	//Word at a time, byte wise FNV-1a runs far below disk speed.
+	size_t wordCount = size / sizeof(uint64_t);
+	for (size_t i = 0; i < wordCount; i++) {
+		uint64_t word;
+		memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+
+	for (size_t i = wordCount * sizeof(uint64_t); i < size; i++) {
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	return hash;
+}
+
+const uint8_t* MeshFile::getBytes() const {
+	return static_cast<const uint8_t*>(file.getData());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+// Cooked mesh container. A fixed size header is followed by the vertex blob and the index blob in their GPU
+// layout, each at a BLOB_ALIGNMENT aligned offset, so they can be copied straight from the mapping into staging memory.
+class MeshFile {
+
+public:
+	static const uint32_t MAGIC = 0x48534d56; // "VMSH"
+	// Bump whenever the header or Vertex layout changes, old files then have to be cooked again.
+	static const uint32_t VERSION = 1;
+	static const uint32_t BLOB_ALIGNMENT = 64;
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexStride;
+		// 2 or 4 bytes
+		uint32_t indexSize;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		// xyz center, w radius
+		float boundingSphere[4];
+		// checksum() of both blobs
+		uint64_t checksum;
+		uint8_t reserved[56];
+	};
+
+	// Writes mesh as is, run MeshLoader::optimize before.
+	static void write(const std::string &fileName, const Mesh &mesh);
+
+	// Maps the file and validates the header. Checking the checksum reads the whole file once.
+	// Throws on files that aren't valid cooked meshes.
+	void open(const std::string &fileName, bool verifyChecksum = true);
+	void close();
+
+	const Header& getHeader() const;
+
+	// Pointers into the mapping, valid until close.
+	const void* getVertexData() const;
+	VkDeviceSize getVertexDataSize() const;
+	const void* getIndexData() const;
+	VkDeviceSize getIndexDataSize() const;
+
+	VkIndexType getIndexType() const;
+	glm::vec4 getBoundingSphere() const;
+
+	// FNV-1a over 64 bit words, chained over several ranges by passing the previous result as hash.
+	static uint64_t checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+
+	const uint8_t* getBytes() const;
+};
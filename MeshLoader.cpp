@@ -0,0 +1,207 @@
+#include "MeshLoader.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <unordered_map>
+#include <chrono>
+#include <cstdlib>
+
+#include "MeshOptimizer.h"
+
+using namespace std;
+
+// Corner of a face, 1 based OBJ indices with 0 meaning absent.
+struct ObjCorner {
+	int position;
+	int normal;
+};
+
+static const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	return p;
+}
+
+static const char* skipLine(const char* p, const char* end) {
+	while (p < end && *p != '\n') {
+		p++;
+	}
+	return p < end ? p + 1 : p;
+}
+
+// Parses up to count floats, returns how many were found.
+static int parseFloats(const char* &p, const char* end, float* values, int count) {
+	int parsed = 0;
+	while (parsed < count) {
+		p = skipSpaces(p, end);
+		char* next;
+		float value = strtof(p, &next);
+		if (next == p) {
+			break;
+		}
+		values[parsed++] = value;
+		p = next;
+	}
+	return parsed;
+}
+
+// Resolves a relative (negative) or absolute OBJ index to 0 based, -1 when out of range.
+static int resolveIndex(long index, size_t count) {
+	long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+	return resolved >= 0 && resolved < static_cast<long>(count) ? static_cast<int>(resolved) : -1;
+}
+
+Mesh MeshLoader::loadObj(const string &fileName, Stats* stats) {
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+	ifstream file(fileName, ios::ate | ios::binary);
+	if (!file.is_open()) {
+		throw runtime_error("Failed to open mesh " + fileName + "!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	//Null terminated so strtof never runs past the end.
+	vector<char> text(fileSize + 1, '\0');
+	file.seekg(0);
+	file.read(text.data(), fileSize);
+	file.close();
+
+	vector<glm::vec3> positions;
+	vector<glm::vec3> colors;
+	vector<glm::vec3> normals;
+	bool hasColors = false;
+
+	Mesh mesh;
+	//Texture coordinates aren't part of Vertex, so only position and normal tell vertices apart.
+	unordered_map<uint64_t, uint32_t> vertexLookup;
+	vector<uint32_t> polygon;
+	size_t cornerCount = 0;
+
+	const char* p = text.data();
+	const char* end = text.data() + fileSize;
+
+	while (p < end) {
+		p = skipSpaces(p, end);
+
+		if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			p += 1;
+			float values[6] = { 0.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+			int count = parseFloats(p, end, values, 6);
+
+			positions.push_back(glm::vec3(values[0], values[1], values[2]));
+			//Common extension, r g b after the position
+			colors.push_back(glm::vec3(values[3], values[4], values[5]));
+			hasColors = hasColors || count == 6;
+		}
+		else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			p += 2;
+			float values[3] = { 0.f, 0.f, 0.f };
+			parseFloats(p, end, values, 3);
+			normals.push_back(glm::vec3(values[0], values[1], values[2]));
+		}
+		else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			p += 1;
+			polygon.clear();
+
+			while (true) {
+				p = skipSpaces(p, end);
+				char* next;
+				long positionIndex = strtol(p, &next, 10);
+				if (next == p) {
+					break;
+				}
+				p = next;
+
+				long normalIndex = 0;
+				if (*p == '/') {
+					p++;
+					//Texture coordinate, unused
+					strtol(p, &next, 10);
+					p = next;
+
+					if (*p == '/') {
+						p++;
+						normalIndex = strtol(p, &next, 10);
+						p = next;
+					}
+				}
+
+				ObjCorner corner;
+				corner.position = resolveIndex(positionIndex, positions.size());
+				corner.normal = normalIndex != 0 ? resolveIndex(normalIndex, normals.size()) : -1;
+
+				if (corner.position < 0 || (normalIndex != 0 && corner.normal < 0)) {
+					throw runtime_error("Mesh " + fileName + " references a vertex that doesn't exist!");
+				}
+
+				uint64_t key = static_cast<uint64_t>(corner.position) << 32 | static_cast<uint32_t>(corner.normal);
+				unordered_map<uint64_t, uint32_t>::iterator found = vertexLookup.find(key);
+
+				if (found != vertexLookup.end()) {
+					polygon.push_back(found->second);
+				}
+				else {
+					Vertex vertex;
+					vertex.pos = positions[corner.position];
+					vertex.color = colors[corner.position];
+					if (!hasColors && corner.normal >= 0) {
+						//No vertex colors, visualize the normal instead.
+						vertex.color = normals[corner.normal] * 0.5f + glm::vec3(0.5f);
+					}
+
+					uint32_t index = static_cast<uint32_t>(mesh.vertices.size());
+					mesh.vertices.push_back(vertex);
+					vertexLookup.emplace(key, index);
+					polygon.push_back(index);
+				}
+
+				cornerCount++;
+			}
+
+			for (size_t i = 2; i < polygon.size(); i++) {
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[i - 1]);
+				mesh.indices.push_back(polygon[i]);
+			}
+		}
+
+		p = skipLine(p, end);
+	}
+
+	if (stats) {
+		stats->parseMilliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		stats->cornerCount = cornerCount;
+	}
+
+	optimize(mesh, stats);
+
+	return mesh;
+}
+
+void MeshLoader::optimize(Mesh &mesh, Stats* stats) {
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+	float acmrBefore = MeshOptimizer::computeACMR(mesh.indices, mesh.vertices.size());
+
+	MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	MeshOptimizer::optimizeVertexFetch(mesh);
+
+	if (stats) {
+		stats->optimizeMilliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		stats->vertexCount = mesh.vertices.size();
+		stats->triangleCount = mesh.indices.size() / 3;
+		stats->memorySize = mesh.getMemorySize();
+		stats->acmrBefore = acmrBefore;
+		stats->acmrAfter = MeshOptimizer::computeACMR(mesh.indices, mesh.vertices.size());
+	}
+}
+
+void MeshLoader::printStats(const string &name, const Mesh &mesh, const Stats &stats) {
+	cout << "Mesh " << name << ": " << stats.vertexCount << " vertices (" << stats.cornerCount << " face corners), "
+		<< stats.triangleCount << " triangles, " << (mesh.getIndexType() == VK_INDEX_TYPE_UINT16 ? 16 : 32) << " bit indices, "
+		<< stats.memorySize / 1024.0 << " KB" << endl;
+	cout << "\tparsed in " << stats.parseMilliseconds << " ms, optimized in " << stats.optimizeMilliseconds << " ms, ACMR "
+		<< stats.acmrBefore << " -> " << stats.acmrAfter << endl;
+}
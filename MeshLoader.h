@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "Mesh.h"
+
+// Loads meshes from disk, deduplicates their vertices and optimizes them for the GPU.
+class MeshLoader {
+
+public:
+	struct Stats {
+		double parseMilliseconds = 0.0;
+		double optimizeMilliseconds = 0.0;
+		// Face corners before deduplication
+		size_t cornerCount = 0;
+		size_t vertexCount = 0;
+		size_t triangleCount = 0;
+		VkDeviceSize memorySize = 0;
+		float acmrBefore = 0.f;
+		float acmrAfter = 0.f;
+	};
+
+	// Wavefront OBJ: positions with optional vertex colors, normals and polygonal faces, which are triangulated as fans.
+	// Throws on files that can't be read or reference missing vertices.
+	static Mesh loadObj(const std::string &fileName, Stats* stats = nullptr);
+
+	// Vertex cache and vertex fetch optimization, fills in the optimization part of stats.
+	static void optimize(Mesh &mesh, Stats* stats = nullptr);
+
+	static void printStats(const std::string &name, const Mesh &mesh, const Stats &stats);
+};
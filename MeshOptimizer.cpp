@@ -0,0 +1,197 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+// Tuning from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+float MeshOptimizer::vertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+	if (remainingTriangles == 0) {
+		//Nothing left to draw with this vertex
+		return -1.f;
+	}
+
+	float score = 0.f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			//The last triangle's vertices get a fixed score so its direct neighbours don't always win.
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else {
+			float scaler = 1.f / (CACHE_SIZE - 3);
+			score = pow(1.f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	//Vertices with few triangles left are finished off first so they don't linger.
+	score += VALENCE_BOOST_SCALE * pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+
+	return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(vector<uint32_t> &indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//Triangles using each vertex, the first remainingTriangles[v] entries are the ones not emitted yet.
+	vector<uint32_t> remainingTriangles(vertexCount, 0);
+	for (uint32_t index : indices) {
+		remainingTriangles[index]++;
+	}
+
+	vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+	}
+
+	vector<uint32_t> adjacency(indices.size());
+	vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		for (size_t k = 0; k < 3; k++) {
+			adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	vector<int32_t> cachePositions(vertexCount, -1);
+	vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScores[v] = vertexScore(-1, remainingTriangles[v]);
+	}
+
+	vector<float> triangleScores(triangleCount);
+	vector<bool> emitted(triangleCount, false);
+
+	int64_t best = -1;
+	float bestScore = -numeric_limits<float>::max();
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > bestScore) {
+			bestScore = triangleScores[t];
+			best = static_cast<int64_t>(t);
+		}
+	}
+
+	vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	vector<uint32_t> cache;
+	vector<uint32_t> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	size_t scanCursor = 0;
+
+	while (best >= 0) {
+		size_t triangle = static_cast<size_t>(best);
+		emitted[triangle] = true;
+
+		const uint32_t* corners = &indices[triangle * 3];
+		newCache.assign(corners, corners + 3);
+
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = corners[k];
+			result.push_back(v);
+
+			//Swap the emitted triangle out of the vertex's remaining range.
+			uint32_t* vertexTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++) {
+				if (vertexTriangles[i] == triangle) {
+					swap(vertexTriangles[i], vertexTriangles[remainingTriangles[v] - 1]);
+					remainingTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		//LRU, the emitted triangle moves to the front and pushes everything else back.
+		for (uint32_t v : cache) {
+			if (v != corners[0] && v != corners[1] && v != corners[2]) {
+				newCache.push_back(v);
+			}
+		}
+
+		for (size_t i = 0; i < newCache.size(); i++) {
+			uint32_t v = newCache[i];
+			cachePositions[v] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+			vertexScores[v] = vertexScore(cachePositions[v], remainingTriangles[v]);
+		}
+
+		//Only triangles touching the cache changed score, the next one is picked among them.
+		best = -1;
+		bestScore = -numeric_limits<float>::max();
+		for (uint32_t v : newCache) {
+			const uint32_t* vertexTriangles = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remainingTriangles[v]; i++) {
+				uint32_t t = vertexTriangles[i];
+				triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > CACHE_SIZE) {
+			newCache.resize(CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		//Cache exhausted, continue with the next triangle not emitted yet.
+		if (best < 0) {
+			while (scanCursor < triangleCount && emitted[scanCursor]) {
+				scanCursor++;
+			}
+			if (scanCursor < triangleCount) {
+				best = static_cast<int64_t>(scanCursor);
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(Mesh &mesh) {
+	const uint32_t unused = numeric_limits<uint32_t>::max();
+	vector<uint32_t> remap(mesh.vertices.size(), unused);
+
+	vector<Vertex> reordered;
+	reordered.reserve(mesh.vertices.size());
+
+	for (uint32_t &index : mesh.indices) {
+		if (remap[index] == unused) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(reordered);
+}
+
+float MeshOptimizer::computeACMR(const vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+	if (indices.size() < 3) {
+		return 0.f;
+	}
+
+	//A vertex is still cached if fewer than cacheSize misses happened since it was last loaded.
+	vector<uint32_t> loadedAt(vertexCount, 0);
+	uint32_t misses = 0;
+	uint32_t time = cacheSize + 1;
+
+	for (uint32_t index : indices) {
+		if (time - loadedAt[index] > cacheSize) {
+			loadedAt[index] = time++;
+			misses++;
+		}
+	}
+
+	return static_cast<float>(misses) / (indices.size() / 3);
+}
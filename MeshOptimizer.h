@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+// Reorders index and vertex buffers for the post transform vertex cache and for vertex fetch.
+class MeshOptimizer {
+
+public:
+	// Cache size assumed by optimizeVertexCache.
+	static const uint32_t CACHE_SIZE = 32;
+
+	// Tom Forsyth's linear speed vertex cache optimization, reorders triangles so vertices are reused while still cached.
+	static void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+	// Reorders vertices by first use in the index buffer, also drops unreferenced vertices. Run after optimizeVertexCache.
+	static void optimizeVertexFetch(Mesh &mesh);
+
+	// Average cache miss ratio, transformed vertices per triangle with a FIFO cache of cacheSize entries.
+	// 3 is the worst case, 0.5 is the best a regular grid can get.
+	static float computeACMR(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+private:
+	static float vertexScore(int32_t cachePosition, uint32_t remainingTriangles);
+};
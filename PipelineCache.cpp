@@ -0,0 +1,120 @@
+#include "PipelineCache.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+// "VKPC"
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x43504b56;
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, const string &fileName) {
+	this->logicDevice = logicDevice;
+	this->fileName = fileName;
+	loaded = false;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	memset(&expectedHeader, 0, sizeof(expectedHeader));
+	expectedHeader.magic = PIPELINE_CACHE_MAGIC;
+	expectedHeader.fileVersion = FILE_VERSION;
+	expectedHeader.vendorID = properties.vendorID;
+	expectedHeader.deviceID = properties.deviceID;
+	expectedHeader.driverVersion = properties.driverVersion;
+	memcpy(expectedHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	vector<char> data;
+	ifstream file(fileName, ios::binary);
+
+	if (file.is_open()) {
+		FileHeader header;
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+		bool valid = file.gcount() == sizeof(header) && header.magic == expectedHeader.magic && header.fileVersion == expectedHeader.fileVersion &&
+			header.vendorID == expectedHeader.vendorID && header.deviceID == expectedHeader.deviceID &&
+			header.driverVersion == expectedHeader.driverVersion &&
+			memcmp(header.pipelineCacheUUID, expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+		if (valid) {
+			data.resize(static_cast<size_t>(header.dataSize));
+			file.read(data.data(), data.size());
+			valid = file.gcount() == static_cast<streamsize>(data.size());
+		}
+
+		if (!valid) {
+			//Stale or foreign caches are only a missed speedup, start over empty.
+			cout << "Discarding pipeline cache " << fileName << ", it was written by another device, driver or version" << endl;
+			data.clear();
+		}
+		else {
+			loaded = true;
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(logicDevice, &createInfo, nullptr, &cache) != VK_SUCCESS) {
+		throw runtime_error("Failed to create pipeline cache!");
+	}
+
+	if (loaded) {
+		cout << "Loaded pipeline cache " << fileName << " (" << data.size() << " bytes)" << endl;
+	}
+}
+
+void PipelineCache::cleanup() {
+	save();
+	vkDestroyPipelineCache(logicDevice, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save() {
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(logicDevice, cache, &dataSize, nullptr) != VK_SUCCESS) {
+		cerr << "Failed to read pipeline cache size!" << endl;
+		return;
+	}
+
+	vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(logicDevice, cache, &dataSize, data.data()) != VK_SUCCESS) {
+		cerr << "Failed to read pipeline cache data!" << endl;
+		return;
+	}
+
+	FileHeader header = expectedHeader;
+	header.dataSize = dataSize;
+
+	//Written to a temporary file first so a crash mid write never leaves a truncated cache behind.
+	string tempFileName = fileName + ".tmp";
+	{
+		ofstream file(tempFileName, ios::binary | ios::trunc);
+		if (!file.is_open()) {
+			cerr << "Failed to open " << tempFileName << " for writing!" << endl;
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), dataSize);
+	}
+
+	remove(fileName.c_str());
+	if (rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+		cerr << "Failed to save pipeline cache " << fileName << "!" << endl;
+	}
+}
+
+VkPipelineCache PipelineCache::getHandle() const {
+	return cache;
+}
+
+bool PipelineCache::wasLoaded() const {
+	return loaded;
+}
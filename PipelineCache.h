@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// VkPipelineCache backed by a file. The blob is prefixed with our own header so a cache written
+// by another device, driver or build of the file format is discarded instead of handed to the driver.
+class PipelineCache {
+
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, const std::string &fileName);
+
+	// Saves the cache and destroys it.
+	void cleanup();
+
+	// Writes the current cache contents to disk, failures are logged and otherwise ignored.
+	void save();
+
+	VkPipelineCache getHandle() const;
+
+	// True when init found a valid blob on disk.
+	bool wasLoaded() const;
+
+private:
+	// Bump when the header layout changes.
+	static const uint32_t FILE_VERSION = 1;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t fileVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string fileName;
+	FileHeader expectedHeader;
+	bool loaded = false;
+};
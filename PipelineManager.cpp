@@ -0,0 +1,497 @@
+#include "PipelineManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+// FNV-1a, fed one value at a time so struct padding never ends up in the hash.
+static void hashValue(uint64_t &hash, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		hash = (hash ^ ((value >> (i * 8)) & 0xff)) * FNV_PRIME;
+	}
+}
+
+static void hashString(uint64_t &hash, const string &text) {
+	for (char c : text) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+	}
+	hashValue(hash, text.size());
+}
+
+template<typename T>
+static uint64_t handleValue(T handle) {
+	//Non dispatchable handles are pointers or 64 bit integers depending on the platform.
+	return (uint64_t)handle;
+}
+
+// Shader names joined by '+', to tell pipelines apart in logs.
+static string describe(const PipelineKey &key) {
+	string description;
+	for (const PipelineKey::Stage &stage : key.stages) {
+		description += (description.empty() ? "" : "+") + stage.shaderName;
+	}
+	return description;
+}
+
+PipelineKey PipelineKey::compute(const string &shaderName, VkPipelineLayout layout) {
+	PipelineKey key;
+	key.stages.push_back({ VK_SHADER_STAGE_COMPUTE_BIT, shaderName });
+	key.layout = layout;
+	return key;
+}
+
+bool PipelineKey::isCompute() const {
+	return stages.size() == 1 && stages[0].stage == VK_SHADER_STAGE_COMPUTE_BIT;
+}
+
+bool PipelineKey::usesShader(const string &shaderName) const {
+	for (const Stage &stage : stages) {
+		if (stage.shaderName == shaderName) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t PipelineKey::hash() const {
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	for (const Stage &stage : stages) {
+		hashValue(hash, stage.stage);
+		hashString(hash, stage.shaderName);
+	}
+	hashValue(hash, handleValue(layout));
+	if (isCompute()) {
+		return hash;
+	}
+
+	for (const VkVertexInputBindingDescription &binding : bindings) {
+		hashValue(hash, binding.binding);
+		hashValue(hash, binding.stride);
+		hashValue(hash, binding.inputRate);
+	}
+	for (const VkVertexInputAttributeDescription &attribute : attributes) {
+		hashValue(hash, attribute.location);
+		hashValue(hash, attribute.binding);
+		hashValue(hash, attribute.format);
+		hashValue(hash, attribute.offset);
+	}
+	hashValue(hash, topology);
+	hashValue(hash, polygonMode);
+	hashValue(hash, cullMode);
+	hashValue(hash, frontFace);
+	hashValue(hash, blendEnable);
+	hashValue(hash, colorAttachmentCount);
+	hashValue(hash, depthTestEnable);
+	hashValue(hash, depthWriteEnable);
+	hashValue(hash, depthCompareOp);
+	hashValue(hash, handleValue(renderPass));
+	hashValue(hash, subpass);
+
+	return hash;
+}
+
+bool PipelineKey::operator==(const PipelineKey &other) const {
+	if (stages.size() != other.stages.size() || layout != other.layout) {
+		return false;
+	}
+	for (size_t i = 0; i < stages.size(); i++) {
+		if (stages[i].stage != other.stages[i].stage || stages[i].shaderName != other.stages[i].shaderName) {
+			return false;
+		}
+	}
+	if (isCompute()) {
+		return true;
+	}
+
+	if (bindings.size() != other.bindings.size() || attributes.size() != other.attributes.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < bindings.size(); i++) {
+		const VkVertexInputBindingDescription &a = bindings[i];
+		const VkVertexInputBindingDescription &b = other.bindings[i];
+		if (a.binding != b.binding || a.stride != b.stride || a.inputRate != b.inputRate) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < attributes.size(); i++) {
+		const VkVertexInputAttributeDescription &a = attributes[i];
+		const VkVertexInputAttributeDescription &b = other.attributes[i];
+		if (a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset) {
+			return false;
+		}
+	}
+
+	return topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace
+		&& blendEnable == other.blendEnable && colorAttachmentCount == other.colorAttachmentCount && depthTestEnable == other.depthTestEnable
+		&& depthWriteEnable == other.depthWriteEnable && depthCompareOp == other.depthCompareOp && renderPass == other.renderPass
+		&& subpass == other.subpass;
+}
+
+void PipelineManager::init(VkDevice logicDevice, VkPipelineCache pipelineCache, ShaderLibrary &shaderLibrary, uint32_t threadCount) {
+	this->logicDevice = logicDevice;
+	this->pipelineCache = pipelineCache;
+	this->shaderLibrary = &shaderLibrary;
+
+	workers.reset(new ThreadPool(threadCount));
+}
+
+void PipelineManager::cleanup() {
+	{
+		unique_lock<std::mutex> lock(managerMutex);
+		compileFinished.wait(lock, [this]() {
+			for (const unique_ptr<Entry> &entry : entries) {
+				if (entry->compiling) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+	workers.reset();
+
+	for (const unique_ptr<Entry> &entry : entries) {
+		if (entry->pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(logicDevice, entry->pipeline, nullptr);
+		}
+	}
+	for (VkPipeline pipeline : replaced) {
+		vkDestroyPipeline(logicDevice, pipeline, nullptr);
+	}
+
+	entries.clear();
+	ids.clear();
+	replaced.clear();
+}
+
+PipelineManager::PipelineId PipelineManager::request(const PipelineKey &key) {
+	uint64_t hash = key.hash();
+
+	lock_guard<std::mutex> lock(managerMutex);
+	stats.requestCount++;
+
+	vector<PipelineId> &candidates = ids[hash];
+	for (PipelineId id : candidates) {
+		if (entries[id]->key == key) {
+			stats.deduplicatedCount++;
+			return id;
+		}
+	}
+
+	PipelineId id = static_cast<PipelineId>(entries.size());
+	unique_ptr<Entry> entry(new Entry());
+	entry->key = key;
+	entry->hash = hash;
+	entries.push_back(move(entry));
+	candidates.push_back(id);
+	stats.pipelineCount++;
+
+	startCompile(id);
+	return id;
+}
+
+vector<PipelineManager::PipelineId> PipelineManager::prewarm(const vector<PipelineKey> &keys) {
+	vector<PipelineId> prewarmed;
+	prewarmed.reserve(keys.size());
+	for (const PipelineKey &key : keys) {
+		prewarmed.push_back(request(key));
+	}
+	return prewarmed;
+}
+
+VkPipeline PipelineManager::get(PipelineId id) {
+	unique_lock<std::mutex> lock(managerMutex);
+	Entry &entry = *entries[id];
+
+	if (entry.pipeline == VK_NULL_HANDLE && entry.compiling) {
+		chrono::high_resolution_clock::time_point waitStart = chrono::high_resolution_clock::now();
+		compileFinished.wait(lock, [&entry]() {
+			return entry.pipeline != VK_NULL_HANDLE || !entry.compiling;
+		});
+		stats.waitCount++;
+		stats.waitMilliseconds += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - waitStart).count();
+	}
+
+	if (entry.pipeline == VK_NULL_HANDLE) {
+		throw runtime_error("Failed to compile pipeline " + describe(entry.key) + " (" + entry.error + ")!");
+	}
+	return entry.pipeline;
+}
+
+uint32_t PipelineManager::reloadShader(const string &shaderName) {
+	lock_guard<std::mutex> lock(managerMutex);
+
+	uint32_t reloadCount = 0;
+	for (PipelineId id = 0; id < entries.size(); id++) {
+		Entry &entry = *entries[id];
+		if (entry.released || !entry.key.usesShader(shaderName)) {
+			continue;
+		}
+
+		//A compile in flight may have read the old code already.
+		if (entry.compiling) {
+			entry.dirty = true;
+		}
+		else {
+			startCompile(id);
+		}
+		reloadCount++;
+	}
+	return reloadCount;
+}
+
+vector<VkPipeline> PipelineManager::takeReplaced() {
+	lock_guard<std::mutex> lock(managerMutex);
+	vector<VkPipeline> taken;
+	taken.swap(replaced);
+	return taken;
+}
+
+void PipelineManager::release(PipelineId id) {
+	unique_lock<std::mutex> lock(managerMutex);
+	Entry &entry = *entries[id];
+	if (entry.released) {
+		return;
+	}
+
+	entry.dirty = false;
+	compileFinished.wait(lock, [&entry]() {
+		return !entry.compiling;
+	});
+
+	if (entry.pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(logicDevice, entry.pipeline, nullptr);
+		entry.pipeline = VK_NULL_HANDLE;
+	}
+	entry.released = true;
+	stats.pipelineCount--;
+
+	vector<PipelineId> &candidates = ids[entry.hash];
+	candidates.erase(find(candidates.begin(), candidates.end(), id));
+	if (candidates.empty()) {
+		ids.erase(entry.hash);
+	}
+}
+
+PipelineManager::Stats PipelineManager::getStats() {
+	lock_guard<std::mutex> lock(managerMutex);
+	return stats;
+}
+
+void PipelineManager::startCompile(PipelineId id) {
+	Entry &entry = *entries[id];
+	entry.compiling = true;
+	entry.dirty = false;
+
+	//The worker gets its own copy, the entry is only touched with managerMutex held.
+	PipelineKey key = entry.key;
+	workers->enqueue([this, id, key]() {
+		compile(id, key);
+	});
+}
+
+void PipelineManager::compile(PipelineId id, PipelineKey key) {
+	chrono::high_resolution_clock::time_point compileStart = chrono::high_resolution_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	string error;
+	try {
+		pipeline = build(key);
+	}
+	catch (const exception &e) {
+		error = e.what();
+	}
+
+	double milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - compileStart).count();
+
+	lock_guard<std::mutex> lock(managerMutex);
+	Entry &entry = *entries[id];
+
+	stats.compileCount++;
+	stats.compileMilliseconds += milliseconds;
+	stats.maxCompileMilliseconds = max(stats.maxCompileMilliseconds, milliseconds);
+
+	if (pipeline != VK_NULL_HANDLE) {
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			replaced.push_back(entry.pipeline);
+		}
+		entry.pipeline = pipeline;
+		entry.error.clear();
+	}
+	else {
+		//A reload that fails keeps the previous pipeline running until the shader is fixed.
+		stats.failedCount++;
+		entry.error = error;
+		cerr << "Pipeline " << describe(key) << " failed to compile: " << error << endl;
+	}
+
+	entry.compiling = false;
+	if (entry.dirty) {
+		startCompile(id);
+	}
+	compileFinished.notify_all();
+}
+
+VkPipeline PipelineManager::build(const PipelineKey &key) {
+	vector<VkPipelineShaderStageCreateInfo> stages;
+
+	//Modules are only needed while the pipeline is created.
+	auto destroyModules = [this, &stages]() {
+		for (const VkPipelineShaderStageCreateInfo &stage : stages) {
+			vkDestroyShaderModule(logicDevice, stage.module, nullptr);
+		}
+	};
+
+	try {
+		for (const PipelineKey::Stage &keyStage : key.stages) {
+			ShaderCode code = shaderLibrary->get(keyStage.shaderName);
+
+			VkShaderModuleCreateInfo moduleInfo = {};
+			moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			moduleInfo.codeSize = code.size;
+			moduleInfo.pCode = code.words;
+
+			VkShaderModule shaderModule;
+			if (vkCreateShaderModule(logicDevice, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+				throw runtime_error("Failed to create shader module " + keyStage.shaderName + "!");
+			}
+
+			VkPipelineShaderStageCreateInfo stage = {};
+			stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			stage.stage = keyStage.stage;
+			stage.module = shaderModule;
+			stage.pName = "main";
+			stages.push_back(stage);
+		}
+
+		VkPipeline pipeline = key.isCompute() ? buildCompute(key, stages) : buildGraphics(key, stages);
+		destroyModules();
+		return pipeline;
+	}
+	catch (...) {
+		destroyModules();
+		throw;
+	}
+}
+
+VkPipeline PipelineManager::buildCompute(const PipelineKey &key, const vector<VkPipelineShaderStageCreateInfo> &stages) {
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stages[0];
+	pipelineInfo.layout = key.layout;
+
+	VkPipeline pipeline;
+	if (vkCreateComputePipelines(logicDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw runtime_error("Failed to create compute pipeline!");
+	}
+
+	return pipeline;
+}
+
+VkPipeline PipelineManager::buildGraphics(const PipelineKey &key, const vector<VkPipelineShaderStageCreateInfo> &stages) {
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(key.bindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = key.bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(key.attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = key.attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = key.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	//Viewport and scissor are dynamic, so pipelines survive resizes.
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = nullptr;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = nullptr;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = key.polygonMode;
+	rasterizer.lineWidth = 1.f;
+	rasterizer.cullMode = key.cullMode;
+	rasterizer.frontFace = key.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.f;
+	multisampling.pSampleMask = nullptr;
+	multisampling.alphaToCoverageEnable = VK_FALSE;
+	multisampling.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = key.blendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(key.colorAttachmentCount, colorBlendAttachment);
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = key.colorAttachmentCount;
+	colorBlending.pAttachments = colorBlendAttachments.data();
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = key.depthTestEnable ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = key.depthWriteEnable ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = key.depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+	depthStencil.minDepthBounds = 0.f;
+	depthStencil.maxDepthBounds = 1.f;
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = static_cast<uint32_t>(stages.size());
+	pipelineCreateInfo.pStages = stages.data();
+	pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	pipelineCreateInfo.pRasterizationState = &rasterizer;
+	pipelineCreateInfo.pMultisampleState = &multisampling;
+	pipelineCreateInfo.pViewportState = &viewportState;
+	pipelineCreateInfo.pColorBlendState = &colorBlending;
+	pipelineCreateInfo.pDepthStencilState = &depthStencil;
+	pipelineCreateInfo.pDynamicState = &dynamicState;
+	pipelineCreateInfo.layout = key.layout;
+	pipelineCreateInfo.renderPass = key.renderPass;
+	pipelineCreateInfo.subpass = key.subpass;
+
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(logicDevice, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw runtime_error("Failed to create graphics pipeline!");
+	}
+
+	return pipeline;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderLibrary.h"
+#include "ThreadPool.h"
+
+// Everything a pipeline is built from. Equal keys build identical pipelines, so they share one.
+struct PipelineKey {
+	struct Stage {
+		VkShaderStageFlagBits stage;
+		// ShaderLibrary name, e.g. "vert.spv"
+		std::string shaderName;
+	};
+
+	// A single compute stage makes a compute pipeline, the state below is only used by graphics pipelines.
+	std::vector<Stage> stages;
+
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	// Standard alpha blending into every color attachment.
+	bool blendEnable = false;
+	uint32_t colorAttachmentCount = 1;
+
+	// Against the subpass's depth attachment, which must exist when either is set.
+	bool depthTestEnable = false;
+	bool depthWriteEnable = false;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	// VK_NULL_HANDLE for compute pipelines.
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+
+	static PipelineKey compute(const std::string &shaderName, VkPipelineLayout layout);
+
+	bool isCompute() const;
+	bool usesShader(const std::string &shaderName) const;
+
+	uint64_t hash() const;
+	bool operator==(const PipelineKey &other) const;
+};
+
+// Compiles pipelines on worker threads, so the thread recording frames never blocks on the driver's shader
+// compiler. Callers request every pipeline they know they will need as early as possible and only call get()
+// right before the first use, by which time the compile has usually finished. Requests of an equal key share
+// one pipeline and one compile. All pipelines go through the same VkPipelineCache and are owned by the
+// manager until release() or cleanup().
+class PipelineManager {
+
+public:
+	// Index of a requested key, stays valid until release().
+	typedef uint32_t PipelineId;
+
+	struct Stats {
+		// Pipelines requested and not released
+		uint32_t pipelineCount = 0;
+		uint32_t requestCount = 0;
+		// Requests that found an equal key requested before
+		uint32_t deduplicatedCount = 0;
+		// Finished compiles, including reloads
+		uint32_t compileCount = 0;
+		uint32_t failedCount = 0;
+		// Summed over all workers, more than the elapsed time when compiles overlap
+		double compileMilliseconds = 0.0;
+		double maxCompileMilliseconds = 0.0;
+		// get() calls that had to wait for a compile, and how long they waited in total
+		uint32_t waitCount = 0;
+		double waitMilliseconds = 0.0;
+	};
+
+	// 0 threads picks one worker per hardware thread, minus the calling thread.
+	void init(VkDevice logicDevice, VkPipelineCache pipelineCache, ShaderLibrary &shaderLibrary, uint32_t threadCount = 0);
+
+	// Waits for compiles in flight and destroys every pipeline, including replaced ones not taken yet.
+	// The device must be idle.
+	void cleanup();
+
+	// Queues a compile unless an equal key was requested before. Never blocks.
+	PipelineId request(const PipelineKey &key);
+
+	// Requests every key up front, so the workers compile them in parallel while the caller does other work.
+	std::vector<PipelineId> prewarm(const std::vector<PipelineKey> &keys);
+
+	// Waits until the pipeline has been compiled once, afterwards returns the latest successful compile
+	// without blocking, even while a reload is in flight. Throws when the first compile failed.
+	VkPipeline get(PipelineId id);
+
+	// Compiles every pipeline using shaderName again with the library's latest code. The previous pipeline
+	// stays valid until the new one is done, failed compiles keep it. Returns the number of pipelines affected.
+	uint32_t reloadShader(const std::string &shaderName);
+
+	// Pipelines replaced by reloads since the last call. The caller destroys them once no frame in flight
+	// uses them anymore, and picks up the new ones with get().
+	std::vector<VkPipeline> takeReplaced();
+
+	// Waits for a compile in flight, destroys the pipeline and forgets the key. The pipeline must not be
+	// in use anymore.
+	void release(PipelineId id);
+
+	Stats getStats();
+
+private:
+	struct Entry {
+		PipelineKey key;
+		uint64_t hash = 0;
+		// Latest successful compile
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		bool compiling = false;
+		// A shader changed while compiling, compiled once more when the current compile is done.
+		bool dirty = false;
+		bool released = false;
+		// Error of the last compile, cleared by a successful one
+		std::string error;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	ShaderLibrary* shaderLibrary = nullptr;
+	std::unique_ptr<ThreadPool> workers;
+
+	std::mutex managerMutex;
+	std::condition_variable compileFinished;
+	// Indexed by PipelineId, released entries are kept so ids are never reused.
+	std::vector<std::unique_ptr<Entry>> entries;
+	// Keyed by hash, entries sharing a hash are told apart by comparing their keys.
+	std::unordered_map<uint64_t, std::vector<PipelineId>> ids;
+	std::vector<VkPipeline> replaced;
+	Stats stats;
+
+	// Called with managerMutex held.
+	void startCompile(PipelineId id);
+
+	void compile(PipelineId id, PipelineKey key);
+
+	// Builds the pipeline on the calling thread, throws on failure.
+	VkPipeline build(const PipelineKey &key);
+	VkPipeline buildCompute(const PipelineKey &key, const std::vector<VkPipelineShaderStageCreateInfo> &stages);
+	VkPipeline buildGraphics(const PipelineKey &key, const std::vector<VkPipelineShaderStageCreateInfo> &stages);
+};
@@ -0,0 +1,747 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <ios>
+#include <stdexcept>
+
+using namespace std;
+
+//Access bits that make a resource's contents change, anything else only reads.
+static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+struct FlagName {
+	uint32_t flag;
+	const char* name;
+};
+
+static const FlagName STAGE_NAMES[] = {
+	{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "TOP_OF_PIPE" },
+	{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, "DRAW_INDIRECT" },
+	{ VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, "VERTEX_INPUT" },
+	{ VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, "VERTEX_SHADER" },
+	{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "FRAGMENT_SHADER" },
+	{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "EARLY_FRAGMENT_TESTS" },
+	{ VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "LATE_FRAGMENT_TESTS" },
+	{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "COLOR_ATTACHMENT_OUTPUT" },
+	{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "COMPUTE_SHADER" },
+	{ VK_PIPELINE_STAGE_TRANSFER_BIT, "TRANSFER" },
+	{ VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "BOTTOM_OF_PIPE" },
+	{ VK_PIPELINE_STAGE_HOST_BIT, "HOST" },
+	{ VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, "ALL_GRAPHICS" },
+	{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, "ALL_COMMANDS" }
+};
+
+static const FlagName ACCESS_NAMES[] = {
+	{ VK_ACCESS_INDIRECT_COMMAND_READ_BIT, "INDIRECT_COMMAND_READ" },
+	{ VK_ACCESS_SHADER_READ_BIT, "SHADER_READ" },
+	{ VK_ACCESS_SHADER_WRITE_BIT, "SHADER_WRITE" },
+	{ VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, "COLOR_ATTACHMENT_READ" },
+	{ VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, "COLOR_ATTACHMENT_WRITE" },
+	{ VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, "DEPTH_STENCIL_ATTACHMENT_READ" },
+	{ VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, "DEPTH_STENCIL_ATTACHMENT_WRITE" },
+	{ VK_ACCESS_TRANSFER_READ_BIT, "TRANSFER_READ" },
+	{ VK_ACCESS_TRANSFER_WRITE_BIT, "TRANSFER_WRITE" },
+	{ VK_ACCESS_HOST_READ_BIT, "HOST_READ" },
+	{ VK_ACCESS_HOST_WRITE_BIT, "HOST_WRITE" },
+	{ VK_ACCESS_MEMORY_READ_BIT, "MEMORY_READ" },
+	{ VK_ACCESS_MEMORY_WRITE_BIT, "MEMORY_WRITE" }
+};
+
+static const size_t STAGE_NAME_COUNT = sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+static const size_t ACCESS_NAME_COUNT = sizeof(ACCESS_NAMES) / sizeof(ACCESS_NAMES[0]);
+
+static string getFlagNames(uint32_t flags, const FlagName* names, size_t nameCount) {
+	if (flags == 0) {
+		return "0";
+	}
+	string result;
+	for (size_t i = 0; i < nameCount; i++) {
+		if (flags & names[i].flag) {
+			if (!result.empty()) {
+				result += "|";
+			}
+			result += names[i].name;
+		}
+	}
+	return result;
+}
+
+static const char* getLayoutName(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		return "UNDEFINED";
+	case VK_IMAGE_LAYOUT_GENERAL:
+		return "GENERAL";
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return "COLOR_ATTACHMENT_OPTIMAL";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		return "DEPTH_STENCIL_ATTACHMENT_OPTIMAL";
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return "SHADER_READ_ONLY_OPTIMAL";
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return "TRANSFER_SRC_OPTIMAL";
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return "TRANSFER_DST_OPTIMAL";
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return "PRESENT_SRC";
+	default:
+		return "OTHER";
+	}
+}
+
+static double toMegabytes(VkDeviceSize bytes) {
+	return bytes / (1024.0 * 1024.0);
+}
+
+static bool isDepthFormat(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool isDepthStencilFormat(VkFormat format) {
+	return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+void RenderGraph::init(VkDevice logicDevice, MemoryAllocator &memoryAllocator) {
+	this->logicDevice = logicDevice;
+	this->memoryAllocator = &memoryAllocator;
+}
+
+void RenderGraph::cleanup() {
+	Transients transients = takeTransients();
+	destroyTransients(logicDevice, *memoryAllocator, transients);
+}
+
+RenderGraph::Transients RenderGraph::takeTransients() {
+	Transients transients;
+	for (Resource &resource : resources) {
+		if (resource.transient) {
+			if (resource.imageView != VK_NULL_HANDLE) {
+				transients.imageViews.push_back(resource.imageView);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				transients.images.push_back(resource.image);
+			}
+		}
+	}
+	transients.allocations = heaps;
+
+	passes.clear();
+	resources.clear();
+	heaps.clear();
+	finalBarriers = BarrierBatch();
+	stats = Stats();
+	return transients;
+}
+
+void RenderGraph::destroyTransients(VkDevice logicDevice, MemoryAllocator &memoryAllocator, Transients &transients) {
+	for (VkImageView imageView : transients.imageViews) {
+		vkDestroyImageView(logicDevice, imageView, nullptr);
+	}
+	for (VkImage image : transients.images) {
+		vkDestroyImage(logicDevice, image, nullptr);
+	}
+	for (Allocation &allocation : transients.allocations) {
+		memoryAllocator.free(allocation);
+	}
+	transients = Transients();
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(const string &name, VkImageAspectFlags aspect, const State &initial) {
+	Resource resource;
+	resource.name = name;
+	resource.aspect = aspect;
+	resource.initialState = initial;
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const string &name, const State &initial) {
+	Resource resource;
+	resource.name = name;
+	resource.isImage = false;
+	resource.initialState = initial;
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::createImage(const string &name, VkFormat format, VkExtent2D extent) {
+	Resource resource;
+	resource.name = name;
+	resource.transient = true;
+	resource.format = format;
+	resource.extent = extent;
+	if (isDepthFormat(format)) {
+		resource.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	} else if (isDepthStencilFormat(format)) {
+		resource.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	} else {
+		resource.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+	resources.push_back(resource);
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void RenderGraph::exportResource(ResourceId resource, const State &finalState) {
+	resources[resource].exported = true;
+	resources[resource].finalState = finalState;
+}
+
+RenderGraph::PassId RenderGraph::addPass(const string &name, RecordFunction record) {
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+	passes.push_back(pass);
+	return static_cast<PassId>(passes.size() - 1);
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource, Usage usage) {
+	addUse(pass, resource, usage, false);
+}
+
+void RenderGraph::write(PassId pass, ResourceId resource, Usage usage) {
+	addUse(pass, resource, usage, true);
+}
+
+void RenderGraph::setSideEffects(PassId pass) {
+	passes[pass].sideEffects = true;
+}
+
+void RenderGraph::addUse(PassId pass, ResourceId resource, Usage usage, bool write) {
+	Use use = {};
+	use.resource = resource;
+	use.read = !write;
+	use.write = write;
+
+	VkImageUsageFlags imageUsage = 0;
+	switch (usage) {
+	case Usage::ColorAttachment:
+		use.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		use.access = write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+		use.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		break;
+	case Usage::DepthAttachment:
+		//Depth tests read the attachment even when the pass only declares the write.
+		use.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		use.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+		use.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		imageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		break;
+	case Usage::FragmentSampled:
+		if (write) {
+			throw runtime_error("Failed to add render graph write, sampled resources are read only!");
+		}
+		use.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		use.access = VK_ACCESS_SHADER_READ_BIT;
+		use.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		break;
+	case Usage::ComputeStorage:
+		use.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		use.access = write ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+		use.layout = VK_IMAGE_LAYOUT_GENERAL;
+		imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+		break;
+	case Usage::IndirectArguments:
+		if (write) {
+			throw runtime_error("Failed to add render graph write, indirect arguments are read only!");
+		}
+		use.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		use.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		use.layout = VK_IMAGE_LAYOUT_GENERAL;
+		break;
+	case Usage::Transfer:
+		use.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		use.access = write ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+		use.layout = write ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageUsage = write ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		break;
+	}
+
+	Resource &target = resources[resource];
+	if (!target.isImage) {
+		use.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+	target.usage |= imageUsage;
+
+	//One use per resource and pass, the barrier in front of the pass covers all of them.
+	for (Use &existing : passes[pass].uses) {
+		if (existing.resource == resource) {
+			if (existing.layout != use.layout) {
+				throw runtime_error("Failed to add render graph use, one pass needs " + target.name + " in two layouts!");
+			}
+			existing.stages |= use.stages;
+			existing.access |= use.access;
+			existing.read = existing.read || use.read;
+			existing.write = existing.write || use.write;
+			return;
+		}
+	}
+	passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+
+	for (uint32_t i = 0; i < passes.size(); i++) {
+		if (passes[i].culled) {
+			continue;
+		}
+		for (const Use &use : passes[i].uses) {
+			Resource &resource = resources[use.resource];
+			resource.firstPass = min(resource.firstPass, i);
+			resource.lastPass = resource.lastPass == NONE ? i : max(resource.lastPass, i);
+		}
+	}
+
+	createTransients();
+	placeTransients();
+	deriveBarriers();
+
+	stats.passCount = static_cast<uint32_t>(passes.size());
+	for (const Pass &pass : passes) {
+		if (pass.culled) {
+			stats.culledPassCount++;
+		} else if (!pass.barriers.barriers.empty()) {
+			stats.barrierCount += static_cast<uint32_t>(pass.barriers.barriers.size());
+			stats.barrierBatchCount++;
+		}
+	}
+	if (!finalBarriers.barriers.empty()) {
+		stats.barrierCount += static_cast<uint32_t>(finalBarriers.barriers.size());
+		stats.barrierBatchCount++;
+	}
+}
+
+void RenderGraph::cullPasses() {
+	//Walks the passes backwards, a pass survives when it has side effects or writes something a later
+	//surviving pass reads or the frame exports. Reads of surviving passes are needed in turn.
+	vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++) {
+		needed[i] = resources[i].exported;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass &pass = passes[i];
+		bool alive = pass.sideEffects;
+		for (const Use &use : pass.uses) {
+			if (use.write && needed[use.resource]) {
+				alive = true;
+			}
+		}
+		pass.culled = !alive;
+		if (alive) {
+			for (const Use &use : pass.uses) {
+				if (use.read) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+	}
+}
+
+void RenderGraph::createTransients() {
+	for (Resource &resource : resources) {
+		if (!resource.transient || resource.firstPass == NONE) {
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = resource.extent.width;
+		imageInfo.extent.height = resource.extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(logicDevice, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+			throw runtime_error("Failed to create render graph image " + resource.name + "!");
+		}
+		vkGetImageMemoryRequirements(logicDevice, resource.image, &resource.memReqs);
+		stats.transientCount++;
+		stats.transientBytes += resource.memReqs.size;
+	}
+}
+
+void RenderGraph::placeTransients() {
+	//Transients sharing a memory type filter share one allocation. Largest first, each goes to the lowest
+	//offset that does not overlap a transient already placed whose lifetime overlaps its own.
+	vector<uint32_t> heapTypeBits;
+	vector<vector<ResourceId>> heapResources;
+	for (ResourceId id = 0; id < resources.size(); id++) {
+		const Resource &resource = resources[id];
+		if (resource.image == VK_NULL_HANDLE || !resource.transient) {
+			continue;
+		}
+		size_t heap = find(heapTypeBits.begin(), heapTypeBits.end(), resource.memReqs.memoryTypeBits) - heapTypeBits.begin();
+		if (heap == heapTypeBits.size()) {
+			heapTypeBits.push_back(resource.memReqs.memoryTypeBits);
+			heapResources.emplace_back();
+		}
+		heapResources[heap].push_back(id);
+	}
+
+	for (size_t heap = 0; heap < heapResources.size(); heap++) {
+		vector<ResourceId> &ids = heapResources[heap];
+		stable_sort(ids.begin(), ids.end(), [this](ResourceId a, ResourceId b) {
+			return resources[a].memReqs.size > resources[b].memReqs.size;
+		});
+
+		VkMemoryRequirements heapReqs = {};
+		heapReqs.memoryTypeBits = heapTypeBits[heap];
+		heapReqs.alignment = 1;
+
+		vector<ResourceId> placed;
+		for (ResourceId id : ids) {
+			Resource &resource = resources[id];
+			VkDeviceSize alignment = resource.memReqs.alignment;
+			VkDeviceSize offset = 0;
+			bool moved = true;
+			while (moved) {
+				moved = false;
+				for (ResourceId other : placed) {
+					const Resource &o = resources[other];
+					bool livesTogether = resource.firstPass <= o.lastPass && o.firstPass <= resource.lastPass;
+					bool overlaps = offset < o.offset + o.memReqs.size && o.offset < offset + resource.memReqs.size;
+					if (livesTogether && overlaps) {
+						offset = (o.offset + o.memReqs.size + alignment - 1) / alignment * alignment;
+						moved = true;
+					}
+				}
+			}
+			resource.heap = static_cast<uint32_t>(heap);
+			resource.offset = offset;
+			placed.push_back(id);
+
+			heapReqs.size = max(heapReqs.size, offset + resource.memReqs.size);
+			heapReqs.alignment = max(heapReqs.alignment, alignment);
+		}
+
+		heaps.push_back(memoryAllocator->allocate(heapReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true));
+		stats.allocatedBytes += heapReqs.size;
+	}
+
+	for (Resource &resource : resources) {
+		if (resource.heap == NONE) {
+			continue;
+		}
+		const Allocation &allocation = heaps[resource.heap];
+		if (vkBindImageMemory(logicDevice, resource.image, allocation.memory, allocation.offset + resource.offset) != VK_SUCCESS) {
+			throw runtime_error("Failed to bind render graph image memory " + resource.name + "!");
+		}
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.format;
+		viewInfo.subresourceRange.aspectMask = resource.aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(logicDevice, &viewInfo, nullptr, &resource.imageView) != VK_SUCCESS) {
+			throw runtime_error("Failed to create render graph image view " + resource.name + "!");
+		}
+	}
+}
+
+RenderGraph::State RenderGraph::getAliasedState(ResourceId id) const {
+	//The first use of a transient waits for whatever last touched its bytes: transients placed over it that
+	//end before it starts, or when none does, the transients of the previous frame that end last.
+	const Resource &resource = resources[id];
+	vector<ResourceId> before;
+	vector<ResourceId> wrapped;
+	for (ResourceId other = 0; other < resources.size(); other++) {
+		const Resource &o = resources[other];
+		if (o.heap != resource.heap) {
+			continue;
+		}
+		bool overlaps = resource.offset < o.offset + o.memReqs.size && o.offset < resource.offset + resource.memReqs.size;
+		if (!overlaps) {
+			continue;
+		}
+		if (o.lastPass < resource.firstPass) {
+			before.push_back(other);
+		} else {
+			wrapped.push_back(other);
+		}
+	}
+	vector<ResourceId> &previous = before.empty() ? wrapped : before;
+
+	State state;
+	state.stages = 0;
+	for (ResourceId other : previous) {
+		const Resource &o = resources[other];
+		for (const Use &use : passes[o.lastPass].uses) {
+			if (use.resource == other) {
+				state.stages |= use.stages;
+			}
+		}
+		//Writes before the last use were made visible to it, only its own writes are still pending.
+		for (uint32_t i = o.lastPass + 1; i-- > o.firstPass;) {
+			if (passes[i].culled) {
+				continue;
+			}
+			bool written = false;
+			for (const Use &use : passes[i].uses) {
+				if (use.resource == other && use.write) {
+					state.stages |= use.stages;
+					state.access |= use.access & WRITE_ACCESS;
+					written = true;
+				}
+			}
+			if (written) {
+				break;
+			}
+		}
+	}
+	return state;
+}
+
+void RenderGraph::deriveBarriers() {
+	struct Tracked {
+		VkImageLayout layout;
+		// Stages and writes a following write or layout change has to wait for
+		VkPipelineStageFlags writeStages;
+		VkAccessFlags writeAccess;
+		VkPipelineStageFlags readStages;
+		// Where the last write is already visible, reads there need no barrier
+		VkPipelineStageFlags visibleStages;
+		VkAccessFlags visibleAccess;
+	};
+
+	vector<Tracked> tracked(resources.size());
+	for (ResourceId id = 0; id < resources.size(); id++) {
+		const Resource &resource = resources[id];
+		State state = resource.heap != NONE ? getAliasedState(id) : resource.initialState;
+		Tracked &t = tracked[id];
+		t.layout = resource.transient ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+		t.writeStages = state.stages;
+		t.writeAccess = state.access;
+		t.readStages = 0;
+		t.visibleStages = 0;
+		t.visibleAccess = 0;
+	}
+
+	auto addBarrier = [this](BarrierBatch &batch, ResourceId id, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+		VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, VkImageLayout oldLayout, VkImageLayout newLayout) {
+		batch.srcStages |= srcStages;
+		batch.dstStages |= dstStages;
+		Barrier barrier = { id, srcAccess, dstAccess, oldLayout, newLayout };
+		batch.barriers.push_back(barrier);
+	};
+
+	for (Pass &pass : passes) {
+		pass.barriers = BarrierBatch();
+		if (pass.culled) {
+			continue;
+		}
+		for (const Use &use : pass.uses) {
+			const Resource &resource = resources[use.resource];
+			Tracked &t = tracked[use.resource];
+			bool layoutChange = resource.isImage && (use.layout != t.layout || t.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+
+			if (layoutChange || use.write) {
+				//Write after read or write, or a layout change, waits for every earlier use.
+				VkPipelineStageFlags srcStages = t.writeStages | t.readStages;
+				bool pending = (srcStages & ~VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) != 0 || t.writeAccess != 0;
+				if (pending || layoutChange) {
+					addBarrier(pass.barriers, use.resource, srcStages, t.writeAccess, use.stages, use.access, t.layout, use.layout);
+				}
+				t.layout = use.layout;
+				if (use.write) {
+					t.writeStages = use.stages;
+					t.writeAccess = use.access & WRITE_ACCESS;
+					t.readStages = 0;
+					t.visibleStages = 0;
+					t.visibleAccess = 0;
+				} else {
+					//Later readers in other stages chain through this one, which ran after the transition.
+					t.writeStages = use.stages;
+					t.writeAccess = 0;
+					t.readStages = use.stages;
+					t.visibleStages = use.stages;
+					t.visibleAccess = use.access;
+				}
+			} else {
+				//Read after write, only where the write is not visible yet.
+				bool visible = (use.stages & ~t.visibleStages) == 0 && (use.access & ~t.visibleAccess) == 0;
+				if (t.writeStages != 0 && !visible) {
+					addBarrier(pass.barriers, use.resource, t.writeStages, t.writeAccess, use.stages, use.access, t.layout, t.layout);
+					t.visibleStages |= use.stages;
+					t.visibleAccess |= use.access;
+				}
+				t.readStages |= use.stages;
+			}
+		}
+	}
+
+	finalBarriers = BarrierBatch();
+	for (ResourceId id = 0; id < resources.size(); id++) {
+		const Resource &resource = resources[id];
+		if (!resource.exported || resource.firstPass == NONE) {
+			continue;
+		}
+		const Tracked &t = tracked[id];
+		const State &finalState = resource.finalState;
+		VkImageLayout newLayout = finalState.layout == VK_IMAGE_LAYOUT_UNDEFINED ? t.layout : finalState.layout;
+		bool layoutChange = resource.isImage && newLayout != t.layout;
+		bool invisible = finalState.access != 0 && t.writeAccess != 0;
+		if (layoutChange || invisible) {
+			addBarrier(finalBarriers, id, t.writeStages | t.readStages, t.writeAccess, finalState.stages, finalState.access, t.layout, newLayout);
+		}
+	}
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+	for (const Pass &pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+		recordBarriers(commandBuffer, pass.barriers);
+		pass.record(commandBuffer);
+	}
+	recordBarriers(commandBuffer, finalBarriers);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch &batch) const {
+	if (batch.barriers.empty()) {
+		return;
+	}
+
+	vector<VkImageMemoryBarrier> imageBarriers;
+	vector<VkBufferMemoryBarrier> bufferBarriers;
+	for (const Barrier &barrier : batch.barriers) {
+		const Resource &resource = resources[barrier.resource];
+		if (resource.isImage) {
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = barrier.srcAccess;
+			imageBarrier.dstAccessMask = barrier.dstAccess;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = resource.image;
+			imageBarrier.subresourceRange.aspectMask = resource.aspect;
+			imageBarrier.subresourceRange.baseMipLevel = 0;
+			imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			imageBarrier.subresourceRange.baseArrayLayer = 0;
+			imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+			imageBarriers.push_back(imageBarrier);
+		} else {
+			VkBufferMemoryBarrier bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+	}
+
+	//Empty stage masks are invalid, a barrier without anything to wait for waits for the top of the pipe.
+	VkPipelineStageFlags srcStages = batch.srcStages;
+	if (srcStages == 0) {
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	VkPipelineStageFlags dstStages = batch.dstStages;
+	if (dstStages == 0) {
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::setImage(ResourceId resource, VkImage image) {
+	resources[resource].image = image;
+}
+
+void RenderGraph::setBuffer(ResourceId resource, VkBuffer buffer) {
+	resources[resource].buffer = buffer;
+}
+
+VkImageView RenderGraph::getImageView(ResourceId resource) const {
+	return resources[resource].imageView;
+}
+
+RenderGraph::Stats RenderGraph::getStats() const {
+	return stats;
+}
+
+void RenderGraph::dumpBatch(ostream &out, const BarrierBatch &batch) const {
+	if (batch.barriers.empty()) {
+		out << "\t\tno barrier" << endl;
+		return;
+	}
+	out << "\t\tbarrier " << getFlagNames(batch.srcStages, STAGE_NAMES, STAGE_NAME_COUNT) << " -> "
+		<< getFlagNames(batch.dstStages, STAGE_NAMES, STAGE_NAME_COUNT) << endl;
+	for (const Barrier &barrier : batch.barriers) {
+		const Resource &resource = resources[barrier.resource];
+		out << "\t\t\t" << resource.name << ": " << getFlagNames(barrier.srcAccess, ACCESS_NAMES, ACCESS_NAME_COUNT) << " -> "
+			<< getFlagNames(barrier.dstAccess, ACCESS_NAMES, ACCESS_NAME_COUNT);
+		if (resource.isImage && barrier.oldLayout != barrier.newLayout) {
+			out << ", " << getLayoutName(barrier.oldLayout) << " -> " << getLayoutName(barrier.newLayout);
+		}
+		out << endl;
+	}
+}
+
+void RenderGraph::dump(ostream &out) const {
+	out << "Render graph, " << stats.passCount << " passes (" << stats.culledPassCount << " culled), " << stats.barrierCount
+		<< " barriers in " << stats.barrierBatchCount << " vkCmdPipelineBarrier calls:" << endl;
+	for (size_t i = 0; i < passes.size(); i++) {
+		const Pass &pass = passes[i];
+		out << "\t" << i << " " << pass.name;
+		if (pass.culled) {
+			out << " (culled)" << endl;
+			continue;
+		}
+		out << endl;
+		dumpBatch(out, pass.barriers);
+	}
+	out << "\tend of frame" << endl;
+	dumpBatch(out, finalBarriers);
+
+	//Megabytes with two decimals. The caller's formatting is restored once the graph is written.
+	ios_base::fmtflags flags = out.flags();
+	streamsize precision = out.precision(2);
+	out << fixed;
+	for (const Resource &resource : resources) {
+		if (!resource.transient) {
+			continue;
+		}
+		out << "\ttransient " << resource.name << ": ";
+		if (resource.heap == NONE) {
+			out << "unused" << endl;
+			continue;
+		}
+		out << toMegabytes(resource.memReqs.size) << " MB at heap " << resource.heap << " offset " << resource.offset
+			<< ", passes " << resource.firstPass << "-" << resource.lastPass << endl;
+	}
+	out << "\ttransients " << toMegabytes(stats.transientBytes) << " MB in " << toMegabytes(stats.allocatedBytes)
+		<< " MB, aliasing saved " << toMegabytes(stats.transientBytes - stats.allocatedBytes) << " MB" << endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// Frame graph built once per swapchain. Passes declare which resources they read and write, and compile
+// - culls passes whose results nothing consumes, walking back from exported resources and side effect passes,
+// - derives the pipeline barriers and layout transitions between passes, batched into one
+//   vkCmdPipelineBarrier per pass and skipped where an earlier barrier already made a write visible,
+// - creates the transient images and places them in shared memory, two transients whose lifetimes do not
+//   overlap alias the same bytes.
+// Imported resources are owned by the caller, who sets their handles before every execute.
+class RenderGraph {
+
+public:
+	typedef uint32_t ResourceId;
+	typedef uint32_t PassId;
+
+	// Records the commands of one pass. Barriers declared through read/write are already recorded.
+	typedef std::function<void(VkCommandBuffer commandBuffer)> RecordFunction;
+
+	// How a pass uses a resource. Together with read or write it gives the stages, access mask and image layout.
+	enum class Usage {
+		ColorAttachment,
+		DepthAttachment,
+		FragmentSampled,
+		ComputeStorage,
+		IndirectArguments,
+		Transfer
+	};
+
+	// Synchronization scope a resource is in before the first pass or has to be in after the last one.
+	struct State {
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		VkAccessFlags access = 0;
+		// VK_IMAGE_LAYOUT_UNDEFINED discards the contents on the first use, or keeps the last layout on export.
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	struct Stats {
+		uint32_t passCount = 0;
+		uint32_t culledPassCount = 0;
+		// Image and buffer barriers recorded per frame, and the vkCmdPipelineBarrier calls carrying them.
+		uint32_t barrierCount = 0;
+		uint32_t barrierBatchCount = 0;
+		uint32_t transientCount = 0;
+		// Sum of the transients' sizes, and the memory they actually occupy after aliasing.
+		VkDeviceSize transientBytes = 0;
+		VkDeviceSize allocatedBytes = 0;
+	};
+
+	// Images and memory of a compiled graph, kept alive until the GPU is done with them when the graph is rebuilt.
+	struct Transients {
+		std::vector<VkImage> images;
+		std::vector<VkImageView> imageViews;
+		std::vector<Allocation> allocations;
+	};
+
+	void init(VkDevice logicDevice, MemoryAllocator &memoryAllocator);
+
+	// Destroys the transients and forgets all passes and resources.
+	void cleanup();
+
+	// Forgets all passes and resources and hands the transients to the caller, see destroyTransients.
+	Transients takeTransients();
+	static void destroyTransients(VkDevice logicDevice, MemoryAllocator &memoryAllocator, Transients &transients);
+
+	// aspect is VK_IMAGE_ASPECT_COLOR_BIT etc.
+	ResourceId importImage(const std::string &name, VkImageAspectFlags aspect, const State &initial);
+	ResourceId importBuffer(const std::string &name, const State &initial);
+	// Transient image of a single mip level and layer, its usage flags are derived from the passes using it.
+	ResourceId createImage(const std::string &name, VkFormat format, VkExtent2D extent);
+
+	// Keeps the passes producing the resource alive and leaves it in the final state after the last pass.
+	void exportResource(ResourceId resource, const State &finalState);
+
+	PassId addPass(const std::string &name, RecordFunction record);
+	void read(PassId pass, ResourceId resource, Usage usage);
+	void write(PassId pass, ResourceId resource, Usage usage);
+	// Keeps the pass even if it writes nothing consumed by the graph, e.g. uploads or queries.
+	void setSideEffects(PassId pass);
+
+	void compile();
+	void execute(VkCommandBuffer commandBuffer);
+
+	// Handles of imported resources, valid for the next execute.
+	void setImage(ResourceId resource, VkImage image);
+	void setBuffer(ResourceId resource, VkBuffer buffer);
+
+	// Only for transients, VK_NULL_HANDLE before compile.
+	VkImageView getImageView(ResourceId resource) const;
+
+	Stats getStats() const;
+
+	// Lists every pass with the barriers recorded before it, culled passes and the transients' memory offsets.
+	void dump(std::ostream &out) const;
+
+private:
+	static const uint32_t NONE = ~0u;
+
+	struct Use {
+		ResourceId resource;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool read;
+		bool write;
+	};
+
+	struct Barrier {
+		ResourceId resource;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+	};
+
+	struct BarrierBatch {
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<Barrier> barriers;
+	};
+
+	struct Pass {
+		std::string name;
+		RecordFunction record;
+		std::vector<Use> uses;
+		bool sideEffects = false;
+		bool culled = false;
+		BarrierBatch barriers;
+	};
+
+	struct Resource {
+		std::string name;
+		bool isImage = true;
+		bool transient = false;
+		VkImageAspectFlags aspect = 0;
+		State initialState;
+		bool exported = false;
+		State finalState;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		// Transients only
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+		VkImageUsageFlags usage = 0;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkMemoryRequirements memReqs = {};
+		uint32_t firstPass = NONE;
+		uint32_t lastPass = NONE;
+		uint32_t heap = NONE;
+		VkDeviceSize offset = 0;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	MemoryAllocator* memoryAllocator = nullptr;
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	// One allocation per memory type filter shared by the transients placed in it.
+	std::vector<Allocation> heaps;
+	BarrierBatch finalBarriers;
+	Stats stats;
+
+	void addUse(PassId pass, ResourceId resource, Usage usage, bool write);
+	void cullPasses();
+	void createTransients();
+	void placeTransients();
+	void deriveBarriers();
+	State getAliasedState(ResourceId resource) const;
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch &batch) const;
+	void dumpBatch(std::ostream &out, const BarrierBatch &batch) const;
+};
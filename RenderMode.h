@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// How the scene's objects are turned into draws.
+enum class RenderMode {
+	// One vkCmdDrawIndexed per object, recorded in parallel for large scenes.
+	CpuDraws,
+	// Culled on the GPU into indirect draws.
+	GpuDriven,
+	// Every object in a single vkCmdDrawIndexed with instanceCount set to the object count, nothing is culled.
+	Instanced
+};
+
+// The mode the device can run requested in, given the features enabled on it. GpuDriven falls back to CpuDraws
+// without drawIndirectFirstInstance, the indirect draws carry the object index in firstInstance. Has to be
+// decided before anything is built for the mode, e.g. the render graph's cull pass.
+inline RenderMode resolveRenderMode(RenderMode requested, const VkPhysicalDeviceFeatures &enabledFeatures) {
+	if (requested == RenderMode::GpuDriven && !enabledFeatures.drawIndirectFirstInstance) {
+		return RenderMode::CpuDraws;
+	}
+	return requested;
+}
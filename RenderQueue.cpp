@@ -0,0 +1,94 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+
+using namespace std;
+
+static const uint32_t DIGIT_BITS = 8;
+static const uint32_t DIGIT_COUNT = 64 / DIGIT_BITS;
+static const uint32_t BUCKET_COUNT = 1 << DIGIT_BITS;
+
+uint64_t RenderQueue::makeKey(uint32_t pipeline, uint32_t material, float depth) {
+	//Non negative floats order like their bit patterns, so the depth needs no quantization. The negated
+	//comparison also maps NaN to 0.
+	if (!(depth > 0.f)) {
+		depth = 0.f;
+	}
+	else if (depth > 1.f) {
+		depth = 1.f;
+	}
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	uint64_t pipelineBits = pipeline & ((1u << PIPELINE_BITS) - 1);
+	uint64_t materialBits = material & ((1u << MATERIAL_BITS) - 1);
+	return (pipelineBits << (MATERIAL_BITS + DEPTH_BITS)) | (materialBits << DEPTH_BITS) | depthBits;
+}
+
+uint32_t RenderQueue::getPipeline(uint64_t key) {
+	return static_cast<uint32_t>(key >> (MATERIAL_BITS + DEPTH_BITS));
+}
+
+uint32_t RenderQueue::getMaterial(uint64_t key) {
+	return static_cast<uint32_t>(key >> DEPTH_BITS) & ((1u << MATERIAL_BITS) - 1);
+}
+
+void RenderQueue::clear() {
+	items.clear();
+}
+
+void RenderQueue::push(uint64_t key, uint32_t drawIndex) {
+	items.push_back({ key, drawIndex });
+}
+
+void RenderQueue::sort() {
+	sortPasses = 0;
+	uint32_t count = static_cast<uint32_t>(items.size());
+	if (count < 2) {
+		return;
+	}
+
+	//Histograms of every digit in a single read of the keys.
+	uint32_t counts[DIGIT_COUNT][BUCKET_COUNT] = {};
+	for (const Item &item : items) {
+		for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++) {
+			counts[digit][(item.key >> (digit * DIGIT_BITS)) & (BUCKET_COUNT - 1)]++;
+		}
+	}
+
+	scratch.resize(count);
+	for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++) {
+		uint32_t* digitCounts = counts[digit];
+		uint32_t shift = digit * DIGIT_BITS;
+
+		//All keys share this digit, e.g. the pipeline bits of a single pipeline pass, the order stays as is.
+		if (digitCounts[(items[0].key >> shift) & (BUCKET_COUNT - 1)] == count) {
+			continue;
+		}
+
+		uint32_t offsets[BUCKET_COUNT];
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+			offsets[bucket] = offset;
+			offset += digitCounts[bucket];
+		}
+
+		for (const Item &item : items) {
+			scratch[offsets[(item.key >> shift) & (BUCKET_COUNT - 1)]++] = item;
+		}
+		items.swap(scratch);
+		sortPasses++;
+	}
+}
+
+const vector<RenderQueue::Item>& RenderQueue::getItems() const {
+	return items;
+}
+
+uint32_t RenderQueue::size() const {
+	return static_cast<uint32_t>(items.size());
+}
+
+uint32_t RenderQueue::getSortPasses() const {
+	return sortPasses;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Draws of one pass, ordered by 64 bit sort keys. The pipeline sits in the top bits, then the material, then
+// the depth, so a sorted queue binds every pipeline once, keeps draws sharing a material together and draws
+// opaque geometry front to back within each group, letting early depth tests reject hidden fragments.
+// Sorting is a least significant digit radix sort over 8 bit digits. Digits every key shares are skipped,
+// and both buffers are kept across frames so a queue of the same size never allocates.
+class RenderQueue {
+
+public:
+	static const uint32_t PIPELINE_BITS = 12;
+	static const uint32_t MATERIAL_BITS = 20;
+	static const uint32_t DEPTH_BITS = 32;
+
+	struct Item {
+		uint64_t key;
+		// Caller defined, e.g. an object index
+		uint32_t drawIndex;
+	};
+
+	// depth is the clip space depth in [0, 1], smaller draws first. Values outside are clamped, pipeline and
+	// material are truncated to their bit counts.
+	static uint64_t makeKey(uint32_t pipeline, uint32_t material, float depth);
+	static uint32_t getPipeline(uint64_t key);
+	static uint32_t getMaterial(uint64_t key);
+
+	void clear();
+	void push(uint64_t key, uint32_t drawIndex);
+
+	// Stable, items with equal keys keep the order they were pushed in.
+	void sort();
+
+	const std::vector<Item>& getItems() const;
+	uint32_t size() const;
+
+	// Digits the last sort had to move items for, out of 8.
+	uint32_t getSortPasses() const;
+
+private:
+	std::vector<Item> items;
+	std::vector<Item> scratch;
+	uint32_t sortPasses = 0;
+};
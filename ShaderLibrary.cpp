@@ -0,0 +1,155 @@
+#include "ShaderLibrary.h"
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+// Time between two checks of the watched files.
+static const chrono::milliseconds WATCH_INTERVAL(250);
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+bool ShaderLibrary::isEmbedded() {
+#ifdef EMBED_SHADERS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ShaderLibrary::init(const string &directory) {
+	this->directory = directory;
+}
+
+void ShaderLibrary::cleanup() {
+	if (watchThread.joinable()) {
+		{
+			lock_guard<std::mutex> lock(shaderMutex);
+			stopping = true;
+		}
+		stopCondition.notify_all();
+		watchThread.join();
+	}
+
+	fileShaders.clear();
+	changes.clear();
+}
+
+ShaderCode ShaderLibrary::get(const string &name) {
+	ShaderCode code;
+
+#ifdef EMBED_SHADERS
+	for (size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+		if (name == EMBEDDED_SHADERS[i].name) {
+			code.words = EMBEDDED_SHADERS[i].words;
+			code.size = EMBEDDED_SHADERS[i].size;
+			return code;
+		}
+	}
+	throw runtime_error("Shader " + name + " is not embedded!");
+#else
+	lock_guard<std::mutex> lock(shaderMutex);
+
+	map<string, FileShader>::iterator it = fileShaders.find(name);
+	if (it == fileShaders.end()) {
+		FileShader shader;
+		if (!readFile(directory + "/" + name, shader)) {
+			throw runtime_error("Failed to load shader " + directory + "/" + name + "!");
+		}
+		it = fileShaders.emplace(name, shader).first;
+	}
+
+	code.storage = it->second.code;
+	code.words = code.storage->data();
+	code.size = code.storage->size() * sizeof(uint32_t);
+	return code;
+#endif
+}
+
+void ShaderLibrary::startWatching() {
+	if (isEmbedded() || watchThread.joinable()) {
+		return;
+	}
+
+	stopping = false;
+	watchThread = thread(&ShaderLibrary::watchLoop, this);
+	cout << "Watching " << directory << " for shader changes" << endl;
+}
+
+vector<string> ShaderLibrary::takeChanges() {
+	lock_guard<std::mutex> lock(shaderMutex);
+
+	vector<string> result(changes.begin(), changes.end());
+	changes.clear();
+	return result;
+}
+
+void ShaderLibrary::watchLoop() {
+	unique_lock<std::mutex> lock(shaderMutex);
+
+	while (!stopCondition.wait_for(lock, WATCH_INTERVAL, [this]() { return stopping; })) {
+		//Files are checked and read without the lock, so get() never waits on the disk.
+		map<string, FileShader> watched = fileShaders;
+		lock.unlock();
+
+		map<string, FileShader> reloaded;
+		for (const auto &entry : watched) {
+			string fileName = directory + "/" + entry.first;
+
+			struct stat info;
+			if (stat(fileName.c_str(), &info) != 0) {
+				continue;
+			}
+			if (info.st_mtime == entry.second.modifiedTime && info.st_size == entry.second.fileSize) {
+				continue;
+			}
+
+			//A compiler still writing the file leaves it invalid, it is read again on the next check.
+			FileShader shader;
+			if (readFile(fileName, shader)) {
+				reloaded[entry.first] = shader;
+			}
+		}
+
+		lock.lock();
+		for (const auto &entry : reloaded) {
+			fileShaders[entry.first] = entry.second;
+			changes.insert(entry.first);
+		}
+	}
+}
+
+bool ShaderLibrary::readFile(const string &fileName, FileShader &shader) {
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0) {
+		return false;
+	}
+
+	ifstream file(fileName, ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	//The header alone is 5 words.
+	size_t size = static_cast<size_t>(info.st_size);
+	if (size < 5 * sizeof(uint32_t) || size % sizeof(uint32_t) != 0) {
+		return false;
+	}
+
+	shared_ptr<vector<uint32_t>> code = make_shared<vector<uint32_t>>(size / sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(code->data()), size);
+
+	if (!file || (*code)[0] != SPIRV_MAGIC) {
+		return false;
+	}
+
+	shader.code = code;
+	shader.modifiedTime = static_cast<int64_t>(info.st_mtime);
+	shader.fileSize = static_cast<int64_t>(info.st_size);
+	return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// SPIR-V words of one shader.
+struct ShaderCode {
+	const uint32_t* words = nullptr;
+	// In bytes, a multiple of 4.
+	size_t size = 0;
+	// Keeps code read from disk alive while a pipeline is built from it, null for embedded code.
+	std::shared_ptr<const std::vector<uint32_t>> storage;
+};
+
+// Hands out the compiled shaders by file name, e.g. "vert.spv". Builds with EMBED_SHADERS read them from
+// arrays compiled into the binary, without any file I/O. Other builds read them from a directory and can
+// watch it, so edited shaders are picked up while the application runs.
+class ShaderLibrary {
+
+public:
+	// One entry per shader, generated into EmbeddedShaders.cpp by cmake/EmbedShaders.cmake.
+	struct EmbeddedShader {
+		const char* name;
+		const uint32_t* words;
+		size_t size;
+	};
+
+	static bool isEmbedded();
+
+	// directory is ignored when the shaders are embedded.
+	void init(const std::string &directory);
+	void cleanup();
+
+	// Latest code of name, read from disk on first use. Throws when it is neither embedded nor a valid SPIR-V file.
+	ShaderCode get(const std::string &name);
+
+	// Starts a thread watching the modification time of every shader that was or will be loaded through get().
+	// Changed files are read on that thread, so get() returns the new code once takeChanges() has reported it.
+	// Does nothing when the shaders are embedded.
+	void startWatching();
+
+	// Names of the shaders that changed on disk since the last call. Never blocks on file I/O.
+	std::vector<std::string> takeChanges();
+
+private:
+	static const EmbeddedShader EMBEDDED_SHADERS[];
+	static const size_t EMBEDDED_SHADER_COUNT;
+
+	struct FileShader {
+		std::shared_ptr<const std::vector<uint32_t>> code;
+		// Modification time and size when code was read.
+		int64_t modifiedTime = 0;
+		int64_t fileSize = 0;
+	};
+
+	std::string directory;
+
+	std::mutex shaderMutex;
+	std::map<std::string, FileShader> fileShaders;
+	std::set<std::string> changes;
+
+	std::thread watchThread;
+	std::condition_variable stopCondition;
+	bool stopping = false;
+
+	void watchLoop();
+
+	// Reads and validates a SPIR-V file, returns false if the file is missing or not (yet) valid SPIR-V.
+	static bool readFile(const std::string &fileName, FileShader &shader);
+};
@@ -0,0 +1,86 @@
+#include "StagingRing.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+void StagingRing::init(VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize capacity, uint32_t frameCount) {
+	this->logicDevice = logicDevice;
+	this->capacity = capacity;
+	frameHeads.assign(frameCount, 0);
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = capacity;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(logicDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to create staging ring buffer!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(logicDevice, buffer, &memReqs);
+
+	allocation = memoryAllocator.allocate(memReqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkBindBufferMemory(logicDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw runtime_error("Failed to bind staging ring memory!");
+	}
+}
+
+void StagingRing::cleanup(MemoryAllocator &memoryAllocator) {
+	vkDestroyBuffer(logicDevice, buffer, nullptr);
+	memoryAllocator.free(allocation);
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, Region &region) {
+	if (size > capacity) {
+		throw runtime_error("Upload is larger than the staging ring!");
+	}
+
+	VkDeviceSize offset = head % capacity;
+	VkDeviceSize alignedOffset = (offset + alignment - 1) / alignment * alignment;
+
+	//Ranges never wrap, skip the tail end of the buffer instead.
+	if (alignedOffset + size > capacity) {
+		alignedOffset = 0;
+	}
+
+	VkDeviceSize needed = (alignedOffset >= offset ? alignedOffset - offset : capacity - offset + alignedOffset) + size;
+	if (head - tail + needed > capacity) {
+		return false;
+	}
+
+	head += needed;
+	frameHeads[currentFrame] = head;
+
+	region.buffer = buffer;
+	region.offset = alignedOffset;
+	region.size = size;
+	region.data = static_cast<char*>(allocation.mappedData) + alignedOffset;
+
+	return true;
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex) {
+	//Uploads made before the first frame are retired with it.
+	if (!firstFrame) {
+		tail = max(tail, frameHeads[frameIndex]);
+	}
+	firstFrame = false;
+	currentFrame = frameIndex;
+}
+
+void StagingRing::reset() {
+	tail = head;
+}
+
+VkDeviceSize StagingRing::getCapacity() const {
+	return capacity;
+}
+
+VkDeviceSize StagingRing::getUsed() const {
+	return head - tail;
+}
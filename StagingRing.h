@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// One persistently mapped host visible buffer that hands out staging ranges as a ring.
+// Ranges are tagged with the frame that was recorded when they were handed out and are
+// recycled once that frame's in flight fence has signalled.
+class StagingRing {
+
+public:
+	struct Region {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* data = nullptr;
+	};
+
+	void init(VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize capacity, uint32_t frameCount);
+	void cleanup(MemoryAllocator &memoryAllocator);
+
+	// Returns false when the ring has no room left until older frames complete.
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, Region &region);
+
+	// Call once the fence of frameIndex has signalled, recycles what that frame used last time around.
+	void beginFrame(uint32_t frameIndex);
+
+	// Recycles everything. Only valid when no submitted copy reads from the ring anymore.
+	void reset();
+
+	VkDeviceSize getCapacity() const;
+	VkDeviceSize getUsed() const;
+
+private:
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+	VkDeviceSize capacity = 0;
+
+	// Total bytes ever handed out and recycled, the ring offset is head % capacity.
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+
+	// Head at the last allocation of each frame.
+	std::vector<VkDeviceSize> frameHeads;
+	uint32_t currentFrame = 0;
+	bool firstFrame = true;
+};
@@ -0,0 +1,439 @@
+#include "TextureCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+const VkFormat TextureCodec::FORMATS[] = {
+	VK_FORMAT_R8G8B8A8_UNORM,
+	VK_FORMAT_BC1_RGBA_UNORM_BLOCK,
+	VK_FORMAT_BC3_UNORM_BLOCK,
+	VK_FORMAT_BC7_UNORM_BLOCK,
+	VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+};
+
+const uint32_t TextureCodec::FORMAT_COUNT = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+// One 16 bit endpoint of a BC color block, bits replicated into the low bits so 0 and 255 stay exact.
+static void unpack565(uint16_t color, uint32_t &r, uint32_t &g, uint32_t &b) {
+	uint32_t r5 = (color >> 11) & 31;
+	uint32_t g6 = (color >> 5) & 63;
+	uint32_t b5 = color & 31;
+	r = (r5 << 3) | (r5 >> 2);
+	g = (g6 << 2) | (g6 >> 4);
+	b = (b5 << 3) | (b5 >> 2);
+}
+
+static uint16_t pack565(uint32_t r, uint32_t g, uint32_t b) {
+	return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+static uint32_t packTexel(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+	//RGBA8 in memory order on little endian hosts, which every supported platform is.
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static uint16_t readUint16(const uint8_t* bytes) {
+	return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t readUint32(const uint8_t* bytes) {
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Color palette of a BC1 or BC3 color block. BC3 always uses four colors, BC1 switches to three colors
+// and transparent black when the first endpoint isn't the larger one.
+static void decodePalette(const uint8_t* block, bool allowThreeColors, uint32_t palette[4]) {
+	uint16_t color0 = readUint16(block);
+	uint16_t color1 = readUint16(block + 2);
+
+	uint32_t r0, g0, b0, r1, g1, b1;
+	unpack565(color0, r0, g0, b0);
+	unpack565(color1, r1, g1, b1);
+
+	palette[0] = packTexel(r0, g0, b0, 255);
+	palette[1] = packTexel(r1, g1, b1, 255);
+
+	if (color0 > color1 || !allowThreeColors) {
+		palette[2] = packTexel((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 255);
+		palette[3] = packTexel((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 255);
+	}
+	else {
+		palette[2] = packTexel((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 255);
+		palette[3] = 0;
+	}
+}
+
+#ifdef TEXTURE_CODEC_SSE2
+// Same palette as decodePalette, with both interpolated colors computed in one pass over 16 bit lanes.
+static __m128i decodePaletteSse2(const uint8_t* block, bool allowThreeColors) {
+	uint16_t color0 = readUint16(block);
+	uint16_t color1 = readUint16(block + 2);
+
+	uint32_t r0, g0, b0, r1, g1, b1;
+	unpack565(color0, r0, g0, b0);
+	unpack565(color1, r1, g1, b1);
+
+	//Lanes 0-3 hold one color, lanes 4-7 the other.
+	__m128i endpoints0 = _mm_setr_epi16(static_cast<short>(r0), static_cast<short>(g0), static_cast<short>(b0), 255,
+		static_cast<short>(r0), static_cast<short>(g0), static_cast<short>(b0), 255);
+	__m128i endpoints1 = _mm_setr_epi16(static_cast<short>(r1), static_cast<short>(g1), static_cast<short>(b1), 255,
+		static_cast<short>(r1), static_cast<short>(g1), static_cast<short>(b1), 255);
+	__m128i endpoints = _mm_unpacklo_epi64(endpoints0, endpoints1);
+
+	__m128i interpolated;
+	if (color0 > color1 || !allowThreeColors) {
+		//2 * c0 + c1 and c0 + 2 * c1, divided by 3 as a multiply by 65536 / 3, exact for sums up to 765.
+		__m128i sums = _mm_add_epi16(_mm_add_epi16(endpoints0, endpoints1), endpoints);
+		interpolated = _mm_mulhi_epu16(sums, _mm_set1_epi16(21846));
+	}
+	else {
+		//(c0 + c1) / 2, then transparent black.
+		__m128i average = _mm_srli_epi16(_mm_add_epi16(endpoints0, endpoints1), 1);
+		interpolated = _mm_unpacklo_epi64(average, _mm_setzero_si128());
+	}
+
+	return _mm_packus_epi16(endpoints, interpolated);
+}
+
+// Picks one of the four palette entries per texel, four texels at a time.
+static __m128i selectTexels(__m128i palette, __m128i indices) {
+	__m128i result = _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_setzero_si128()), _mm_shuffle_epi32(palette, 0x00));
+	result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_set1_epi32(1)), _mm_shuffle_epi32(palette, 0x55)));
+	result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_set1_epi32(2)), _mm_shuffle_epi32(palette, 0xaa)));
+	result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(indices, _mm_set1_epi32(3)), _mm_shuffle_epi32(palette, 0xff)));
+	return result;
+}
+#endif
+
+// 16 texels of a BC1 or BC3 color block, row by row.
+static void decodeColorBlock(const uint8_t* block, bool allowThreeColors, bool scalar, uint32_t texels[16]) {
+	uint32_t indices = readUint32(block + 4);
+
+#ifdef TEXTURE_CODEC_SSE2
+	if (!scalar) {
+		__m128i palette = decodePaletteSse2(block, allowThreeColors);
+		for (uint32_t row = 0; row < 4; row++) {
+			uint32_t rowIndices = indices >> (row * 8);
+			__m128i rowSelectors = _mm_setr_epi32(rowIndices & 3, (rowIndices >> 2) & 3, (rowIndices >> 4) & 3, (rowIndices >> 6) & 3);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + row * 4), selectTexels(palette, rowSelectors));
+		}
+		return;
+	}
+#endif
+
+	uint32_t palette[4];
+	decodePalette(block, allowThreeColors, palette);
+	for (uint32_t i = 0; i < 16; i++) {
+		texels[i] = palette[(indices >> (i * 2)) & 3];
+	}
+}
+
+// Alpha values of a BC3 alpha block, 3 bit indices into 8 values interpolated between two endpoints.
+static void decodeAlphaBlock(const uint8_t* block, uint8_t alphas[16]) {
+	uint32_t alpha0 = block[0];
+	uint32_t alpha1 = block[1];
+
+	uint32_t palette[8] = { alpha0, alpha1 };
+	if (alpha0 > alpha1) {
+		for (uint32_t i = 1; i < 7; i++) {
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+		}
+	}
+	else {
+		for (uint32_t i = 1; i < 5; i++) {
+			palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++) {
+		indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+	}
+	for (uint32_t i = 0; i < 16; i++) {
+		alphas[i] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+	}
+}
+
+// Index of the palette entry closest to texel, by squared distance over the used channels.
+template<uint32_t N>
+static uint32_t closestEntry(const uint32_t (&palette)[N], const uint8_t* texel, uint32_t channels) {
+	uint32_t best = 0;
+	uint32_t bestDistance = UINT32_MAX;
+	for (uint32_t i = 0; i < N; i++) {
+		uint32_t distance = 0;
+		for (uint32_t c = 0; c < channels; c++) {
+			int32_t difference = static_cast<int32_t>((palette[i] >> (c * 8)) & 0xff) - texel[c];
+			distance += static_cast<uint32_t>(difference * difference);
+		}
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			best = i;
+		}
+	}
+	return best;
+}
+
+// texels are 16 RGBA8 values, block receives 8 bytes.
+static void encodeColorBlock(const uint8_t* texels, uint8_t* block) {
+	uint32_t minimum[3] = { 255, 255, 255 };
+	uint32_t maximum[3] = { 0, 0, 0 };
+	for (uint32_t i = 0; i < 16; i++) {
+		for (uint32_t c = 0; c < 3; c++) {
+			minimum[c] = min(minimum[c], static_cast<uint32_t>(texels[i * 4 + c]));
+			maximum[c] = max(maximum[c], static_cast<uint32_t>(texels[i * 4 + c]));
+		}
+	}
+
+	//Insetting the box by 1/16 moves the endpoints off outliers, which lowers the error of the other texels.
+	for (uint32_t c = 0; c < 3; c++) {
+		uint32_t inset = (maximum[c] - minimum[c]) / 16;
+		minimum[c] += inset;
+		maximum[c] -= inset;
+	}
+
+	//The larger endpoint first selects the four color mode.
+	uint16_t color0 = pack565(maximum[0], maximum[1], maximum[2]);
+	uint16_t color1 = pack565(minimum[0], minimum[1], minimum[2]);
+	if (color0 < color1) {
+		swap(color0, color1);
+	}
+	block[0] = static_cast<uint8_t>(color0);
+	block[1] = static_cast<uint8_t>(color0 >> 8);
+	block[2] = static_cast<uint8_t>(color1);
+	block[3] = static_cast<uint8_t>(color1 >> 8);
+
+	//Equal endpoints would select the three color mode, every texel keeps index 0 instead.
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		uint32_t palette[4];
+		decodePalette(block, true, palette);
+		for (uint32_t i = 0; i < 16; i++) {
+			indices |= closestEntry(palette, texels + i * 4, 3) << (i * 2);
+		}
+	}
+
+	for (int i = 0; i < 4; i++) {
+		block[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+// texels are 16 RGBA8 values, block receives the 8 alpha bytes of a BC3 block.
+static void encodeAlphaBlock(const uint8_t* texels, uint8_t* block) {
+	uint32_t alpha0 = 0;
+	uint32_t alpha1 = 255;
+	for (uint32_t i = 0; i < 16; i++) {
+		alpha0 = max(alpha0, static_cast<uint32_t>(texels[i * 4 + 3]));
+		alpha1 = min(alpha1, static_cast<uint32_t>(texels[i * 4 + 3]));
+	}
+
+	block[0] = static_cast<uint8_t>(alpha0);
+	block[1] = static_cast<uint8_t>(alpha1);
+	uint64_t indices = 0;
+
+	//alpha0 > alpha1 selects the 8 value mode, equal endpoints keep every index at 0.
+	if (alpha0 != alpha1) {
+		uint32_t palette[8] = { alpha0, alpha1 };
+		for (uint32_t i = 1; i < 7; i++) {
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+		}
+		for (uint32_t i = 0; i < 16; i++) {
+			//closestEntry compares the first channel, the alpha value goes into a single byte.
+			uint8_t alpha = texels[i * 4 + 3];
+			indices |= static_cast<uint64_t>(closestEntry(palette, &alpha, 1)) << (i * 3);
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+bool TextureCodec::isKnownFormat(VkFormat format) {
+	return find(FORMATS, FORMATS + FORMAT_COUNT, format) != FORMATS + FORMAT_COUNT;
+}
+
+bool TextureCodec::isCompressed(VkFormat format) {
+	return isKnownFormat(format) && format != VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+const char* TextureCodec::getName(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		return "RGBA8";
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		return "BC1";
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		return "BC3";
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return "BC7";
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		return "ASTC4x4";
+	default:
+		return "unknown";
+	}
+}
+
+VkFormat TextureCodec::parseName(const string &name) {
+	for (uint32_t i = 0; i < FORMAT_COUNT; i++) {
+		if (name == getName(FORMATS[i])) {
+			return FORMATS[i];
+		}
+	}
+	throw runtime_error("Unknown texture format " + name);
+}
+
+uint32_t TextureCodec::getBlockExtent(VkFormat format) {
+	return format == VK_FORMAT_R8G8B8A8_UNORM ? 1 : 4;
+}
+
+uint32_t TextureCodec::getBlockBytes(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		return 4;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		return 16;
+	default:
+		throw runtime_error("Unknown texture format!");
+	}
+}
+
+VkDeviceSize TextureCodec::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	uint32_t blockExtent = getBlockExtent(format);
+	VkDeviceSize blocksWide = (width + blockExtent - 1) / blockExtent;
+	VkDeviceSize blocksHigh = (height + blockExtent - 1) / blockExtent;
+	return blocksWide * blocksHigh * getBlockBytes(format);
+}
+
+bool TextureCodec::canDecode(VkFormat format) {
+	return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK;
+}
+
+bool TextureCodec::canEncode(VkFormat format) {
+	return canDecode(format);
+}
+
+bool TextureCodec::hasSimd() {
+#ifdef TEXTURE_CODEC_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TextureCodec::decode(VkFormat format, uint32_t width, uint32_t height, const uint8_t* blocks, uint8_t* texels, bool scalar) {
+	if (format == VK_FORMAT_R8G8B8A8_UNORM) {
+		memcpy(texels, blocks, static_cast<size_t>(width) * height * 4);
+		return;
+	}
+	if (!canDecode(format)) {
+		throw runtime_error(string("Failed to decode ") + getName(format) + ", there is no CPU decoder for it!");
+	}
+
+	bool hasAlphaBlock = format == VK_FORMAT_BC3_UNORM_BLOCK;
+	uint32_t blockBytes = getBlockBytes(format);
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+
+	uint32_t blockTexels[16];
+	uint8_t alphas[16];
+
+	for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+		for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+			const uint8_t* block = blocks + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+
+			if (hasAlphaBlock) {
+				decodeColorBlock(block + 8, false, scalar, blockTexels);
+				decodeAlphaBlock(block, alphas);
+				for (uint32_t i = 0; i < 16; i++) {
+					blockTexels[i] = (blockTexels[i] & 0x00ffffff) | (static_cast<uint32_t>(alphas[i]) << 24);
+				}
+			}
+			else {
+				decodeColorBlock(block, true, scalar, blockTexels);
+			}
+
+			//Blocks at the right and bottom edges may hang over the level.
+			uint32_t rows = min(4u, height - blockY * 4);
+			uint32_t columns = min(4u, width - blockX * 4);
+			for (uint32_t row = 0; row < rows; row++) {
+				uint8_t* dst = texels + ((static_cast<size_t>(blockY) * 4 + row) * width + blockX * 4) * 4;
+				memcpy(dst, blockTexels + row * 4, columns * 4);
+			}
+		}
+	}
+}
+
+void TextureCodec::encode(VkFormat format, uint32_t width, uint32_t height, const uint8_t* texels, uint8_t* blocks) {
+	if (format == VK_FORMAT_R8G8B8A8_UNORM) {
+		memcpy(blocks, texels, static_cast<size_t>(width) * height * 4);
+		return;
+	}
+	if (!canEncode(format)) {
+		throw runtime_error(string("Failed to encode ") + getName(format) + ", there is no encoder for it!");
+	}
+
+	bool hasAlphaBlock = format == VK_FORMAT_BC3_UNORM_BLOCK;
+	uint32_t blockBytes = getBlockBytes(format);
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+
+	uint8_t blockTexels[16 * 4];
+
+	for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+		for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+			//Blocks hanging over the edge repeat the last row and column.
+			for (uint32_t row = 0; row < 4; row++) {
+				uint32_t y = min(blockY * 4 + row, height - 1);
+				for (uint32_t column = 0; column < 4; column++) {
+					uint32_t x = min(blockX * 4 + column, width - 1);
+					memcpy(blockTexels + (row * 4 + column) * 4, texels + (static_cast<size_t>(y) * width + x) * 4, 4);
+				}
+			}
+
+			uint8_t* block = blocks + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+			if (hasAlphaBlock) {
+				encodeAlphaBlock(blockTexels, block);
+				encodeColorBlock(blockTexels, block + 8);
+			}
+			else {
+				encodeColorBlock(blockTexels, block);
+			}
+		}
+	}
+}
+
+vector<uint8_t> TextureCodec::downsample(const uint8_t* texels, uint32_t width, uint32_t height) {
+	uint32_t nextWidth = max(1u, width / 2);
+	uint32_t nextHeight = max(1u, height / 2);
+
+	vector<uint8_t> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+	for (uint32_t y = 0; y < nextHeight; y++) {
+		uint32_t y0 = min(y * 2, height - 1);
+		uint32_t y1 = min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < nextWidth; x++) {
+			uint32_t x0 = min(x * 2, width - 1);
+			uint32_t x1 = min(x * 2 + 1, width - 1);
+			for (uint32_t c = 0; c < 4; c++) {
+				uint32_t sum = texels[(static_cast<size_t>(y0) * width + x0) * 4 + c] + texels[(static_cast<size_t>(y0) * width + x1) * 4 + c]
+					+ texels[(static_cast<size_t>(y1) * width + x0) * 4 + c] + texels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+				next[(static_cast<size_t>(y) * nextWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+
+	return next;
+}
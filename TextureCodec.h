@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texel formats textures are stored in, and conversions between them. RGBA8 counts as 1x1 blocks of 4 bytes,
+// the block compressed formats as 4x4 blocks. BC1 and BC3 can be encoded for cooking and decoded back to
+// RGBA8 for devices that can't sample them, decoding uses SSE2 where the compiler targets it.
+class TextureCodec {
+
+public:
+	// Every format a texture file may contain.
+	static const VkFormat FORMATS[];
+	static const uint32_t FORMAT_COUNT;
+
+	static bool isKnownFormat(VkFormat format);
+	static bool isCompressed(VkFormat format);
+	// e.g. "BC1", "RGBA8"
+	static const char* getName(VkFormat format);
+	// Inverse of getName, case sensitive. Throws on unknown names.
+	static VkFormat parseName(const std::string &name);
+
+	// Texels along each side of a block, and bytes per block.
+	static uint32_t getBlockExtent(VkFormat format);
+	static uint32_t getBlockBytes(VkFormat format);
+
+	// Bytes of a tightly packed level, partial blocks at the right and bottom edges count as whole ones.
+	static VkDeviceSize getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+	// Whether decode and encode support format.
+	static bool canDecode(VkFormat format);
+	static bool canEncode(VkFormat format);
+
+	// True when decode runs the SSE2 path.
+	static bool hasSimd();
+
+	// Decodes a level into width * height tightly packed RGBA8 texels. scalar forces the portable path,
+	// i.e. to compare it with the SIMD one.
+	static void decode(VkFormat format, uint32_t width, uint32_t height, const uint8_t* blocks, uint8_t* texels, bool scalar = false);
+
+	// Encodes width * height RGBA8 texels into a level of format. Endpoints come from each block's bounding
+	// box, which is fast and good enough for cooking, not for shipping art. BC1 drops the alpha channel.
+	static void encode(VkFormat format, uint32_t width, uint32_t height, const uint8_t* texels, uint8_t* blocks);
+
+	// Next smaller RGBA8 level, box filtered. Odd edges repeat their last texel.
+	static std::vector<uint8_t> downsample(const uint8_t* texels, uint32_t width, uint32_t height);
+};
@@ -0,0 +1,91 @@
+#include "TextureCooker.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+
+#include "TextureCodec.h"
+#include "TextureFile.h"
+
+using namespace std;
+
+void TextureCooker::cook(const string &ppmFileName, const string &ktx2FileName, VkFormat format) {
+	if (!TextureCodec::canEncode(format)) {
+		throw runtime_error(string("Failed to cook ") + ppmFileName + ", there is no encoder for " + TextureCodec::getName(format) + "!");
+	}
+
+	uint32_t width;
+	uint32_t height;
+	vector<vector<uint8_t>> texels(1);
+	TextureFile::readPPM(ppmFileName, width, height, texels[0]);
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	while (levelWidth > 1 || levelHeight > 1) {
+		texels.push_back(TextureCodec::downsample(texels.back().data(), levelWidth, levelHeight));
+		levelWidth = max(1u, levelWidth / 2);
+		levelHeight = max(1u, levelHeight / 2);
+	}
+
+	VkDeviceSize uncompressedBytes = 0;
+	VkDeviceSize cookedBytes = 0;
+	vector<vector<uint8_t>> levels(texels.size());
+	for (uint32_t i = 0; i < texels.size(); i++) {
+		levelWidth = max(1u, width >> i);
+		levelHeight = max(1u, height >> i);
+		levels[i].resize(static_cast<size_t>(TextureCodec::getLevelSize(format, levelWidth, levelHeight)));
+		TextureCodec::encode(format, levelWidth, levelHeight, texels[i].data(), levels[i].data());
+
+		uncompressedBytes += texels[i].size();
+		cookedBytes += levels[i].size();
+	}
+
+	TextureFile::write(ktx2FileName, format, width, height, levels);
+
+	cout << "Cooked " << ppmFileName << " into " << ktx2FileName << ": " << width << "x" << height << " " << TextureCodec::getName(format)
+		<< ", " << levels.size() << " levels, " << cookedBytes / 1024.0 << " KB instead of " << uncompressedBytes / 1024.0 << " KB as RGBA8" << endl;
+}
+
+void TextureCooker::benchmark(const string &ktx2FileName, uint32_t iterations) {
+	TextureFile file;
+	file.open(ktx2FileName);
+	VkFormat format = file.getFormat();
+	if (!TextureCodec::canDecode(format)) {
+		throw runtime_error(ktx2FileName + " has no CPU decoder!");
+	}
+
+	iterations = max(iterations, 1u);
+
+	vector<vector<uint8_t>> texels(file.getLevelCount());
+	size_t totalBytes = 0;
+	for (uint32_t i = 0; i < texels.size(); i++) {
+		texels[i].resize(static_cast<size_t>(max(1u, file.getWidth() >> i)) * max(1u, file.getHeight() >> i) * 4);
+		totalBytes += texels[i].size();
+	}
+
+	auto run = [&](bool scalar) {
+		double minMilliseconds = 0.0;
+		for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+			chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < texels.size(); i++) {
+				TextureCodec::decode(format, max(1u, file.getWidth() >> i), max(1u, file.getHeight() >> i), file.getLevelData(i), texels[i].data(), scalar);
+			}
+			double milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+			minMilliseconds = iteration == 0 ? milliseconds : min(minMilliseconds, milliseconds);
+		}
+		return totalBytes / (1024.0 * 1024.0) / (max(minMilliseconds, 1e-3) / 1000.0);
+	};
+
+	double scalarThroughput = run(true);
+	cout << "Transcode benchmark, " << TextureCodec::getName(format) << " to RGBA8, " << iterations << " iterations:" << endl;
+	cout << "\tscalar: " << scalarThroughput << " MB/s" << endl;
+	if (TextureCodec::hasSimd()) {
+		double simdThroughput = run(false);
+		cout << "\tSSE2: " << simdThroughput << " MB/s, " << simdThroughput / scalarThroughput << "x faster" << endl;
+	}
+	else {
+		cout << "\tSSE2: not available in this build" << endl;
+	}
+}
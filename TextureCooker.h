@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// Offline conversion of PPM images into compressed KTX2 textures, and a benchmark of the CPU transcode path.
+class TextureCooker {
+
+public:
+	// Builds the full mip chain of a PPM, encodes every level in format and writes them as a KTX2 file.
+	static void cook(const std::string &ppmFileName, const std::string &ktx2FileName, VkFormat format);
+
+	// Decodes every level of a KTX2 file iterations times with the scalar and the SIMD decoder and prints
+	// the throughput of both in MB of RGBA8 written per second.
+	static void benchmark(const std::string &ktx2FileName, uint32_t iterations);
+};
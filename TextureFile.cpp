@@ -0,0 +1,272 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "TextureCodec.h"
+
+using namespace std;
+
+static_assert(sizeof(TextureFile::Header) == 80, "TextureFile::Header is part of the file format");
+static_assert(sizeof(TextureFile::LevelIndex) == 24, "TextureFile::LevelIndex is part of the file format");
+
+const uint8_t TextureFile::IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+// Khronos data format descriptor values, see the Khronos Data Format Specification.
+static const uint32_t DF_MODEL_RGBSDA = 1;
+static const uint32_t DF_MODEL_BC1A = 128;
+static const uint32_t DF_MODEL_BC3 = 130;
+static const uint32_t DF_MODEL_BC7 = 134;
+static const uint32_t DF_MODEL_ASTC = 162;
+static const uint32_t DF_PRIMARIES_BT709 = 1;
+static const uint32_t DF_TRANSFER_LINEAR = 1;
+static const uint32_t DF_CHANNEL_ALPHA = 15;
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+// One sample of a basic descriptor block: bits [bitOffset, bitOffset + bitLength) hold channel.
+static void appendSample(vector<uint32_t> &words, uint32_t bitOffset, uint32_t bitLength, uint32_t channel, uint32_t upper) {
+	words.push_back(bitOffset | ((bitLength - 1) << 16) | (channel << 24));
+	words.push_back(0);
+	words.push_back(0);
+	words.push_back(upper);
+}
+
+// Total size followed by a single basic descriptor block.
+static vector<uint32_t> createDataFormatDescriptor(VkFormat format) {
+	uint32_t blockExtent = TextureCodec::getBlockExtent(format);
+	uint32_t blockBytes = TextureCodec::getBlockBytes(format);
+
+	vector<uint32_t> samples;
+	uint32_t model;
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		model = DF_MODEL_RGBSDA;
+		appendSample(samples, 0, 8, 0, 255);
+		appendSample(samples, 8, 8, 1, 255);
+		appendSample(samples, 16, 8, 2, 255);
+		appendSample(samples, 24, 8, DF_CHANNEL_ALPHA, 255);
+		break;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		model = DF_MODEL_BC1A;
+		//Channel 1 is color with punch through alpha.
+		appendSample(samples, 0, 64, 1, UINT32_MAX);
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		model = DF_MODEL_BC3;
+		appendSample(samples, 0, 64, DF_CHANNEL_ALPHA, UINT32_MAX);
+		appendSample(samples, 64, 64, 0, UINT32_MAX);
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		model = DF_MODEL_BC7;
+		appendSample(samples, 0, 128, 0, UINT32_MAX);
+		break;
+	case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		model = DF_MODEL_ASTC;
+		appendSample(samples, 0, 128, 0, UINT32_MAX);
+		break;
+	default:
+		throw runtime_error("Unknown texture format!");
+	}
+
+	uint32_t blockSize = 24 + static_cast<uint32_t>(samples.size()) * 4;
+	vector<uint32_t> words;
+	words.push_back(4 + blockSize);
+	//Khronos vendor, basic descriptor type
+	words.push_back(0);
+	words.push_back(2 | (blockSize << 16));
+	words.push_back(model | (DF_PRIMARIES_BT709 << 8) | (DF_TRANSFER_LINEAR << 16));
+	words.push_back((blockExtent - 1) | ((blockExtent - 1) << 8));
+	words.push_back(blockBytes);
+	words.push_back(0);
+	words.insert(words.end(), samples.begin(), samples.end());
+	return words;
+}
+
+void TextureFile::write(const string &fileName, VkFormat format, uint32_t width, uint32_t height, const vector<vector<uint8_t>> &levels) {
+	if (!TextureCodec::isKnownFormat(format) || levels.empty()) {
+		throw runtime_error("Failed to write " + fileName + ", nothing to write in a known format!");
+	}
+
+	vector<uint32_t> dfd = createDataFormatDescriptor(format);
+	uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+	Header fileHeader;
+	memset(&fileHeader, 0, sizeof(fileHeader));
+	memcpy(fileHeader.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+	fileHeader.vkFormat = format;
+	fileHeader.typeSize = 1;
+	fileHeader.pixelWidth = width;
+	fileHeader.pixelHeight = height;
+	fileHeader.faceCount = 1;
+	fileHeader.levelCount = levelCount;
+	fileHeader.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + sizeof(LevelIndex) * levelCount);
+	fileHeader.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	//Levels are stored coarsest first, each aligned to its block size.
+	vector<LevelIndex> levelIndex(levelCount);
+	uint64_t offset = fileHeader.dfdByteOffset + fileHeader.dfdByteLength;
+	for (uint32_t i = levelCount; i-- > 0;) {
+		uint32_t levelWidth = max(1u, width >> i);
+		uint32_t levelHeight = max(1u, height >> i);
+		if (levels[i].size() != TextureCodec::getLevelSize(format, levelWidth, levelHeight)) {
+			throw runtime_error("Failed to write " + fileName + ", level " + to_string(i) + " has the wrong size!");
+		}
+
+		offset = alignOffset(offset, TextureCodec::getBlockBytes(format));
+		levelIndex[i].byteOffset = offset;
+		levelIndex[i].byteLength = levels[i].size();
+		levelIndex[i].uncompressedByteLength = levels[i].size();
+		offset += levels[i].size();
+	}
+
+	ofstream out(fileName, ios::binary | ios::trunc);
+	if (!out.is_open()) {
+		throw runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	out.write(reinterpret_cast<const char*>(levelIndex.data()), sizeof(LevelIndex) * levelCount);
+	out.write(reinterpret_cast<const char*>(dfd.data()), fileHeader.dfdByteLength);
+
+	uint64_t written = fileHeader.dfdByteOffset + fileHeader.dfdByteLength;
+	const char padding[16] = {};
+	for (uint32_t i = levelCount; i-- > 0;) {
+		out.write(padding, levelIndex[i].byteOffset - written);
+		out.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+		written = levelIndex[i].byteOffset + levels[i].size();
+	}
+
+	if (!out) {
+		throw runtime_error("Failed to write " + fileName + "!");
+	}
+}
+
+void TextureFile::open(const string &fileName) {
+	close();
+	file.open(fileName);
+
+	header = static_cast<const Header*>(file.getData());
+	if (file.getSize() < sizeof(Header) || memcmp(header->identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+		close();
+		throw runtime_error(fileName + " is not a KTX2 file!");
+	}
+
+	if (!TextureCodec::isKnownFormat(static_cast<VkFormat>(header->vkFormat))) {
+		close();
+		throw runtime_error(fileName + " has an unsupported format!");
+	}
+
+	if (header->supercompressionScheme != 0 || header->pixelDepth > 1 || header->layerCount > 1 || header->faceCount != 1
+		|| header->pixelWidth == 0 || header->pixelHeight == 0) {
+		close();
+		throw runtime_error(fileName + " is not a single 2D image without supercompression!");
+	}
+
+	//0 levels asks the loader to generate them, the file still holds level 0.
+	uint32_t levelCount = getLevelCount();
+	if (sizeof(Header) + sizeof(LevelIndex) * levelCount > file.getSize()) {
+		close();
+		throw runtime_error(fileName + " is truncated or corrupt!");
+	}
+	levels = reinterpret_cast<const LevelIndex*>(getBytes() + sizeof(Header));
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+		VkDeviceSize expectedSize = TextureCodec::getLevelSize(getFormat(), max(1u, getWidth() >> i), max(1u, getHeight() >> i));
+		if (levels[i].byteLength != expectedSize || levels[i].byteOffset + levels[i].byteLength > file.getSize()) {
+			close();
+			throw runtime_error(fileName + " is truncated or corrupt!");
+		}
+	}
+}
+
+void TextureFile::close() {
+	file.close();
+	header = nullptr;
+	levels = nullptr;
+}
+
+VkFormat TextureFile::getFormat() const {
+	return static_cast<VkFormat>(header->vkFormat);
+}
+
+uint32_t TextureFile::getWidth() const {
+	return header->pixelWidth;
+}
+
+uint32_t TextureFile::getHeight() const {
+	return header->pixelHeight;
+}
+
+uint32_t TextureFile::getLevelCount() const {
+	return max(header->levelCount, 1u);
+}
+
+const uint8_t* TextureFile::getLevelData(uint32_t level) const {
+	return getBytes() + levels[level].byteOffset;
+}
+
+VkDeviceSize TextureFile::getLevelSize(uint32_t level) const {
+	return levels[level].byteLength;
+}
+
+// Next whitespace separated token of a PPM header, skipping # comments.
+static string readHeaderToken(istream &file) {
+	string token;
+	char c;
+	while (file.get(c)) {
+		if (c == '#') {
+			string comment;
+			getline(file, comment);
+		}
+		else if (isspace(static_cast<unsigned char>(c))) {
+			if (!token.empty()) {
+				break;
+			}
+		}
+		else {
+			token += c;
+		}
+	}
+	return token;
+}
+
+void TextureFile::readPPM(const string &fileName, uint32_t &width, uint32_t &height, vector<uint8_t> &texels) {
+	ifstream file(fileName, ios::binary);
+	if (!file.is_open()) {
+		throw runtime_error("Failed to open " + fileName + "!");
+	}
+
+	if (readHeaderToken(file) != "P6") {
+		throw runtime_error(fileName + " is not a binary PPM!");
+	}
+	//The single whitespace after maxval is consumed by readHeaderToken.
+	width = static_cast<uint32_t>(stoul(readHeaderToken(file)));
+	height = static_cast<uint32_t>(stoul(readHeaderToken(file)));
+	uint32_t maxValue = static_cast<uint32_t>(stoul(readHeaderToken(file)));
+	if (width == 0 || height == 0 || maxValue != 255) {
+		throw runtime_error(fileName + " is not an 8 bit PPM!");
+	}
+
+	vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+	if (!file.read(reinterpret_cast<char*>(rgb.data()), rgb.size())) {
+		throw runtime_error("Failed to read the texels of " + fileName + "!");
+	}
+
+	texels.resize(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+		texels[i * 4 + 0] = rgb[i * 3 + 0];
+		texels[i * 4 + 1] = rgb[i * 3 + 1];
+		texels[i * 4 + 2] = rgb[i * 3 + 2];
+		texels[i * 4 + 3] = 255;
+	}
+}
+
+const uint8_t* TextureFile::getBytes() const {
+	return static_cast<const uint8_t*>(file.getData());
+}
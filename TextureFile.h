@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// KTX2 texture container, limited to single 2D images of a TextureCodec format without supercompression.
+// Level data is read straight from the mapping, in the tightly packed block layout the GPU copies from.
+class TextureFile {
+
+public:
+	static const uint8_t IDENTIFIER[12];
+
+	// Start of every KTX2 file, followed by one LevelIndex per level.
+	struct Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// levels are finest first, each tightly packed in format's blocks. Writes a data format descriptor so
+	// other KTX2 tools can read the file too.
+	static void write(const std::string &fileName, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> &levels);
+
+	// Maps the file and validates the header and level index. Throws on files this class can't read.
+	void open(const std::string &fileName);
+	void close();
+
+	VkFormat getFormat() const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	uint32_t getLevelCount() const;
+
+	// Pointer into the mapping, valid until close.
+	const uint8_t* getLevelData(uint32_t level) const;
+	VkDeviceSize getLevelSize(uint32_t level) const;
+
+	// Binary PPM (P6) with 8 bit channels, expanded to opaque RGBA8.
+	static void readPPM(const std::string &fileName, uint32_t &width, uint32_t &height, std::vector<uint8_t> &texels);
+
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+	const LevelIndex* levels = nullptr;
+
+	const uint8_t* getBytes() const;
+};
@@ -0,0 +1,835 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "TextureCodec.h"
+#include "TextureFile.h"
+
+using namespace std;
+
+static uint32_t levelExtent(uint32_t extent, uint32_t level) {
+	return max(1u, extent >> level);
+}
+
+static uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+static bool endsWith(const string &text, const string &suffix) {
+	return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool TextureStreamer::isDeviceSupported(VkPhysicalDevice physicalDevice) {
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, UNCOMPRESSED_FORMAT, &formatProperties);
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	return (formatProperties.optimalTilingFeatures & required) == required;
+}
+
+vector<VkFormat> TextureStreamer::getSampleableFormats(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures &features) {
+	vector<VkFormat> formats;
+	for (uint32_t i = 0; i < TextureCodec::FORMAT_COUNT; i++) {
+		VkFormat format = TextureCodec::FORMATS[i];
+		if (!TextureCodec::isCompressed(format)) {
+			continue;
+		}
+
+		//Format properties may list compressed formats whose feature isn't enabled, sampling them is still invalid.
+		bool astc = format == VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+		if (!(astc ? features.textureCompressionASTC_LDR : features.textureCompressionBC)) {
+			continue;
+		}
+
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+		if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) {
+			formats.push_back(format);
+		}
+	}
+	return formats;
+}
+
+void TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize budget,
+	uint32_t frameCount, uint32_t loadThreads, const vector<VkFormat> &sampleableFormats) {
+	this->logicDevice = logicDevice;
+	this->memoryAllocator = &memoryAllocator;
+	this->budget = budget;
+	this->frameCount = frameCount;
+	this->sampleableFormats = sampleableFormats;
+
+	if (!isDeviceSupported(physicalDevice)) {
+		throw runtime_error("Failed to find a texture format supporting blits!");
+	}
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, UNCOMPRESSED_FORMAT, &formatProperties);
+	blitFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = blitFilter;
+	samplerInfo.minFilter = blitFilter;
+	samplerInfo.mipmapMode = blitFilter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.f;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.minLod = 0.f;
+	//Level 0 of an image is whatever level is resident, the sampler never needs to know.
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+	if (vkCreateSampler(logicDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw runtime_error("Failed to create texture sampler!");
+	}
+
+	staging.init(logicDevice, memoryAllocator, STAGING_SIZE, frameCount);
+	defaultImage = createImage(UNCOMPRESSED_FORMAT, 1, 1, 1);
+	defaultUploaded = false;
+
+	loaders.reset(new ThreadPool(loadThreads));
+}
+
+void TextureStreamer::cleanup() {
+	{
+		unique_lock<std::mutex> lock(loadMutex);
+		loadFinished.wait(lock, [this]() {
+			return pendingLoads == 0;
+		});
+	}
+	loaders.reset();
+
+	for (Texture &texture : textures) {
+		destroyImage(texture.image);
+	}
+	for (RetiredImage &retired : retiredImages) {
+		destroyImage(retired.image);
+	}
+	destroyImage(defaultImage);
+
+	textures.clear();
+	retiredImages.clear();
+	finishedLoads.clear();
+	residentBytes = 0;
+
+	vkDestroySampler(logicDevice, sampler, nullptr);
+	staging.cleanup(*memoryAllocator);
+}
+
+TextureStreamer::TextureId TextureStreamer::load(const string &fileName) {
+	if (endsWith(fileName, ".ktx2")) {
+		vector<VkFormat> formats = sampleableFormats;
+		return startLoad(fileName, [fileName, formats](LoadResult &result) {
+			decodeKtx2(fileName, formats, result);
+		});
+	}
+
+	return startLoad(fileName, [fileName](LoadResult &result) {
+		result.levels.resize(1);
+		TextureFile::readPPM(fileName, result.width, result.height, result.levels[0]);
+	});
+}
+
+TextureStreamer::TextureId TextureStreamer::generate(const string &name, uint32_t width, uint32_t height, TextureGenerator generator) {
+	return startLoad(name, [width, height, generator](LoadResult &result) {
+		if (width == 0 || height == 0) {
+			throw runtime_error("Texture has no texels!");
+		}
+		result.width = width;
+		result.height = height;
+		result.levels.resize(1);
+		result.levels[0].resize(static_cast<size_t>(width) * height * 4);
+		generator(width, height, result.levels[0].data());
+	});
+}
+
+void TextureStreamer::waitForLoads() {
+	unique_lock<std::mutex> lock(loadMutex);
+	loadFinished.wait(lock, [this]() {
+		return pendingLoads == 0;
+	});
+}
+
+void TextureStreamer::setUsage(TextureId id, uint32_t screenSize) {
+	Texture &texture = textures[id];
+	texture.screenSize = screenSize;
+	texture.lastUsedFrame = frameNumber;
+}
+
+void TextureStreamer::beginFrame(uint32_t frameIndex, uint32_t frameNumber) {
+	this->frameNumber = frameNumber;
+	staging.beginFrame(frameIndex);
+
+	//Frames up to frameNumber - frameCount have passed their fence wait.
+	while (!retiredImages.empty() && frameNumber >= retiredImages.front().retiredFrame + frameCount) {
+		destroyImage(retiredImages.front().image);
+		retiredImages.pop_front();
+	}
+
+	vector<LoadResult> results;
+	{
+		lock_guard<std::mutex> lock(loadMutex);
+		results.swap(finishedLoads);
+	}
+	for (LoadResult &result : results) {
+		finishLoad(result);
+	}
+}
+
+void TextureStreamer::recordUploads(VkCommandBuffer commandBuffer) {
+	if (!defaultUploaded) {
+		StagingRing::Region region;
+		if (staging.allocate(4, 16, region)) {
+			memset(region.data, 0xff, 4);
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = defaultImage.image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkBufferImageCopy copy = {};
+			copy.bufferOffset = region.offset;
+			copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			copy.imageExtent = { 1, 1, 1 };
+			vkCmdCopyBufferToImage(commandBuffer, region.buffer, defaultImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+			generateMips(commandBuffer, defaultImage.image, 1, 1, 1);
+			defaultUploaded = true;
+		}
+	}
+
+	struct Candidate {
+		TextureId id;
+		uint32_t level;
+		// First levels of a texture, they are tiny and make it sampleable at all.
+		bool tail;
+	};
+	vector<Candidate> candidates;
+
+	for (TextureId id = 0; id < textures.size(); id++) {
+		Texture &texture = textures[id];
+		if (!texture.loaded) {
+			continue;
+		}
+
+		//Finest level with at least screenSize texels along the largest side.
+		uint32_t maxExtent = max(texture.width, texture.height);
+		uint32_t wanted = texture.tailLevel;
+		if (texture.screenSize > 0) {
+			wanted = texture.finestLevel;
+			while (wanted < texture.tailLevel && levelExtent(maxExtent, wanted + 1) >= texture.screenSize) {
+				wanted++;
+			}
+		}
+		texture.wantedLevel = wanted;
+
+		if (texture.updatedFrame == frameNumber) {
+			continue;
+		}
+		if (texture.residentLevel == texture.levelCount) {
+			candidates.push_back({ id, texture.tailLevel, true });
+		}
+		else if (texture.residentLevel > texture.wantedLevel) {
+			//One level at a time, so every texture sharpens a bit before any gets everything.
+			candidates.push_back({ id, texture.residentLevel - 1, false });
+		}
+	}
+
+	sort(candidates.begin(), candidates.end(), [this](const Candidate &a, const Candidate &b) {
+		const Texture &textureA = textures[a.id];
+		const Texture &textureB = textures[b.id];
+		if (a.tail != b.tail) {
+			return a.tail;
+		}
+		if (textureA.lastUsedFrame != textureB.lastUsedFrame) {
+			return textureA.lastUsedFrame > textureB.lastUsedFrame;
+		}
+		if (textureA.screenSize != textureB.screenSize) {
+			return textureA.screenSize > textureB.screenSize;
+		}
+		return a.id < b.id;
+	});
+
+	VkDeviceSize maxUploadBytes = MAX_UPLOAD_BYTES_PER_FRAME;
+	VkDeviceSize uploadedBytes = 0;
+
+	for (const Candidate &candidate : candidates) {
+		Texture &texture = textures[candidate.id];
+		//Evicted from while making room for another texture.
+		if (texture.updatedFrame == frameNumber) {
+			continue;
+		}
+
+		VkDeviceSize levelBytes = texture.levels[candidate.level].size();
+		if (uploadedBytes > 0 && uploadedBytes + levelBytes > maxUploadBytes) {
+			break;
+		}
+
+		//Tails go in regardless of the budget, without them a texture can't be sampled.
+		VkDeviceSize growth = getImageBytes(texture, candidate.level) - getImageBytes(texture, texture.residentLevel);
+		if (!candidate.tail && !makeRoom(commandBuffer, candidate.id, growth)) {
+			continue;
+		}
+
+		if (!streamIn(commandBuffer, texture, candidate.level)) {
+			//The staging ring is full until older frames complete.
+			break;
+		}
+		uploadedBytes += levelBytes;
+	}
+}
+
+VkDescriptorImageInfo TextureStreamer::getDescriptor(TextureId id) const {
+	const Texture &texture = textures[id];
+	if (texture.image.view == VK_NULL_HANDLE) {
+		return getDefaultDescriptor();
+	}
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = texture.image.view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return imageInfo;
+}
+
+VkDescriptorImageInfo TextureStreamer::getDefaultDescriptor() const {
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = defaultImage.view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return imageInfo;
+}
+
+uint32_t TextureStreamer::getTextureCount() const {
+	return static_cast<uint32_t>(textures.size());
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const {
+	Stats current = stats;
+	current.textureCount = static_cast<uint32_t>(textures.size());
+	current.residentBytes = residentBytes;
+	current.budgetBytes = budget;
+
+	for (const Texture &texture : textures) {
+		if (texture.failed) {
+			current.failedCount++;
+		}
+		else if (!texture.loaded) {
+			current.loadingCount++;
+		}
+		else {
+			if (texture.residentLevel <= texture.wantedLevel) {
+				current.fullyResidentCount++;
+			}
+			if (TextureCodec::isCompressed(texture.format)) {
+				current.compressedCount++;
+			}
+			if (texture.transcoded) {
+				current.transcodedCount++;
+			}
+			current.uncompressedBytes += getImageBytes(texture, texture.residentLevel, UNCOMPRESSED_FORMAT);
+		}
+	}
+
+	return current;
+}
+
+TextureStreamer::TextureId TextureStreamer::startLoad(const string &name, function<void(LoadResult&)> decode) {
+	TextureId id = static_cast<TextureId>(textures.size());
+	Texture texture;
+	texture.name = name;
+	textures.push_back(texture);
+
+	{
+		lock_guard<std::mutex> lock(loadMutex);
+		pendingLoads++;
+	}
+
+	loaders->enqueue([this, id, decode]() {
+		chrono::high_resolution_clock::time_point loadStart = chrono::high_resolution_clock::now();
+
+		LoadResult result;
+		result.id = id;
+		try {
+			decode(result);
+			if (!result.complete) {
+				buildLevels(result);
+			}
+		}
+		catch (const exception &e) {
+			result.error = e.what();
+			result.levels.clear();
+		}
+		result.milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - loadStart).count();
+
+		lock_guard<std::mutex> lock(loadMutex);
+		finishedLoads.push_back(move(result));
+		pendingLoads--;
+		loadFinished.notify_all();
+	});
+
+	return id;
+}
+
+void TextureStreamer::finishLoad(LoadResult &result) {
+	Texture &texture = textures[result.id];
+	stats.loadMilliseconds += result.milliseconds;
+	stats.transcodedBytes += result.transcodedBytes;
+	stats.transcodeMilliseconds += result.transcodeMilliseconds;
+
+	if (!result.error.empty()) {
+		texture.failed = true;
+		cerr << "Failed to load texture " << texture.name << ": " << result.error << endl;
+		return;
+	}
+
+	texture.width = result.width;
+	texture.height = result.height;
+	texture.format = result.format;
+	texture.transcoded = result.transcoded;
+	texture.complete = result.complete;
+	texture.levels = move(result.levels);
+
+	uint32_t maxExtent = max(texture.width, texture.height);
+	if (texture.complete) {
+		texture.levelCount = static_cast<uint32_t>(texture.levels.size());
+		texture.tailLevel = 0;
+		while (texture.tailLevel + 1 < texture.levelCount && levelExtent(maxExtent, texture.tailLevel) > TAIL_SIZE) {
+			texture.tailLevel++;
+		}
+	}
+	else {
+		texture.levelCount = 1;
+		while (levelExtent(maxExtent, texture.levelCount - 1) > 1) {
+			texture.levelCount++;
+		}
+		texture.tailLevel = static_cast<uint32_t>(texture.levels.size()) - 1;
+	}
+
+	//Levels that don't fit half the staging ring never stream in, their CPU copies are dropped.
+	texture.finestLevel = 0;
+	while (texture.finestLevel < texture.tailLevel && texture.levels[texture.finestLevel].size() > STAGING_SIZE / 2) {
+		vector<uint8_t>().swap(texture.levels[texture.finestLevel]);
+		texture.finestLevel++;
+	}
+
+	texture.residentLevel = texture.levelCount;
+	texture.wantedLevel = texture.tailLevel;
+	texture.loaded = true;
+}
+
+VkDeviceSize TextureStreamer::getImageBytes(const Texture &texture, uint32_t firstLevel, VkFormat format) {
+	VkDeviceSize bytes = 0;
+	for (uint32_t level = firstLevel; level < texture.levelCount; level++) {
+		bytes += TextureCodec::getLevelSize(format, levelExtent(texture.width, level), levelExtent(texture.height, level));
+	}
+	return bytes;
+}
+
+VkDeviceSize TextureStreamer::getImageBytes(const Texture &texture, uint32_t firstLevel) const {
+	return getImageBytes(texture, firstLevel, texture.format);
+}
+
+bool TextureStreamer::makeRoom(VkCommandBuffer commandBuffer, TextureId requester, VkDeviceSize bytes) {
+	if (residentBytes + bytes <= budget) {
+		return true;
+	}
+
+	const Texture &wanting = textures[requester];
+
+	//Least recently used first, then the smallest on screen.
+	vector<TextureId> victims;
+	for (TextureId id = 0; id < textures.size(); id++) {
+		const Texture &texture = textures[id];
+		if (id != requester && texture.loaded && texture.residentLevel < texture.tailLevel && texture.updatedFrame != frameNumber) {
+			victims.push_back(id);
+		}
+	}
+	sort(victims.begin(), victims.end(), [this](TextureId a, TextureId b) {
+		const Texture &textureA = textures[a];
+		const Texture &textureB = textures[b];
+		if (textureA.lastUsedFrame != textureB.lastUsedFrame) {
+			return textureA.lastUsedFrame < textureB.lastUsedFrame;
+		}
+		if (textureA.screenSize != textureB.screenSize) {
+			return textureA.screenSize < textureB.screenSize;
+		}
+		return a > b;
+	});
+
+	//Planned before anything is recorded, so a request that can't be satisfied evicts nothing.
+	vector<pair<TextureId, uint32_t>> evictions;
+	VkDeviceSize freed = 0;
+	for (TextureId id : victims) {
+		const Texture &texture = textures[id];
+
+		//Levels finer than a texture needs can always go. The rest only goes to textures that are more important,
+		//so two textures never keep evicting each other.
+		bool lessImportant = texture.lastUsedFrame < wanting.lastUsedFrame
+			|| (texture.lastUsedFrame == wanting.lastUsedFrame && texture.screenSize < wanting.screenSize);
+		uint32_t limit = lessImportant ? texture.tailLevel : max(texture.residentLevel, texture.wantedLevel);
+
+		uint32_t level = texture.residentLevel;
+		while (level < limit && residentBytes + bytes - freed > budget) {
+			level++;
+			freed = freed + getImageBytes(texture, level - 1) - getImageBytes(texture, level);
+		}
+		if (level != texture.residentLevel) {
+			evictions.push_back(make_pair(id, level));
+		}
+		if (residentBytes + bytes - freed <= budget) {
+			break;
+		}
+	}
+
+	if (residentBytes + bytes - freed > budget) {
+		return false;
+	}
+
+	for (const pair<TextureId, uint32_t> &eviction : evictions) {
+		evictLevels(commandBuffer, textures[eviction.first], eviction.second);
+	}
+	return true;
+}
+
+bool TextureStreamer::streamIn(VkCommandBuffer commandBuffer, Texture &texture, uint32_t level) {
+	//Complete textures upload the levels below too, unless the current image already holds them.
+	bool copyResident = texture.complete && texture.residentLevel < texture.levelCount;
+	uint32_t uploadEnd = !texture.complete ? level + 1 : (copyResident ? texture.residentLevel : texture.levelCount);
+
+	//Buffer offsets of copies must be multiples of the block size, 16 bytes covers every format.
+	VkDeviceSize uploadSize = 0;
+	for (uint32_t i = level; i < uploadEnd; i++) {
+		uploadSize = alignOffset(uploadSize, 16) + texture.levels[i].size();
+	}
+
+	StagingRing::Region region;
+	if (!staging.allocate(uploadSize, 16, region)) {
+		return false;
+	}
+
+	uint32_t width = levelExtent(texture.width, level);
+	uint32_t height = levelExtent(texture.height, level);
+	uint32_t mipLevels = texture.levelCount - level;
+	Image image = createImage(texture.format, width, height, mipLevels);
+
+	VkImageMemoryBarrier barriers[2] = {};
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = image.image;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	//Frames in flight may still sample the current image, the copy out of it waits for their fragment shaders.
+	if (copyResident) {
+		barriers[1] = barriers[0];
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[1].image = texture.image.image;
+		barriers[1].subresourceRange.levelCount = texture.levelCount - texture.residentLevel;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, copyResident ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, copyResident ? 2 : 1, barriers);
+
+	vector<VkBufferImageCopy> copies;
+	VkDeviceSize offset = 0;
+	for (uint32_t i = level; i < uploadEnd; i++) {
+		const vector<uint8_t> &texels = texture.levels[i];
+		offset = alignOffset(offset, 16);
+		memcpy(static_cast<uint8_t*>(region.data) + offset, texels.data(), texels.size());
+
+		VkBufferImageCopy copy = {};
+		copy.bufferOffset = region.offset + offset;
+		//0 means tightly packed rows
+		copy.bufferRowLength = 0;
+		copy.bufferImageHeight = 0;
+		copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - level, 0, 1 };
+		copy.imageOffset = { 0, 0, 0 };
+		copy.imageExtent = { levelExtent(texture.width, i), levelExtent(texture.height, i), 1 };
+		copies.push_back(copy);
+
+		offset += texels.size();
+	}
+	vkCmdCopyBufferToImage(commandBuffer, region.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(copies.size()), copies.data());
+
+	if (copyResident) {
+		vector<VkImageCopy> imageCopies;
+		for (uint32_t i = texture.residentLevel; i < texture.levelCount; i++) {
+			VkImageCopy copy = {};
+			copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - texture.residentLevel, 0, 1 };
+			copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - level, 0, 1 };
+			copy.extent = { levelExtent(texture.width, i), levelExtent(texture.height, i), 1 };
+			imageCopies.push_back(copy);
+		}
+		vkCmdCopyImage(commandBuffer, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
+	}
+
+	if (texture.complete) {
+		VkImageMemoryBarrier readBarrier = barriers[0];
+		readBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		readBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		readBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &readBarrier);
+	}
+	else {
+		generateMips(commandBuffer, image.image, width, height, mipLevels);
+	}
+
+	residentBytes = residentBytes + getImageBytes(texture, level) - getImageBytes(texture, texture.residentLevel);
+	retire(texture.image);
+	texture.image = image;
+	texture.residentLevel = level;
+	texture.updatedFrame = frameNumber;
+
+	stats.uploadCount++;
+	stats.uploadBytes += offset;
+	return true;
+}
+
+void TextureStreamer::evictLevels(VkCommandBuffer commandBuffer, Texture &texture, uint32_t level) {
+	uint32_t width = levelExtent(texture.width, level);
+	uint32_t height = levelExtent(texture.height, level);
+	uint32_t mipLevels = texture.levelCount - level;
+	uint32_t droppedLevels = level - texture.residentLevel;
+	Image image = createImage(texture.format, width, height, mipLevels);
+
+	//Frames in flight may still sample the old image, the copy waits for their fragment shaders.
+	VkImageMemoryBarrier barriers[2] = {};
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = texture.image.image;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels + droppedLevels, 0, 1 };
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	barriers[1] = barriers[0];
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].image = image.image;
+	barriers[1].subresourceRange.levelCount = mipLevels;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+	vector<VkImageCopy> copies(mipLevels);
+	for (uint32_t i = 0; i < mipLevels; i++) {
+		VkImageCopy &copy = copies[i];
+		copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, droppedLevels + i, 0, 1 };
+		copy.srcOffset = { 0, 0, 0 };
+		copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+		copy.dstOffset = { 0, 0, 0 };
+		copy.extent = { levelExtent(width, i), levelExtent(height, i), 1 };
+	}
+	vkCmdCopyImage(commandBuffer, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels, copies.data());
+
+	VkImageMemoryBarrier readBarrier = barriers[1];
+	readBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	readBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	readBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	readBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &readBarrier);
+
+	residentBytes = residentBytes + getImageBytes(texture, level) - getImageBytes(texture, texture.residentLevel);
+	retire(texture.image);
+	texture.image = image;
+	texture.residentLevel = level;
+	texture.updatedFrame = frameNumber;
+
+	stats.evictionCount += droppedLevels;
+}
+
+TextureStreamer::Image TextureStreamer::createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels) {
+	Image image;
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	//Transfer source for the blits and for copies into a smaller image on eviction.
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(logicDevice, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+		throw runtime_error("Failed to create texture image!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(logicDevice, image.image, &memReqs);
+	image.allocation = memoryAllocator->allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+	if (vkBindImageMemory(logicDevice, image.image, image.allocation.memory, image.allocation.offset) != VK_SUCCESS) {
+		throw runtime_error("Failed to bind texture image memory!");
+	}
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+	if (vkCreateImageView(logicDevice, &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+		throw runtime_error("Failed to create texture image view!");
+	}
+
+	return image;
+}
+
+void TextureStreamer::destroyImage(Image &image) {
+	if (image.image == VK_NULL_HANDLE) {
+		return;
+	}
+	vkDestroyImageView(logicDevice, image.view, nullptr);
+	vkDestroyImage(logicDevice, image.image, nullptr);
+	memoryAllocator->free(image.allocation);
+	image = Image();
+}
+
+void TextureStreamer::retire(Image &image) {
+	if (image.image != VK_NULL_HANDLE) {
+		retiredImages.push_back({ image, frameNumber });
+	}
+	image = Image();
+}
+
+void TextureStreamer::generateMips(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	int32_t mipWidth = static_cast<int32_t>(width);
+	int32_t mipHeight = static_cast<int32_t>(height);
+
+	for (uint32_t level = 1; level < mipLevels; level++) {
+		//The previous level is done being written, blit from it.
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		int32_t nextWidth = max(1, mipWidth / 2);
+		int32_t nextHeight = max(1, mipHeight / 2);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, blitFilter);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	//The coarsest level was only written.
+	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void TextureStreamer::decodeKtx2(const string &fileName, const vector<VkFormat> &sampleableFormats, LoadResult &result) {
+	TextureFile file;
+	file.open(fileName);
+
+	result.width = file.getWidth();
+	result.height = file.getHeight();
+	result.format = file.getFormat();
+	uint32_t levelCount = file.getLevelCount();
+
+	bool sampleable = !TextureCodec::isCompressed(result.format)
+		|| find(sampleableFormats.begin(), sampleableFormats.end(), result.format) != sampleableFormats.end();
+	if (!sampleable && !TextureCodec::canDecode(result.format)) {
+		throw runtime_error(string("The device can't sample ") + TextureCodec::getName(result.format) + " and there is no CPU decoder for it!");
+	}
+
+	//RGBA8 levels short of a full chain are regenerated by blits from level 0 like any other image. Compressed
+	//formats can't be blit destinations, their images simply end at the coarsest level the file holds.
+	uint32_t fullLevelCount = 1;
+	while (levelExtent(max(result.width, result.height), fullLevelCount - 1) > 1) {
+		fullLevelCount++;
+	}
+	result.complete = levelCount == fullLevelCount || (sampleable && TextureCodec::isCompressed(result.format));
+	if (!result.complete) {
+		levelCount = 1;
+	}
+
+	chrono::high_resolution_clock::time_point transcodeStart = chrono::high_resolution_clock::now();
+	result.levels.resize(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++) {
+		const uint8_t* data = file.getLevelData(i);
+		if (sampleable) {
+			result.levels[i].assign(data, data + file.getLevelSize(i));
+		}
+		else {
+			uint32_t width = levelExtent(result.width, i);
+			uint32_t height = levelExtent(result.height, i);
+			result.levels[i].resize(static_cast<size_t>(width) * height * 4);
+			TextureCodec::decode(result.format, width, height, data, result.levels[i].data());
+			result.transcodedBytes += result.levels[i].size();
+		}
+	}
+
+	if (!sampleable) {
+		result.format = UNCOMPRESSED_FORMAT;
+		result.transcoded = true;
+		result.transcodeMilliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - transcodeStart).count();
+	}
+}
+
+void TextureStreamer::buildLevels(LoadResult &result) {
+	uint32_t width = result.width;
+	uint32_t height = result.height;
+
+	//Each level is filtered from the previous one.
+	while (max(width, height) > TAIL_SIZE) {
+		result.levels.push_back(TextureCodec::downsample(result.levels.back().data(), width, height));
+		width = max(1u, width / 2);
+		height = max(1u, height / 2);
+	}
+}
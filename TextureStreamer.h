@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "StagingRing.h"
+#include "ThreadPool.h"
+
+// Textures streamed into device memory by mip level. Images are decoded on worker threads and kept on the
+// CPU as the levels that can become the finest resident one. KTX2 files bring every level along, in their
+// block compressed format when the device samples it and decoded to RGBA8 otherwise. For other images
+// the CPU only keeps the levels down to the tail, the coarser ones are generated on the GPU with blits.
+// Every frame, levels stream in by priority as long as the resident levels fit the budget, and the least
+// recently used textures drop their finest level to make room.
+// Sampling always works: a texture reads as opaque white until its first levels are resident.
+class TextureStreamer {
+
+public:
+	typedef uint32_t TextureId;
+
+	// Fills width * height tightly packed RGBA8 texels.
+	typedef std::function<void(uint32_t width, uint32_t height, uint8_t* pixels)> TextureGenerator;
+
+	struct Stats {
+		uint32_t textureCount = 0;
+		uint32_t loadingCount = 0;
+		uint32_t failedCount = 0;
+		// Textures whose resident levels are as fine as their usage asks for
+		uint32_t fullyResidentCount = 0;
+		// Sampled in a block compressed format, and block compressed files decoded to RGBA8 on the CPU because
+		// the device can't sample their format
+		uint32_t compressedCount = 0;
+		uint32_t transcodedCount = 0;
+		// Texel bytes of the images currently sampled, replaced images waiting for their frames are not included
+		VkDeviceSize residentBytes = 0;
+		// residentBytes if every resident level were RGBA8, the difference is what compression saves
+		VkDeviceSize uncompressedBytes = 0;
+		VkDeviceSize budgetBytes = 0;
+		// Since init
+		uint64_t uploadCount = 0;
+		uint64_t uploadBytes = 0;
+		uint64_t evictionCount = 0;
+		// Decode and CPU level time summed over the workers
+		double loadMilliseconds = 0.0;
+		// RGBA8 bytes written by the CPU decoder and the time it took, part of loadMilliseconds
+		uint64_t transcodedBytes = 0;
+		double transcodeMilliseconds = 0.0;
+	};
+
+	// The RGBA8 format must be sampleable, blittable and filterable.
+	static bool isDeviceSupported(VkPhysicalDevice physicalDevice);
+
+	// Block compressed TextureCodec formats the device samples with features enabled.
+	static std::vector<VkFormat> getSampleableFormats(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures &features);
+
+	// budget is in bytes of resident texels, loadThreads 0 picks one per hardware thread. Files in a block compressed
+	// format missing from sampleableFormats are decoded on the CPU.
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize budget,
+		uint32_t frameCount, uint32_t loadThreads, const std::vector<VkFormat> &sampleableFormats);
+
+	// The device must be idle.
+	void cleanup();
+
+	// KTX2 (.ktx2) or binary PPM (P6), decoded on a worker.
+	TextureId load(const std::string &fileName);
+
+	// Runs generator on a worker, i.e. for procedural textures.
+	TextureId generate(const std::string &name, uint32_t width, uint32_t height, TextureGenerator generator);
+
+	// Blocks until every load has finished. Headless runs use it so what streams in when doesn't depend on decode times.
+	void waitForLoads();
+
+	// Texels wanted along the largest side, usually the texture's size on screen in pixels. Marks the texture as
+	// used by the current frame, larger sizes stream in first.
+	void setUsage(TextureId id, uint32_t screenSize);
+
+	// Call once the fence of frameIndex has signalled. Recycles staging memory, destroys replaced images no
+	// frame in flight uses anymore and picks up finished loads.
+	void beginFrame(uint32_t frameIndex, uint32_t frameNumber);
+
+	// Streams levels in and evicts levels to stay within the budget, at most MAX_UPLOAD_BYTES_PER_FRAME per frame.
+	// Records the copies, blits and layout transitions outside a render pass, before the draws sampling the textures.
+	void recordUploads(VkCommandBuffer commandBuffer);
+
+	// For the draws recorded after recordUploads of the same frame.
+	VkDescriptorImageInfo getDescriptor(TextureId id) const;
+	VkDescriptorImageInfo getDefaultDescriptor() const;
+
+	uint32_t getTextureCount() const;
+	Stats getStats() const;
+
+private:
+	// Of PPM and generated textures, the default texture and decoded compressed ones.
+	static const VkFormat UNCOMPRESSED_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	// Levels up to this size are the tail, uploaded as soon as a texture has loaded and never evicted.
+	static const uint32_t TAIL_SIZE = 64;
+	// Caps the staging copies recorded per frame, so streaming never adds a spike to a single frame.
+	// A single level larger than that still streams in, on a frame of its own.
+	static const VkDeviceSize MAX_UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+	static const VkDeviceSize STAGING_SIZE = 64 * 1024 * 1024;
+
+	struct LoadResult {
+		TextureId id;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		VkFormat format = UNCOMPRESSED_FORMAT;
+		// Finest first, down to the tail level, or every level of the image when complete
+		std::vector<std::vector<uint8_t>> levels;
+		bool complete = false;
+		bool transcoded = false;
+		std::string error;
+		double milliseconds = 0.0;
+		uint64_t transcodedBytes = 0;
+		double transcodeMilliseconds = 0.0;
+	};
+
+	struct Image {
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		Allocation allocation;
+	};
+
+	struct RetiredImage {
+		Image image;
+		// frameNumber when it was replaced
+		uint32_t retiredFrame;
+	};
+
+	struct Texture {
+		std::string name;
+		bool loaded = false;
+		bool failed = false;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		VkFormat format = UNCOMPRESSED_FORMAT;
+		bool transcoded = false;
+		// Of the image's whole chain, down to 1x1 unless a file stops earlier
+		uint32_t levelCount = 0;
+		// Every level has a CPU copy, so nothing is blitted
+		bool complete = false;
+		// Levels up to here are uploaded together and never evicted
+		uint32_t tailLevel = 0;
+		// Finest level small enough to stage, finer levels have no CPU copy and never stream in.
+		uint32_t finestLevel = 0;
+		std::vector<std::vector<uint8_t>> levels;
+
+		Image image;
+		// Finest level in the image, levelCount while nothing is resident
+		uint32_t residentLevel = 0;
+		uint32_t wantedLevel = 0;
+		uint32_t screenSize = 0;
+		uint32_t lastUsedFrame = 0;
+		// Frame whose commands last replaced the image, it is not touched again within the same frame.
+		uint32_t updatedFrame = UINT32_MAX;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	MemoryAllocator* memoryAllocator = nullptr;
+	VkDeviceSize budget = 0;
+	uint32_t frameCount = 0;
+	uint32_t frameNumber = 0;
+	// Linear filtering when blitting is supported, nearest otherwise.
+	VkFilter blitFilter = VK_FILTER_LINEAR;
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	Image defaultImage;
+	bool defaultUploaded = false;
+
+	std::vector<VkFormat> sampleableFormats;
+	StagingRing staging;
+	std::unique_ptr<ThreadPool> loaders;
+
+	std::vector<Texture> textures;
+	std::deque<RetiredImage> retiredImages;
+	VkDeviceSize residentBytes = 0;
+	Stats stats;
+
+	// Filled by the workers
+	std::mutex loadMutex;
+	std::condition_variable loadFinished;
+	std::vector<LoadResult> finishedLoads;
+	uint32_t pendingLoads = 0;
+
+	TextureId startLoad(const std::string &name, std::function<void(LoadResult&)> decode);
+	void finishLoad(LoadResult &result);
+
+	// Texel bytes of an image of format holding levels [firstLevel, levelCount).
+	static VkDeviceSize getImageBytes(const Texture &texture, uint32_t firstLevel, VkFormat format);
+	VkDeviceSize getImageBytes(const Texture &texture, uint32_t firstLevel) const;
+
+	// Evicts levels of textures less important than requester until bytes more fit the budget. Returns false
+	// and evicts nothing when that isn't possible.
+	bool makeRoom(VkCommandBuffer commandBuffer, TextureId requester, VkDeviceSize bytes);
+
+	// Replaces the image with one whose finest level is level, uploaded from the CPU copy. The levels below
+	// are blitted from it, or for complete textures uploaded too when nothing is resident and copied from the
+	// current image otherwise.
+	bool streamIn(VkCommandBuffer commandBuffer, Texture &texture, uint32_t level);
+
+	// Replaces the image with one whose finest level is the coarser level, copied from the current image on the GPU.
+	void evictLevels(VkCommandBuffer commandBuffer, Texture &texture, uint32_t level);
+
+	Image createImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+	void destroyImage(Image &image);
+	void retire(Image &image);
+
+	// Blits levels [1, mipLevels) from level 0, which must be in TRANSFER_DST_OPTIMAL like the rest. Leaves every
+	// level in SHADER_READ_ONLY_OPTIMAL.
+	void generateMips(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+	// Keeps the levels in the file's format when it is in sampleableFormats, decodes them to RGBA8 otherwise.
+	static void decodeKtx2(const std::string &fileName, const std::vector<VkFormat> &sampleableFormats, LoadResult &result);
+
+	// Box filters levels down to the tail from levels[0].
+	static void buildLevels(LoadResult &result);
+};
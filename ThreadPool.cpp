@@ -0,0 +1,108 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		uint32_t hardwareThreads = thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (thread &worker : workers) {
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::getWorkerCount() const {
+	return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+	{
+		lock_guard<std::mutex> lock(queueMutex);
+		tasks.push_back(move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t chunkCount, const function<void(uint32_t, uint32_t, uint32_t)> &job) {
+	if (count == 0 || chunkCount == 0) {
+		return;
+	}
+	chunkCount = min(chunkCount, count);
+
+	std::mutex doneMutex;
+	condition_variable doneCondition;
+	uint32_t remaining = chunkCount;
+	exception_ptr firstError;
+
+	uint32_t chunkSize = count / chunkCount;
+	uint32_t remainder = count % chunkCount;
+	uint32_t begin = 0;
+
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		//The first chunks take one extra element each when count doesn't divide evenly.
+		uint32_t end = begin + chunkSize + (chunk < remainder ? 1 : 0);
+
+		enqueue([&, chunk, begin, end]() {
+			exception_ptr error;
+			try {
+				job(chunk, begin, end);
+			}
+			catch (...) {
+				error = current_exception();
+			}
+
+			lock_guard<std::mutex> lock(doneMutex);
+			if (error && !firstError) {
+				firstError = error;
+			}
+			if (--remaining == 0) {
+				doneCondition.notify_one();
+			}
+		});
+
+		begin = end;
+	}
+
+	unique_lock<std::mutex> lock(doneMutex);
+	doneCondition.wait(lock, [&]() { return remaining == 0; });
+
+	if (firstError) {
+		rethrow_exception(firstError);
+	}
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock<std::mutex> lock(queueMutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (stopping && tasks.empty()) {
+				return;
+			}
+
+			task = move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one shared queue.
+class ThreadPool {
+
+public:
+	// 0 picks one worker per hardware thread, minus the calling thread.
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t getWorkerCount() const;
+
+	void enqueue(std::function<void()> task);
+
+	// Splits [0, count) into chunkCount contiguous ranges and runs job(chunk, begin, end) for each
+	// on the workers. Every chunk runs on exactly one thread, so per chunk resources need no locking.
+	// Blocks until all chunks are done and rethrows the first exception a chunk threw.
+	void parallelFor(uint32_t count, uint32_t chunkCount, const std::function<void(uint32_t, uint32_t, uint32_t)> &job);
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable taskAvailable;
+	bool stopping = false;
+
+	void workerLoop();
+};
@@ -0,0 +1,71 @@
+#include "UniformRing.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+void UniformRing::init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize frameCapacity, uint32_t frameCount) {
+	this->logicDevice = logicDevice;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+	//Frame regions start aligned too, so every offset handed out is.
+	this->frameCapacity = (frameCapacity + alignment - 1) / alignment * alignment;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = this->frameCapacity * frameCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(logicDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to create uniform ring buffer!");
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(logicDevice, buffer, &memReqs);
+
+	allocation = memoryAllocator.allocate(memReqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkBindBufferMemory(logicDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		throw runtime_error("Failed to bind uniform ring memory!");
+	}
+}
+
+void UniformRing::cleanup(MemoryAllocator &memoryAllocator) {
+	vkDestroyBuffer(logicDevice, buffer, nullptr);
+	memoryAllocator.free(allocation);
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) {
+	currentFrame = frameIndex;
+	head = 0;
+}
+
+uint32_t UniformRing::push(const void* data, VkDeviceSize size) {
+	if (head + size > frameCapacity) {
+		throw runtime_error("Uniform ring frame region is full!");
+	}
+
+	VkDeviceSize offset = currentFrame * frameCapacity + head;
+	memcpy(static_cast<char*>(allocation.mappedData) + offset, data, static_cast<size_t>(size));
+
+	head = (head + size + alignment - 1) / alignment * alignment;
+
+	return static_cast<uint32_t>(offset);
+}
+
+VkDescriptorBufferInfo UniformRing::getDescriptorInfo(VkDeviceSize range) const {
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = range;
+	return bufferInfo;
+}
+
+VkDeviceSize UniformRing::getFrameUsed() const {
+	return head;
+}
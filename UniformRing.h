@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+#include "MemoryAllocator.h"
+
+// One persistently mapped uniform buffer split into a region per frame in flight. Per frame data
+// is written with push(), which returns a dynamic offset into the buffer. A single descriptor set
+// of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC covers every block, so writing new data costs
+// a memcpy and never a descriptor update.
+class UniformRing {
+
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice logicDevice, MemoryAllocator &memoryAllocator, VkDeviceSize frameCapacity, uint32_t frameCount);
+	void cleanup(MemoryAllocator &memoryAllocator);
+
+	// Call once the fence of frameIndex has signalled, rewinds that frame's region.
+	void beginFrame(uint32_t frameIndex);
+
+	// Copies size bytes into the current frame's region and returns their dynamic offset.
+	uint32_t push(const void* data, VkDeviceSize size);
+
+	template<typename T>
+	uint32_t push(const T &data) {
+		return push(&data, sizeof(T));
+	}
+
+	// range is the size of the largest block read through the descriptor.
+	VkDescriptorBufferInfo getDescriptorInfo(VkDeviceSize range) const;
+
+	VkDeviceSize getFrameUsed() const;
+
+private:
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation allocation;
+
+	// minUniformBufferOffsetAlignment, every block starts on it.
+	VkDeviceSize alignment = 1;
+	VkDeviceSize frameCapacity = 0;
+
+	uint32_t currentFrame = 0;
+	// Offset into the current frame's region.
+	VkDeviceSize head = 0;
+};
@@ -0,0 +1,293 @@
+#include "UploadQueue.h"
+
+#include <stdexcept>
+#include <limits>
+
+using namespace std;
+
+void UploadQueue::init(VkDevice logicDevice, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily) {
+	this->logicDevice = logicDevice;
+	this->transferQueue = transferQueue;
+	this->transferFamily = transferFamily;
+	this->graphicsQueue = graphicsQueue;
+	this->graphicsFamily = graphicsFamily;
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.queueFamilyIndex = transferFamily;
+	//Short lived command buffers that are re-recorded for every batch.
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(logicDevice, &commandPoolCreateInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+		throw runtime_error("Failed to create transfer command pool!");
+	}
+
+	if (separateFamilies()) {
+		commandPoolCreateInfo.queueFamilyIndex = graphicsFamily;
+
+		if (vkCreateCommandPool(logicDevice, &commandPoolCreateInfo, nullptr, &acquireCommandPool) != VK_SUCCESS) {
+			throw runtime_error("Failed to create ownership acquire command pool!");
+		}
+	}
+
+	recording = createBatch();
+}
+
+void UploadQueue::cleanup() {
+	waitIdle();
+
+	//Never submitted, so nothing is using the resources anymore.
+	for (function<void()> &callback : recording.callbacks) {
+		callback();
+	}
+	recording.callbacks.clear();
+	destroyBatch(recording);
+
+	for (Batch &batch : freeBatches) {
+		destroyBatch(batch);
+	}
+	freeBatches.clear();
+
+	vkDestroyCommandPool(logicDevice, transferCommandPool, nullptr);
+	if (acquireCommandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(logicDevice, acquireCommandPool, nullptr);
+	}
+}
+
+bool UploadQueue::separateFamilies() const {
+	return transferFamily != graphicsFamily;
+}
+
+UploadQueue::Stats UploadQueue::getStats() const {
+	return stats;
+}
+
+UploadQueue::Batch UploadQueue::createBatch() {
+	if (!freeBatches.empty()) {
+		Batch batch = move(freeBatches.back());
+		freeBatches.pop_back();
+		return batch;
+	}
+
+	Batch batch;
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = transferCommandPool;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(logicDevice, &allocInfo, &batch.transferCommandBuffer) != VK_SUCCESS) {
+		throw runtime_error("Failed to allocate transfer command buffer!");
+	}
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(logicDevice, &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+		throw runtime_error("Failed to create transfer fence!");
+	}
+
+	if (separateFamilies()) {
+		allocInfo.commandPool = acquireCommandPool;
+
+		if (vkAllocateCommandBuffers(logicDevice, &allocInfo, &batch.acquireCommandBuffer) != VK_SUCCESS) {
+			throw runtime_error("Failed to allocate ownership acquire command buffer!");
+		}
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (vkCreateSemaphore(logicDevice, &semaphoreCreateInfo, nullptr, &batch.releasedSemaphore) != VK_SUCCESS) {
+			throw runtime_error("Failed to create transfer semaphore!");
+		}
+	}
+
+	return batch;
+}
+
+void UploadQueue::destroyBatch(Batch &batch) {
+	vkDestroyFence(logicDevice, batch.fence, nullptr);
+	if (batch.releasedSemaphore != VK_NULL_HANDLE) {
+		vkDestroySemaphore(logicDevice, batch.releasedSemaphore, nullptr);
+	}
+	//Command buffers are freed with their pools.
+}
+
+void UploadQueue::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	if (!recordingStarted) {
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(recording.transferCommandBuffer, &beginInfo);
+		recordingStarted = true;
+	}
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(recording.transferCommandBuffer, src, dst, 1, &copyRegion);
+
+	recording.copies.push_back({ dst, dstOffset, size, dstStage, dstAccess });
+
+	stats.copyCount++;
+	stats.byteCount += size;
+}
+
+void UploadQueue::onComplete(function<void()> callback) {
+	recording.callbacks.push_back(move(callback));
+}
+
+uint64_t UploadQueue::flush() {
+	if (!recordingStarted) {
+		if (recording.callbacks.empty()) {
+			return lastSubmittedTicket;
+		}
+
+		//Callbacks without copies still have to wait for everything submitted before them.
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(recording.transferCommandBuffer, &beginInfo);
+	}
+
+	VkPipelineStageFlags dstStages = 0;
+	VkAccessFlags dstAccess = 0;
+	for (const Copy &copy : recording.copies) {
+		dstStages |= copy.dstStage;
+		dstAccess |= copy.dstAccess;
+	}
+	if (dstStages == 0) {
+		dstStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+
+	if (separateFamilies()) {
+		//Release on the transfer queue, has to be matched by an identical acquire on the graphics queue.
+		vector<VkBufferMemoryBarrier> barriers(recording.copies.size());
+		for (size_t i = 0; i < recording.copies.size(); i++) {
+			barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers[i].dstAccessMask = 0;
+			barriers[i].srcQueueFamilyIndex = transferFamily;
+			barriers[i].dstQueueFamilyIndex = graphicsFamily;
+			barriers[i].buffer = recording.copies[i].dst;
+			barriers[i].offset = recording.copies[i].offset;
+			barriers[i].size = recording.copies[i].size;
+		}
+
+		if (!barriers.empty()) {
+			vkCmdPipelineBarrier(recording.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+		vkEndCommandBuffer(recording.transferCommandBuffer);
+
+		VkSubmitInfo transferSubmitInfo = {};
+		transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		transferSubmitInfo.commandBufferCount = 1;
+		transferSubmitInfo.pCommandBuffers = &recording.transferCommandBuffer;
+		transferSubmitInfo.signalSemaphoreCount = 1;
+		transferSubmitInfo.pSignalSemaphores = &recording.releasedSemaphore;
+
+		if (vkQueueSubmit(transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw runtime_error("Failed to submit transfer batch!");
+		}
+
+		for (size_t i = 0; i < recording.copies.size(); i++) {
+			barriers[i].srcAccessMask = 0;
+			barriers[i].dstAccessMask = recording.copies[i].dstAccess;
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(recording.acquireCommandBuffer, &beginInfo);
+		if (!barriers.empty()) {
+			vkCmdPipelineBarrier(recording.acquireCommandBuffer, dstStages, dstStages, 0,
+				0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+		vkEndCommandBuffer(recording.acquireCommandBuffer);
+
+		//Later graphics submissions are ordered after the acquire, so drawing never waits on the CPU.
+		VkSubmitInfo acquireSubmitInfo = {};
+		acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmitInfo.waitSemaphoreCount = 1;
+		acquireSubmitInfo.pWaitSemaphores = &recording.releasedSemaphore;
+		acquireSubmitInfo.pWaitDstStageMask = &dstStages;
+		acquireSubmitInfo.commandBufferCount = 1;
+		acquireSubmitInfo.pCommandBuffers = &recording.acquireCommandBuffer;
+
+		if (vkQueueSubmit(graphicsQueue, 1, &acquireSubmitInfo, recording.fence) != VK_SUCCESS) {
+			throw runtime_error("Failed to submit ownership acquire!");
+		}
+	}
+	else {
+		if (!recording.copies.empty()) {
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccess;
+
+			vkCmdPipelineBarrier(recording.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+		vkEndCommandBuffer(recording.transferCommandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recording.transferCommandBuffer;
+
+		if (vkQueueSubmit(transferQueue, 1, &submitInfo, recording.fence) != VK_SUCCESS) {
+			throw runtime_error("Failed to submit transfer batch!");
+		}
+	}
+
+	recording.ticket = ++lastSubmittedTicket;
+	stats.batchCount++;
+	inFlight.push_back(move(recording));
+	recording = createBatch();
+	recordingStarted = false;
+
+	return lastSubmittedTicket;
+}
+
+void UploadQueue::retire(Batch &batch) {
+	vkResetFences(logicDevice, 1, &batch.fence);
+	completedTicket = batch.ticket;
+
+	for (function<void()> &callback : batch.callbacks) {
+		callback();
+	}
+	batch.callbacks.clear();
+	batch.copies.clear();
+
+	freeBatches.push_back(move(batch));
+}
+
+void UploadQueue::collect() {
+	//Batches are submitted in order on the same queue, so they also complete in order.
+	while (!inFlight.empty() && vkGetFenceStatus(logicDevice, inFlight.front().fence) == VK_SUCCESS) {
+		retire(inFlight.front());
+		inFlight.pop_front();
+	}
+}
+
+bool UploadQueue::isComplete(uint64_t ticket) {
+	collect();
+	return completedTicket >= ticket;
+}
+
+void UploadQueue::wait(uint64_t ticket) {
+	while (completedTicket < ticket && !inFlight.empty()) {
+		vkWaitForFences(logicDevice, 1, &inFlight.front().fence, VK_TRUE, numeric_limits<uint64_t>::max());
+		retire(inFlight.front());
+		inFlight.pop_front();
+	}
+}
+
+void UploadQueue::waitIdle() {
+	wait(lastSubmittedTicket);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Batches buffer copies into one submission on the transfer queue and tracks completion with
+// fences, so uploads never stall the render loop with vkQueueWaitIdle. When the transfer queue
+// is a separate family, ownership of the destination buffers is released on the transfer queue
+// and acquired on the graphics queue.
+class UploadQueue {
+
+public:
+	// Totals since init.
+	struct Stats {
+		uint64_t copyCount = 0;
+		uint64_t byteCount = 0;
+		uint64_t batchCount = 0;
+	};
+
+	void init(VkDevice logicDevice, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily);
+	void cleanup();
+
+	// dstStage and dstAccess describe the first use of dst on the graphics queue.
+	void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0,
+		VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+	// Called from collect() once the batch currently being recorded has completed, i.e. to free staging memory.
+	void onComplete(std::function<void()> callback);
+
+	// Submits everything recorded since the last flush. Returns the batch ticket, or the last ticket if nothing was recorded.
+	uint64_t flush();
+
+	// Retires completed batches and runs their callbacks. Never blocks.
+	void collect();
+
+	bool isComplete(uint64_t ticket);
+	void wait(uint64_t ticket);
+	void waitIdle();
+
+	bool separateFamilies() const;
+
+	Stats getStats() const;
+
+private:
+	struct Copy {
+		VkBuffer dst;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		VkPipelineStageFlags dstStage;
+		VkAccessFlags dstAccess;
+	};
+
+	struct Batch {
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		//Only used with separate families, acquires ownership on the graphics queue.
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore releasedSemaphore = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		uint64_t ticket = 0;
+		std::vector<Copy> copies;
+		std::vector<std::function<void()>> callbacks;
+	};
+
+	VkDevice logicDevice = VK_NULL_HANDLE;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+
+	VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+	VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+
+	Batch recording;
+	bool recordingStarted = false;
+	std::deque<Batch> inFlight;
+	std::vector<Batch> freeBatches;
+
+	uint64_t lastSubmittedTicket = 0;
+	uint64_t completedTicket = 0;
+
+	Stats stats;
+
+	Batch createBatch();
+	void destroyBatch(Batch &batch);
+	void retire(Batch &batch);
+};
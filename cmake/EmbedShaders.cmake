@@ -0,0 +1,35 @@
+# Writes the SPIR-V files in INPUTS, separated by commas, to OUTPUT as uint32_t arrays, see ShaderLibrary::EmbeddedShader.
+# Run with cmake -DINPUTS=a.spv,b.spv -DOUTPUT=EmbeddedShaders.cpp -P EmbedShaders.cmake
+
+string(REPLACE "," ";" INPUTS "${INPUTS}")
+
+set(CONTENT "// Generated by cmake/EmbedShaders.cmake from the compiled shaders, do not edit.\n\n#include \"ShaderLibrary.h\"\n\n")
+set(ENTRIES "")
+set(INDEX 0)
+
+foreach(INPUT ${INPUTS})
+	get_filename_component(NAME ${INPUT} NAME)
+	file(READ ${INPUT} HEX HEX)
+
+	string(LENGTH "${HEX}" HEX_LENGTH)
+	math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+	if(HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+		message(FATAL_ERROR "${INPUT} is not SPIR-V")
+	endif()
+
+	# SPIR-V is little endian, eight words per line.
+	string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+	set(WORD "0x[0-9a-f]+, ")
+	string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n\t" WORDS "${WORDS}")
+	string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+	string(STRIP "${WORDS}" WORDS)
+
+	string(APPEND CONTENT "alignas(16) static const uint32_t shader${INDEX}[] = {\n\t${WORDS}\n};\n\n")
+	string(APPEND ENTRIES "\t{ \"${NAME}\", shader${INDEX}, sizeof(shader${INDEX}) },\n")
+	math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+string(APPEND CONTENT "const ShaderLibrary::EmbeddedShader ShaderLibrary::EMBEDDED_SHADERS[] = {\n${ENTRIES}};\n\n")
+string(APPEND CONTENT "const size_t ShaderLibrary::EMBEDDED_SHADER_COUNT = ${INDEX};\n")
+
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -1,3 +1,5 @@
-C:\VulkanSDK\1.1.73.0\Bin32\glslangValidator.exe -V shader.vert
-C:\VulkanSDK\1.1.73.0\Bin32\glslangValidator.exe -V shader.frag
-pause
\ No newline at end of file
+cd /d "%~dp0"
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V shader.vert -o vert.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V shader.frag -o frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V cull.comp -o cull.spv
+pause
@@ -1,10 +1,18 @@
-#version 450
-#extension GL_ARB_separate_shader_objects : enable
-
-layout(location = 0) in vec3 fragColor;
-
-layout(location = 0) out vec4 outColor;
-
-void main() {
-	outColor = vec4(fragColor, 1.0);
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Must match MAX_TEXTURES in Application.h
+#define MAX_TEXTURES 16
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+// Slots without a texture, and textures still loading, sample opaque white.
+layout(set = 1, binding = 0) uniform sampler2D textures[MAX_TEXTURES];
+
+void main() {
+	outColor = vec4(fragColor * texture(textures[fragTextureIndex], fragTexCoord).rgb, 1.0);
 }
\ No newline at end of file
@@ -1,13 +1,35 @@
-#version 450
-#extension GL_ARB_separate_shader_objects : enable
-
-layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec3 inColor;
-
-layout(location = 0) out vec3 fragColor;
-
-
-void main() {
-	gl_Position = vec4(inPosition, 0.0, 1.0);
-	fragColor = inColor;
-}
\ No newline at end of file
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Per instance, must match InstanceData in Application.h
+layout(location = 2) in vec4 instanceOffsetScale;
+layout(location = 3) in vec4 instanceColor;
+layout(location = 4) in uint instanceTextureIndex;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
+
+// Must match FrameUniforms in Application.h, bound with a dynamic offset.
+layout(set = 0, binding = 0) uniform FrameUniforms {
+	mat4 viewProjection;
+} frame;
+
+// Must match DrawConstants in Application.h
+layout(push_constant) uniform DrawConstants {
+	vec4 meshTransform;
+} draw;
+
+void main() {
+	vec3 meshPosition = (inPosition - draw.meshTransform.xyz) * draw.meshTransform.w;
+	vec3 worldPosition = meshPosition * instanceOffsetScale.z + vec3(instanceOffsetScale.xy, instanceOffsetScale.w);
+
+	gl_Position = frame.viewProjection * vec4(worldPosition, 1.0);
+	fragColor = inColor * instanceColor.rgb;
+	// Planar mapping, the texture repeats once per mesh unit and is centered on the mesh.
+	fragTexCoord = inPosition.xy - draw.meshTransform.xy + 0.5;
+	fragTextureIndex = instanceTextureIndex;
+}
@@ -0,0 +1,137 @@
+#include "BlockAllocator.h"
+#include "Check.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+static void testAlignment() {
+	BlockAllocator allocator(1024);
+	CHECK(allocator.allocate(10, 1) == 0);
+	CHECK(allocator.allocate(16, 256) == 256);
+
+	//The padding in front of the aligned allocation stays free and is the best fit for a small allocation.
+	BlockAllocator::Stats stats = allocator.getStats();
+	CHECK(stats.freeRangeCount == 2);
+	CHECK(stats.used == 26);
+	CHECK(allocator.allocate(100, 1) == 10);
+	CHECK(allocator.allocate(4, 64) == 128);
+}
+
+static void testBestFit() {
+	BlockAllocator allocator(1000);
+	uint64_t a = allocator.allocate(100, 1);
+	allocator.allocate(50, 1);
+	allocator.allocate(100, 1);
+	uint64_t d = allocator.allocate(30, 1);
+	allocator.allocate(100, 1);
+	allocator.free(a);
+	allocator.free(d);
+
+	//Free ranges of 100 at 0, 30 at 250 and 620 at 380, each allocation goes to the smallest one it fits in.
+	CHECK(allocator.allocate(25, 1) == 250);
+	CHECK(allocator.allocate(90, 1) == 0);
+	CHECK(allocator.allocate(200, 1) == 380);
+	CHECK(allocator.allocate(10, 1) == 90);
+}
+
+static void testCoalescing() {
+	{
+		//With the left neighbour
+		BlockAllocator allocator(300);
+		uint64_t a = allocator.allocate(100, 1);
+		uint64_t b = allocator.allocate(100, 1);
+		allocator.allocate(100, 1);
+		allocator.free(a);
+		allocator.free(b);
+		BlockAllocator::Stats stats = allocator.getStats();
+		CHECK(stats.freeRangeCount == 1);
+		CHECK(stats.largestFreeRange == 200);
+		CHECK(allocator.allocate(200, 1) == 0);
+	}
+	{
+		//With the right neighbour
+		BlockAllocator allocator(300);
+		allocator.allocate(100, 1);
+		uint64_t b = allocator.allocate(100, 1);
+		uint64_t c = allocator.allocate(100, 1);
+		allocator.free(c);
+		allocator.free(b);
+		BlockAllocator::Stats stats = allocator.getStats();
+		CHECK(stats.freeRangeCount == 1);
+		CHECK(stats.largestFreeRange == 200);
+		CHECK(allocator.allocate(200, 1) == 100);
+	}
+	{
+		//With both
+		BlockAllocator allocator(300);
+		uint64_t a = allocator.allocate(100, 1);
+		uint64_t b = allocator.allocate(100, 1);
+		uint64_t c = allocator.allocate(100, 1);
+		allocator.free(a);
+		allocator.free(c);
+		CHECK(allocator.getStats().freeRangeCount == 2);
+		allocator.free(b);
+		BlockAllocator::Stats stats = allocator.getStats();
+		CHECK(stats.freeRangeCount == 1);
+		CHECK(stats.largestFreeRange == 300);
+		CHECK(allocator.isEmpty());
+		CHECK(allocator.allocate(300, 1) == 0);
+	}
+}
+
+static void testExhaustion() {
+	BlockAllocator full(256);
+	CHECK(full.allocate(256, 1) == 0);
+	CHECK(full.allocate(1, 1) == BlockAllocator::INVALID_OFFSET);
+	CHECK(full.allocate(0, 1) == BlockAllocator::INVALID_OFFSET);
+
+	//200 bytes are free, but in two ranges of 100.
+	BlockAllocator fragmented(400);
+	uint64_t a = fragmented.allocate(100, 1);
+	fragmented.allocate(100, 1);
+	uint64_t c = fragmented.allocate(100, 1);
+	fragmented.allocate(100, 1);
+	fragmented.free(a);
+	fragmented.free(c);
+	CHECK(fragmented.allocate(150, 1) == BlockAllocator::INVALID_OFFSET);
+
+	//Padding can make a range that is big enough too small.
+	BlockAllocator padded(300);
+	padded.allocate(1, 1);
+	CHECK(padded.allocate(200, 256) == BlockAllocator::INVALID_OFFSET);
+
+	CHECK_THROWS(fragmented.free(50), runtime_error);
+}
+
+static void testFragmentation() {
+	BlockAllocator allocator(400);
+	CHECK(allocator.getStats().fragmentation == 0.f);
+
+	uint64_t a = allocator.allocate(100, 1);
+	allocator.allocate(100, 1);
+	uint64_t c = allocator.allocate(100, 1);
+	allocator.allocate(100, 1);
+	BlockAllocator::Stats stats = allocator.getStats();
+	CHECK(stats.used == 400);
+	CHECK(stats.allocationCount == 4);
+	CHECK(stats.fragmentation == 0.f);
+
+	allocator.free(a);
+	allocator.free(c);
+	stats = allocator.getStats();
+	CHECK(stats.used == 200);
+	CHECK(stats.allocationCount == 2);
+	CHECK(stats.largestFreeRange == 100);
+	CHECK(fabs(stats.fragmentation - 0.5f) < 1e-6f);
+}
+
+int main() {
+	testAlignment();
+	testBestFit();
+	testCoalescing();
+	testExhaustion();
+	testFragmentation();
+	return finishChecks("BlockAllocator");
+}
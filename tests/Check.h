@@ -0,0 +1,43 @@
+#pragma once
+
+#include <iostream>
+
+// Assertions for the test executables. A failed CHECK prints the expression and carries on, so one run reports
+// every failure, and finishChecks turns the count into the exit code CTest looks at.
+inline int &getCheckFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+			getCheckFailures()++; \
+		} \
+	} while (0)
+
+// Fails unless the statement throws the given exception type.
+#define CHECK_THROWS(statement, exceptionType) \
+	do { \
+		bool thrown = false; \
+		try { \
+			statement; \
+		} \
+		catch (const exceptionType &) { \
+			thrown = true; \
+		} \
+		if (!thrown) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": " #statement " did not throw " #exceptionType << std::endl; \
+			getCheckFailures()++; \
+		} \
+	} while (0)
+
+inline int finishChecks(const char* suite) {
+	if (getCheckFailures() > 0) {
+		std::cerr << suite << ": " << getCheckFailures() << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << suite << ": all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "DeviceSelector.h"
+#include "Check.h"
+#include "FakeVulkan.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+static const VkDeviceSize GIGABYTE = 1024ull * 1024 * 1024;
+
+static DeviceSelector::Candidate makeCandidate(const string &name, VkPhysicalDeviceType type, VkDeviceSize deviceLocalBytes) {
+	DeviceSelector::Candidate candidate;
+	candidate.name = name;
+	candidate.type = type;
+	candidate.deviceLocalBytes = deviceLocalBytes;
+	return candidate;
+}
+
+// Every optional point a device can score.
+static DeviceSelector::Candidate makeBestOfType(VkPhysicalDeviceType type) {
+	DeviceSelector::Candidate candidate = makeCandidate("best", type, 64 * GIGABYTE);
+	candidate.transferQueue = true;
+	candidate.computeQueue = true;
+	candidate.multiDrawIndirect = true;
+	candidate.drawIndirectCount = true;
+	candidate.textureCompressionBC = true;
+	candidate.textureCompressionASTC = true;
+	return candidate;
+}
+
+static void testTypeOrder() {
+	//The best device of a type still ranks below the worst one of the next better type.
+	const VkPhysicalDeviceType typeOrder[] = {
+		VK_PHYSICAL_DEVICE_TYPE_CPU,
+		VK_PHYSICAL_DEVICE_TYPE_OTHER,
+		VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU,
+		VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
+		VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
+	};
+	for (size_t i = 0; i + 1 < sizeof(typeOrder) / sizeof(typeOrder[0]); i++) {
+		uint32_t best = DeviceSelector::score(makeBestOfType(typeOrder[i]));
+		uint32_t worst = DeviceSelector::score(makeCandidate("worst", typeOrder[i + 1], 0));
+		CHECK(best < worst);
+	}
+
+	vector<DeviceSelector::Candidate> candidates;
+	candidates.push_back(makeBestOfType(VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU));
+	candidates.push_back(makeCandidate("discrete", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 0));
+	candidates.push_back(makeBestOfType(VK_PHYSICAL_DEVICE_TYPE_CPU));
+	CHECK(DeviceSelector::select(candidates, "") == 1);
+}
+
+static void testTiesWithinType() {
+	//More device local memory wins, up to the cap.
+	uint32_t small = DeviceSelector::score(makeCandidate("small", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4 * GIGABYTE));
+	uint32_t large = DeviceSelector::score(makeCandidate("large", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * GIGABYTE));
+	uint32_t capped = DeviceSelector::score(makeCandidate("capped", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 16 * GIGABYTE));
+	uint32_t huge = DeviceSelector::score(makeCandidate("huge", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 64 * GIGABYTE));
+	CHECK(small < large);
+	CHECK(large < capped);
+	CHECK(capped == huge);
+
+	DeviceSelector::Candidate withQueue = makeCandidate("queue", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4 * GIGABYTE);
+	withQueue.transferQueue = true;
+	CHECK(DeviceSelector::score(withQueue) > small);
+
+	//Equal scores keep the loader's order.
+	vector<DeviceSelector::Candidate> candidates;
+	candidates.push_back(makeCandidate("first", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4 * GIGABYTE));
+	candidates.push_back(makeCandidate("second", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 4 * GIGABYTE));
+	CHECK(DeviceSelector::select(candidates, "") == 0);
+}
+
+static void testPreference() {
+	vector<DeviceSelector::Candidate> candidates;
+	candidates.push_back(makeCandidate("AMD Radeon", VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, GIGABYTE));
+	candidates.push_back(makeCandidate("NVIDIA GeForce", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * GIGABYTE));
+	candidates.push_back(makeCandidate("llvmpipe (LLVM 15)", VK_PHYSICAL_DEVICE_TYPE_CPU, 0));
+	candidates.push_back(makeCandidate("Mock device", VK_PHYSICAL_DEVICE_TYPE_OTHER, 0));
+	candidates[3].unsuitableReason = "no graphics queue";
+
+	CHECK(DeviceSelector::select(candidates, "") == 1);
+	CHECK(DeviceSelector::select(candidates, "0") == 0);
+	CHECK(DeviceSelector::select(candidates, "LLVMPIPE") == 2);
+	CHECK(DeviceSelector::select(candidates, "radeon") == 0);
+	CHECK_THROWS(DeviceSelector::select(candidates, "9"), runtime_error);
+	CHECK_THROWS(DeviceSelector::select(candidates, "intel"), runtime_error);
+	CHECK_THROWS(DeviceSelector::select(candidates, "mock"), runtime_error);
+	CHECK_THROWS(DeviceSelector::select(candidates, "3"), runtime_error);
+
+	//Unsuitable devices never win, and with none suitable selection fails.
+	vector<DeviceSelector::Candidate> unsuitable;
+	unsuitable.push_back(makeBestOfType(VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU));
+	unsuitable[0].unsuitableReason = "no swapchain support";
+	unsuitable.push_back(makeCandidate("cpu", VK_PHYSICAL_DEVICE_TYPE_CPU, 0));
+	CHECK(DeviceSelector::select(unsuitable, "") == 1);
+	unsuitable.pop_back();
+	CHECK_THROWS(DeviceSelector::select(unsuitable, ""), runtime_error);
+}
+
+static void testDescribe() {
+	FakeVulkan::reset();
+	strcpy(FakeVulkan::deviceProperties.deviceName, "Fake GPU");
+	FakeVulkan::deviceProperties.deviceType = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+
+	DeviceSelector::Candidate candidate = DeviceSelector::describe(VK_NULL_HANDLE);
+	CHECK(candidate.name == "Fake GPU");
+	CHECK(candidate.type == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
+	CHECK(candidate.deviceLocalBytes == 8 * GIGABYTE);
+	CHECK(!candidate.transferQueue);
+	CHECK(!candidate.multiDrawIndirect);
+	CHECK(!candidate.drawIndirectCount);
+}
+
+static void testPrint() {
+	vector<DeviceSelector::Candidate> candidates;
+	candidates.push_back(makeCandidate("discrete", VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 8 * GIGABYTE + GIGABYTE / 2));
+	candidates.push_back(makeCandidate("mock", VK_PHYSICAL_DEVICE_TYPE_OTHER, 0));
+	candidates[1].unsuitableReason = "no graphics queue";
+	uint32_t selected = DeviceSelector::select(candidates, "");
+
+	ostringstream out;
+	out.precision(6);
+	DeviceSelector::print(out, candidates, selected, "by score");
+	CHECK(out.str().find("  * 0 discrete (discrete, 8.5 GB device local): score ") != string::npos);
+	CHECK(out.str().find("    1 mock (other, 0.0 GB device local): unsuitable, no graphics queue") != string::npos);
+
+	//The caller's formatting survives, later doubles print as before.
+	CHECK(out.precision() == 6);
+	CHECK((out.flags() & ios_base::floatfield) == 0);
+	out.str("");
+	out << 123.456;
+	CHECK(out.str() == "123.456");
+}
+
+int main() {
+	testTypeOrder();
+	testTiesWithinType();
+	testPreference();
+	testDescribe();
+	testPrint();
+	return finishChecks("DeviceSelector");
+}
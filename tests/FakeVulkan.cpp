@@ -0,0 +1,156 @@
+#include "FakeVulkan.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+using namespace std;
+
+VkPhysicalDeviceMemoryProperties FakeVulkan::memoryProperties;
+VkPhysicalDeviceProperties FakeVulkan::deviceProperties;
+VkResult FakeVulkan::mapMemoryResult = VK_SUCCESS;
+VkResult FakeVulkan::bindImageMemoryResult = VK_SUCCESS;
+uint32_t FakeVulkan::liveMemoryCount = 0;
+uint32_t FakeVulkan::mappedMemoryCount = 0;
+uint32_t FakeVulkan::liveImageCount = 0;
+uint32_t FakeVulkan::liveImageViewCount = 0;
+uint32_t FakeVulkan::pipelineBarrierCount = 0;
+uint32_t FakeVulkan::imageBarrierCount = 0;
+uint32_t FakeVulkan::bufferBarrierCount = 0;
+
+//Handles of the objects that have no backing, and the sizes of the live images.
+static uint64_t nextHandle = 1;
+static map<VkImage, VkDeviceSize> imageSizes;
+
+template<typename Handle>
+static Handle makeHandle() {
+	return (Handle)(uintptr_t)nextHandle++;
+}
+
+void FakeVulkan::reset() {
+	memset(&memoryProperties, 0, sizeof(memoryProperties));
+	memoryProperties.memoryHeapCount = 2;
+	memoryProperties.memoryHeaps[0].size = 8ull * 1024 * 1024 * 1024;
+	memoryProperties.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+	memoryProperties.memoryHeaps[1].size = 256ull * 1024 * 1024;
+	memoryProperties.memoryTypeCount = 2;
+	memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	memoryProperties.memoryTypes[0].heapIndex = 0;
+	memoryProperties.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	memoryProperties.memoryTypes[1].heapIndex = 1;
+
+	memset(&deviceProperties, 0, sizeof(deviceProperties));
+	deviceProperties.limits.bufferImageGranularity = 1024;
+	deviceProperties.limits.maxMemoryAllocationCount = 4096;
+
+	mapMemoryResult = VK_SUCCESS;
+	bindImageMemoryResult = VK_SUCCESS;
+	liveMemoryCount = 0;
+	mappedMemoryCount = 0;
+	liveImageCount = 0;
+	liveImageViewCount = 0;
+	pipelineBarrierCount = 0;
+	imageBarrierCount = 0;
+	bufferBarrierCount = 0;
+	imageSizes.clear();
+}
+
+//Memory is backed by the heap, so mapped pointers are real. malloc does not touch the pages of large blocks.
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory) {
+	void* data = malloc(static_cast<size_t>(pAllocateInfo->allocationSize));
+	if (data == nullptr) {
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+	*pMemory = (VkDeviceMemory)data;
+	FakeVulkan::liveMemoryCount++;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator) {
+	if (memory != VK_NULL_HANDLE) {
+		free((void*)memory);
+		FakeVulkan::liveMemoryCount--;
+	}
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void** ppData) {
+	if (FakeVulkan::mapMemoryResult != VK_SUCCESS) {
+		return FakeVulkan::mapMemoryResult;
+	}
+	*ppData = static_cast<char*>((void*)memory) + offset;
+	FakeVulkan::mappedMemoryCount++;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice device, VkDeviceMemory memory) {
+	FakeVulkan::mappedMemoryCount--;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties) {
+	*pMemoryProperties = FakeVulkan::memoryProperties;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties* pProperties) {
+	*pProperties = FakeVulkan::deviceProperties;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice device, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImage* pImage) {
+	*pImage = makeHandle<VkImage>();
+	imageSizes[*pImage] = static_cast<VkDeviceSize>(pCreateInfo->extent.width) * pCreateInfo->extent.height * pCreateInfo->extent.depth * 4;
+	FakeVulkan::liveImageCount++;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks* pAllocator) {
+	if (image != VK_NULL_HANDLE) {
+		imageSizes.erase(image);
+		FakeVulkan::liveImageCount--;
+	}
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice device, VkImage image, VkMemoryRequirements* pMemoryRequirements) {
+	VkDeviceSize alignment = FakeVulkan::IMAGE_ALIGNMENT;
+	pMemoryRequirements->size = (imageSizes[image] + alignment - 1) / alignment * alignment;
+	pMemoryRequirements->alignment = alignment;
+	pMemoryRequirements->memoryTypeBits = 0x1;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize memoryOffset) {
+	return FakeVulkan::bindImageMemoryResult;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(VkDevice device, const VkImageViewCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImageView* pView) {
+	*pView = makeHandle<VkImageView>();
+	FakeVulkan::liveImageViewCount++;
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice device, VkImageView imageView, const VkAllocationCallbacks* pAllocator) {
+	if (imageView != VK_NULL_HANDLE) {
+		FakeVulkan::liveImageViewCount--;
+	}
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+	VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers, uint32_t bufferMemoryBarrierCount,
+	const VkBufferMemoryBarrier* pBufferMemoryBarriers, uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers) {
+	FakeVulkan::pipelineBarrierCount++;
+	FakeVulkan::bufferBarrierCount += bufferMemoryBarrierCount;
+	FakeVulkan::imageBarrierCount += imageMemoryBarrierCount;
+}
+
+//The device has no queue families, optional features or extensions.
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice, uint32_t* pQueueFamilyPropertyCount,
+	VkQueueFamilyProperties* pQueueFamilyProperties) {
+	*pQueueFamilyPropertyCount = 0;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures* pFeatures) {
+	memset(pFeatures, 0, sizeof(*pFeatures));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice, const char* pLayerName, uint32_t* pPropertyCount,
+	VkExtensionProperties* pProperties) {
+	*pPropertyCount = 0;
+	return VK_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Stands in for the Vulkan loader in the unit tests. Implements the entry points the tested classes call against
+// a made up device whose properties and failures the tests set, and counts the objects still alive.
+struct FakeVulkan {
+	// Returned by vkGetPhysicalDeviceMemoryProperties and vkGetPhysicalDeviceProperties.
+	static VkPhysicalDeviceMemoryProperties memoryProperties;
+	static VkPhysicalDeviceProperties deviceProperties;
+
+	// Returned by the next vkMapMemory and vkBindImageMemory calls.
+	static VkResult mapMemoryResult;
+	static VkResult bindImageMemoryResult;
+
+	static uint32_t liveMemoryCount;
+	static uint32_t mappedMemoryCount;
+	static uint32_t liveImageCount;
+	static uint32_t liveImageViewCount;
+
+	// vkCmdPipelineBarrier calls and the image and buffer barriers they carried.
+	static uint32_t pipelineBarrierCount;
+	static uint32_t imageBarrierCount;
+	static uint32_t bufferBarrierCount;
+
+	// Images take 4 bytes per texel, aligned to IMAGE_ALIGNMENT, and can live in memory type 0 only.
+	static const VkDeviceSize IMAGE_ALIGNMENT = 4096;
+
+	// One device local memory type in an 8 GB heap and one host visible, coherent type in a 256 MB heap,
+	// no failures and nothing alive.
+	static void reset();
+};
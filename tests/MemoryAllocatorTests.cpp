@@ -0,0 +1,85 @@
+#include "MemoryAllocator.h"
+#include "Check.h"
+#include "FakeVulkan.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+static const VkDeviceSize BLOCK_SIZE = 1024 * 1024;
+
+static VkMemoryRequirements makeRequirements(VkDeviceSize size, VkDeviceSize alignment) {
+	VkMemoryRequirements memReqs = {};
+	memReqs.size = size;
+	memReqs.alignment = alignment;
+	memReqs.memoryTypeBits = 0x3;
+	return memReqs;
+}
+
+static void testSharedBlocks() {
+	FakeVulkan::reset();
+	MemoryAllocator allocator;
+	allocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE, BLOCK_SIZE);
+
+	Allocation a = allocator.allocate(makeRequirements(1000, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Allocation b = allocator.allocate(makeRequirements(1000, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	CHECK(a.memory == b.memory);
+	CHECK(a.memoryType == 0);
+	CHECK(a.mappedData == nullptr);
+	CHECK(b.offset == 1024);
+
+	//Bigger than a block, gets its own.
+	Allocation dedicated = allocator.allocate(makeRequirements(2 * BLOCK_SIZE, 256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	CHECK(dedicated.memory != a.memory);
+	CHECK(FakeVulkan::liveMemoryCount == 2);
+
+	//Host visible blocks stay mapped, allocations point into them.
+	Allocation staging = allocator.allocate(makeRequirements(64, 64), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	CHECK(staging.memoryType == 1);
+	CHECK(staging.mappedData != nullptr);
+	CHECK(FakeVulkan::mappedMemoryCount == 1);
+
+	MemoryAllocator::Stats stats = allocator.getStats();
+	CHECK(stats.blockCount == 3);
+	CHECK(stats.allocationCount == 4);
+
+	//The dedicated block goes with its allocation, the last shared block of a type stays.
+	allocator.free(dedicated);
+	allocator.free(a);
+	allocator.free(b);
+	CHECK(FakeVulkan::liveMemoryCount == 2);
+	CHECK(allocator.getStats().allocationCount == 1);
+
+	allocator.free(staging);
+	allocator.cleanup();
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+	CHECK(FakeVulkan::mappedMemoryCount == 0);
+}
+
+static void testMapFailure() {
+	FakeVulkan::reset();
+	FakeVulkan::deviceProperties.limits.maxMemoryAllocationCount = 1;
+	MemoryAllocator allocator;
+	allocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE, BLOCK_SIZE);
+
+	//The block whose mapping failed is freed again and doesn't count towards maxMemoryAllocationCount.
+	FakeVulkan::mapMemoryResult = VK_ERROR_MEMORY_MAP_FAILED;
+	CHECK_THROWS(allocator.allocate(makeRequirements(64, 64), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT), runtime_error);
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+	CHECK(allocator.getStats().blockCount == 0);
+
+	FakeVulkan::mapMemoryResult = VK_SUCCESS;
+	Allocation allocation = allocator.allocate(makeRequirements(64, 64), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	CHECK(allocation.mappedData != nullptr);
+	CHECK(FakeVulkan::liveMemoryCount == 1);
+
+	allocator.free(allocation);
+	allocator.cleanup();
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+}
+
+int main() {
+	testSharedBlocks();
+	testMapFailure();
+	return finishChecks("MemoryAllocator");
+}
@@ -0,0 +1,247 @@
+#include "RenderGraph.h"
+#include "RenderMode.h"
+#include "Check.h"
+#include "FakeVulkan.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const VkExtent2D EXTENT = { 1024, 1024 };
+static const VkDeviceSize IMAGE_BYTES = 1024 * 1024 * 4;
+
+// Test graph, passes in order:
+// 0 Cull writes Draws
+// 1 A writes T1
+// 2 B reads T1, writes T2
+// 3 Dead reads T2, writes Unused, which nothing reads
+// 4 C reads T2, writes T3
+// 5 D reads T3 and Draws, writes Depth and the exported Backbuffer
+// 6 Uploads has side effects only
+struct TestGraph {
+	RenderGraph graph;
+	RenderGraph::ResourceId backbuffer;
+	RenderGraph::ResourceId draws;
+	RenderGraph::ResourceId t1;
+	RenderGraph::ResourceId t2;
+	RenderGraph::ResourceId t3;
+	RenderGraph::ResourceId unused;
+	RenderGraph::ResourceId depth;
+	vector<string> executed;
+
+	explicit TestGraph(MemoryAllocator &memoryAllocator) {
+		graph.init(VK_NULL_HANDLE, memoryAllocator);
+
+		RenderGraph::State acquired;
+		acquired.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		backbuffer = graph.importImage("Backbuffer", VK_IMAGE_ASPECT_COLOR_BIT, acquired);
+		RenderGraph::State presented;
+		presented.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		presented.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		graph.exportResource(backbuffer, presented);
+
+		draws = graph.importBuffer("Draws", RenderGraph::State());
+		t1 = graph.createImage("T1", VK_FORMAT_R8G8B8A8_UNORM, EXTENT);
+		t2 = graph.createImage("T2", VK_FORMAT_R8G8B8A8_UNORM, EXTENT);
+		t3 = graph.createImage("T3", VK_FORMAT_R8G8B8A8_UNORM, EXTENT);
+		unused = graph.createImage("Unused", VK_FORMAT_R8G8B8A8_UNORM, EXTENT);
+		depth = graph.createImage("Depth", VK_FORMAT_D32_SFLOAT, EXTENT);
+
+		RenderGraph::PassId cull = addPass("Cull");
+		graph.write(cull, draws, RenderGraph::Usage::ComputeStorage);
+
+		RenderGraph::PassId a = addPass("A");
+		graph.write(a, t1, RenderGraph::Usage::ColorAttachment);
+
+		RenderGraph::PassId b = addPass("B");
+		graph.read(b, t1, RenderGraph::Usage::FragmentSampled);
+		graph.write(b, t2, RenderGraph::Usage::ColorAttachment);
+
+		RenderGraph::PassId dead = addPass("Dead");
+		graph.read(dead, t2, RenderGraph::Usage::FragmentSampled);
+		graph.write(dead, unused, RenderGraph::Usage::ColorAttachment);
+
+		RenderGraph::PassId c = addPass("C");
+		graph.read(c, t2, RenderGraph::Usage::FragmentSampled);
+		graph.write(c, t3, RenderGraph::Usage::ColorAttachment);
+
+		RenderGraph::PassId d = addPass("D");
+		graph.read(d, t3, RenderGraph::Usage::FragmentSampled);
+		graph.read(d, draws, RenderGraph::Usage::IndirectArguments);
+		graph.write(d, depth, RenderGraph::Usage::DepthAttachment);
+		graph.write(d, backbuffer, RenderGraph::Usage::ColorAttachment);
+
+		graph.setSideEffects(addPass("Uploads"));
+	}
+
+	RenderGraph::PassId addPass(const string &name) {
+		return graph.addPass(name, [this, name](VkCommandBuffer) { executed.push_back(name); });
+	}
+};
+
+static bool contains(const string &text, const string &part) {
+	return text.find(part) != string::npos;
+}
+
+static void testCulling() {
+	FakeVulkan::reset();
+	MemoryAllocator memoryAllocator;
+	memoryAllocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	TestGraph test(memoryAllocator);
+	test.graph.compile();
+
+	RenderGraph::Stats stats = test.graph.getStats();
+	CHECK(stats.passCount == 7);
+	CHECK(stats.culledPassCount == 1);
+	//Unused is only written by the culled pass and never created.
+	CHECK(stats.transientCount == 4);
+	CHECK(test.graph.getImageView(test.unused) == VK_NULL_HANDLE);
+	CHECK(test.graph.getImageView(test.t1) != VK_NULL_HANDLE);
+	CHECK(FakeVulkan::liveImageCount == 4);
+
+	test.graph.setImage(test.backbuffer, (VkImage)(uintptr_t)0x1000);
+	test.graph.setBuffer(test.draws, (VkBuffer)(uintptr_t)0x2000);
+	test.graph.execute(VK_NULL_HANDLE);
+	CHECK((test.executed == vector<string>{ "Cull", "A", "B", "C", "D", "Uploads" }));
+	CHECK(stats.barrierCount > 0);
+	CHECK(FakeVulkan::pipelineBarrierCount == stats.barrierBatchCount);
+	CHECK(FakeVulkan::imageBarrierCount + FakeVulkan::bufferBarrierCount == stats.barrierCount);
+
+	ostringstream dump;
+	test.graph.dump(dump);
+	CHECK(contains(dump.str(), "7 passes (1 culled)"));
+	CHECK(contains(dump.str(), "\t3 Dead (culled)\n"));
+	CHECK(contains(dump.str(), "\ttransient Unused: unused\n"));
+
+	test.graph.cleanup();
+	memoryAllocator.cleanup();
+	CHECK(FakeVulkan::liveImageCount == 0);
+	CHECK(FakeVulkan::liveImageViewCount == 0);
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+}
+
+static void testAliasing() {
+	FakeVulkan::reset();
+	MemoryAllocator memoryAllocator;
+	memoryAllocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	TestGraph test(memoryAllocator);
+	test.graph.compile();
+
+	//T1 lives in passes 1-2, T2 in 2-4, T3 in 4-5 and Depth in 5. T3 can take T1's bytes and Depth T2's.
+	RenderGraph::Stats stats = test.graph.getStats();
+	CHECK(stats.transientBytes == 4 * IMAGE_BYTES);
+	CHECK(stats.allocatedBytes == 2 * IMAGE_BYTES);
+
+	ostringstream dump;
+	dump.precision(6);
+	test.graph.dump(dump);
+	//The caller's formatting survives.
+	CHECK(dump.precision() == 6);
+	CHECK((dump.flags() & ios_base::floatfield) == 0);
+	CHECK(contains(dump.str(), "\ttransient T1: 4.00 MB at heap 0 offset 0, passes 1-2\n"));
+	CHECK(contains(dump.str(), "\ttransient T2: 4.00 MB at heap 0 offset 4194304, passes 2-4\n"));
+	CHECK(contains(dump.str(), "\ttransient T3: 4.00 MB at heap 0 offset 0, passes 4-5\n"));
+	CHECK(contains(dump.str(), "\ttransient Depth: 4.00 MB at heap 0 offset 4194304, passes 5-5\n"));
+	CHECK(contains(dump.str(), "\ttransients 16.00 MB in 8.00 MB, aliasing saved 8.00 MB\n"));
+
+	//Handing the transients over leaves them alive until destroyTransients.
+	RenderGraph::Transients transients = test.graph.takeTransients();
+	CHECK(test.graph.getStats().transientCount == 0);
+	CHECK(FakeVulkan::liveImageCount == 4);
+	RenderGraph::destroyTransients(VK_NULL_HANDLE, memoryAllocator, transients);
+	CHECK(FakeVulkan::liveImageCount == 0);
+	CHECK(FakeVulkan::liveImageViewCount == 0);
+
+	memoryAllocator.cleanup();
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+}
+
+static void testBindFailure() {
+	FakeVulkan::reset();
+	MemoryAllocator memoryAllocator;
+	memoryAllocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	TestGraph test(memoryAllocator);
+	FakeVulkan::bindImageMemoryResult = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	CHECK_THROWS(test.graph.compile(), runtime_error);
+
+	//Whatever was created before the failure is still released.
+	test.graph.cleanup();
+	memoryAllocator.cleanup();
+	CHECK(FakeVulkan::liveImageCount == 0);
+	CHECK(FakeVulkan::liveImageViewCount == 0);
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+}
+
+static void testRenderModeFallback() {
+	FakeVulkan::reset();
+	MemoryAllocator memoryAllocator;
+	memoryAllocator.init(VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+	//The fake device lacks drawIndirectFirstInstance, GpuDriven is requested.
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(VK_NULL_HANDLE, &features);
+	RenderMode renderMode = resolveRenderMode(RenderMode::GpuDriven, features);
+	CHECK(renderMode == RenderMode::CpuDraws);
+	CHECK(resolveRenderMode(RenderMode::Instanced, features) == RenderMode::Instanced);
+
+	//Built the way the application builds its frame for the resolved mode, the draw buffers are only set in GpuDriven.
+	RenderGraph graph;
+	graph.init(VK_NULL_HANDLE, memoryAllocator);
+	vector<string> executed;
+	RenderGraph::State acquired;
+	acquired.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	RenderGraph::ResourceId color = graph.importImage("Color", VK_IMAGE_ASPECT_COLOR_BIT, acquired);
+	RenderGraph::State presented;
+	presented.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	presented.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	graph.exportResource(color, presented);
+	RenderGraph::ResourceId depth = graph.createImage("Depth", VK_FORMAT_D32_SFLOAT, EXTENT);
+
+	bool gpuDriven = renderMode == RenderMode::GpuDriven;
+	RenderGraph::ResourceId draws = 0;
+	if (gpuDriven) {
+		draws = graph.importBuffer("Draw commands", RenderGraph::State());
+		RenderGraph::PassId cull = graph.addPass("Cull", [&executed](VkCommandBuffer) { executed.push_back("Cull"); });
+		graph.write(cull, draws, RenderGraph::Usage::ComputeStorage);
+	}
+	RenderGraph::PassId opaque = graph.addPass("Opaque", [&executed](VkCommandBuffer) { executed.push_back("Opaque"); });
+	graph.write(opaque, color, RenderGraph::Usage::ColorAttachment);
+	graph.write(opaque, depth, RenderGraph::Usage::DepthAttachment);
+	if (gpuDriven) {
+		graph.read(opaque, draws, RenderGraph::Usage::IndirectArguments);
+	}
+	graph.compile();
+
+	graph.setImage(color, (VkImage)(uintptr_t)0x1000);
+	if (gpuDriven) {
+		graph.setBuffer(draws, (VkBuffer)(uintptr_t)0x2000);
+	}
+	graph.execute(VK_NULL_HANDLE);
+	//No cull pass without GpuCulling behind it and no barriers on unset buffers.
+	CHECK((executed == vector<string>{ "Opaque" }));
+	CHECK(graph.getStats().passCount == 1);
+	CHECK(FakeVulkan::bufferBarrierCount == 0);
+
+	//With the feature the mode is kept.
+	features.drawIndirectFirstInstance = VK_TRUE;
+	CHECK(resolveRenderMode(RenderMode::GpuDriven, features) == RenderMode::GpuDriven);
+
+	graph.cleanup();
+	memoryAllocator.cleanup();
+	CHECK(FakeVulkan::liveImageCount == 0);
+	CHECK(FakeVulkan::liveMemoryCount == 0);
+}
+
+int main() {
+	testCulling();
+	testAliasing();
+	testBindFailure();
+	testRenderModeFallback();
+	return finishChecks("RenderGraph");
+}
@@ -0,0 +1,133 @@
+#include "RenderQueue.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static bool matchesStableSort(const RenderQueue &queue, vector<RenderQueue::Item> reference) {
+	stable_sort(reference.begin(), reference.end(), [](const RenderQueue::Item &a, const RenderQueue::Item &b) { return a.key < b.key; });
+	const vector<RenderQueue::Item> &items = queue.getItems();
+	if (items.size() != reference.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < items.size(); i++) {
+		if (items[i].key != reference[i].key || items[i].drawIndex != reference[i].drawIndex) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void testKeyOrder() {
+	//Pipeline before material before depth.
+	CHECK(RenderQueue::makeKey(1, 0, 0.f) > RenderQueue::makeKey(0, 1000, 1.f));
+	CHECK(RenderQueue::makeKey(1, 3, 0.f) > RenderQueue::makeKey(1, 2, 1.f));
+	CHECK(RenderQueue::makeKey(1, 2, 0.25f) < RenderQueue::makeKey(1, 2, 0.5f));
+
+	uint64_t key = RenderQueue::makeKey(4095, 7, 0.3f);
+	CHECK(RenderQueue::getPipeline(key) == 4095);
+	CHECK(RenderQueue::getMaterial(key) == 7);
+
+	//Truncated to their bit counts.
+	key = RenderQueue::makeKey(4096 + 5, (1u << RenderQueue::MATERIAL_BITS) + 9, 0.5f);
+	CHECK(RenderQueue::getPipeline(key) == 5);
+	CHECK(RenderQueue::getMaterial(key) == 9);
+}
+
+static void testDepthClamping() {
+	uint64_t nearest = RenderQueue::makeKey(2, 3, 0.f);
+	uint64_t farthest = RenderQueue::makeKey(2, 3, 1.f);
+
+	CHECK(RenderQueue::makeKey(2, 3, -0.5f) == nearest);
+	CHECK(RenderQueue::makeKey(2, 3, -0.f) == nearest);
+	CHECK(RenderQueue::makeKey(2, 3, -numeric_limits<float>::infinity()) == nearest);
+	CHECK(RenderQueue::makeKey(2, 3, numeric_limits<float>::quiet_NaN()) == nearest);
+	CHECK(RenderQueue::makeKey(2, 3, 1.5f) == farthest);
+	CHECK(RenderQueue::makeKey(2, 3, numeric_limits<float>::infinity()) == farthest);
+
+	//Clamping never spills into the material or pipeline bits.
+	CHECK(RenderQueue::getMaterial(farthest) == 3);
+	CHECK(RenderQueue::getPipeline(farthest) == 2);
+	CHECK(RenderQueue::getMaterial(RenderQueue::makeKey(2, 3, numeric_limits<float>::quiet_NaN())) == 3);
+}
+
+static void testStability() {
+	//Equal keys keep the order they were pushed in, across the passes of every digit.
+	RenderQueue queue;
+	vector<RenderQueue::Item> reference;
+	for (uint32_t i = 0; i < 1000; i++) {
+		uint64_t key = RenderQueue::makeKey(i % 3, i % 5, (i % 7) / 7.f);
+		queue.push(key, i);
+		reference.push_back({ key, i });
+	}
+	queue.sort();
+	CHECK(matchesStableSort(queue, reference));
+
+	//Sorting a sorted queue again changes nothing.
+	queue.sort();
+	CHECK(matchesStableSort(queue, reference));
+
+	//All keys equal: no pass moves anything.
+	RenderQueue same;
+	for (uint32_t i = 0; i < 100; i++) {
+		same.push(RenderQueue::makeKey(1, 1, 0.5f), i);
+	}
+	same.sort();
+	CHECK(same.getSortPasses() == 0);
+	for (uint32_t i = 0; i < 100; i++) {
+		CHECK(same.getItems()[i].drawIndex == i);
+	}
+}
+
+static void testSkippedDigits() {
+	//One pipeline and material: the top 32 bits are shared, only depth digits are sorted.
+	RenderQueue depthOnly;
+	vector<RenderQueue::Item> reference;
+	mt19937 random(7);
+	for (uint32_t i = 0; i < 500; i++) {
+		uint64_t key = RenderQueue::makeKey(0, 0, (random() % 10000) / 10000.f);
+		depthOnly.push(key, i);
+		reference.push_back({ key, i });
+	}
+	depthOnly.sort();
+	CHECK(matchesStableSort(depthOnly, reference));
+	CHECK(depthOnly.getSortPasses() <= 4);
+
+	//Only the lowest pipeline digit differs: a single pass.
+	RenderQueue pipelineOnly;
+	reference.clear();
+	for (uint32_t i = 0; i < 64; i++) {
+		uint64_t key = RenderQueue::makeKey((i * 37) % 16, 0, 0.5f);
+		pipelineOnly.push(key, i);
+		reference.push_back({ key, i });
+	}
+	pipelineOnly.sort();
+	CHECK(matchesStableSort(pipelineOnly, reference));
+	CHECK(pipelineOnly.getSortPasses() == 1);
+
+	//Random keys over the whole range, including clamped depths.
+	for (uint32_t trial = 0; trial < 20; trial++) {
+		RenderQueue queue;
+		reference.clear();
+		uint32_t count = random() % 2000;
+		for (uint32_t i = 0; i < count; i++) {
+			uint64_t key = RenderQueue::makeKey(random() % 3, random() % (trial % 2 ? 1 : 50), (random() % 10000) / 9999.f * 1.2f - 0.1f);
+			queue.push(key, i);
+			reference.push_back({ key, i });
+		}
+		queue.sort();
+		CHECK(matchesStableSort(queue, reference));
+	}
+}
+
+int main() {
+	testKeyOrder();
+	testDepthClamping();
+	testStability();
+	testSkippedDigits();
+	return finishChecks("RenderQueue");
+}